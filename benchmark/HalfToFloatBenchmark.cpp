@@ -0,0 +1,69 @@
+// Benchmark of the half to float conversion used for the MZD attribute
+// chunks: the lookup table of readMZD_half2float.h, the portable and the
+// dispatched conversion. The exactness of the conversions is checked by the
+// halfFloat test in the directory tests.
+//
+// Usage: HalfToFloatBenchmark [numValues] [repetitions]
+
+#include "extern/mzd/halfToFloat.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+	union HalfToFloatEntry { unsigned int ui; float f; };
+	const HalfToFloatEntry lookupH2F[65536] =
+	{
+		#include "extern/mzd/readMZD_half2float.h"
+	};
+
+	void halfToFloatTable(const unsigned short *in, float *out, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = lookupH2F[in[i]].f;
+	}
+
+	double timeMin(void (*convert)(const unsigned short *, float *, size_t), const std::vector<unsigned short> &in, std::vector<float> &out, const unsigned int repetitions)
+	{
+		double best = 1.0e30;
+		for (unsigned int r = 0; r < repetitions; r++)
+		{
+			const auto start = std::chrono::high_resolution_clock::now();
+			convert(in.data(), out.data(), in.size());
+			const auto stop = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double>(stop - start).count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const size_t numValues = (argc > 1) ? (size_t)atol(argv[1]) : 30000000;
+	const unsigned int repetitions = (argc > 2) ? (unsigned int)atoi(argv[2]) : 5;
+
+	printf("F16C available: %s\n", mzd_halfToFloatHasF16C() ? "yes" : "no");
+
+	// random normal vectors and colors in [-1, 1]
+	std::vector<unsigned short> in(numValues);
+	unsigned int seed = 12345;
+	for (size_t i = 0; i < numValues; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		in[i] = (unsigned short)((seed >> 16) & 0xbfff);
+	}
+	std::vector<float> out(numValues);
+
+	const double t0 = timeMin(halfToFloatTable, in, out, repetitions);
+	const double t1 = timeMin(mzd_halfToFloatPortable, in, out, repetitions);
+	const double t2 = timeMin(mzd_halfToFloat, in, out, repetitions);
+	printf("%zu values\n", numValues);
+	printf("lookup table: %8.3f s  %8.0f M values/s\n", t0, 1.0e-6 * numValues / t0);
+	printf("portable:     %8.3f s  %8.0f M values/s\n", t1, 1.0e-6 * numValues / t1);
+	printf("dispatched:   %8.3f s  %8.0f M values/s\n", t2, 1.0e-6 * numValues / t2);
+
+	return 0;
+}
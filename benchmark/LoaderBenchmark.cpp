@@ -0,0 +1,520 @@
+// Benchmark of the complete loading path of a frame for all file formats. For
+// each scale (number of triangles, default 10K, 100K and 1M) deterministic
+// meshes with normals and colors are generated with four types:
+//   tri    triangles only
+//   quad   quads, every 8th cell is split into two triangles
+//   mixed  triangles, quads and hexagons
+//   fv     quads as for quad with face-varying normals (one per polygon) and
+//          face-varying UVs (the corners of each polygon span the unit square)
+// Polygons are counted as (count - 2) triangles. Each mesh is written as OBJ,
+// ASCII PLY, binary PLY, MZD and MTC file and read repeatedly, fv meshes are
+// not written as ASCII PLY. The stages of a read are timed separately:
+//   io          read the file into memory (from the page cache after the first run)
+//   parse       MeshReader::readFromMemory() with positionsOnly, i.e. positions and faces
+//   decode      MeshReader::readFromMemory() with all attributes
+//   attributes  decode - parse of the same repetition, i.e. normals, colors and UVs
+//   convert     conversion to the arrays of the Maya mesh as in MayaMeshArrays::set()
+//               (bulk copies of float points, colors and UVs, double normals, int
+//               faces, face-varying normals are resolved per polygon vertex)
+//   total       io + decode + convert
+// For each stage the minimum, median and 95th percentile are reported. The
+// meshes which are read are compared with the generated mesh, the program
+// returns 1 if a mesh differs. Formats which do not store a property (colors
+// in OBJ, face-varying normals in PLY) are compared without it. Face-varying
+// attributes are compared per polygon vertex.
+//
+// Usage: LoaderBenchmark [-scales 10K,100K,1M] [-types tri,quad,mixed,fv] [-formats obj,ply-ascii,ply,mzd,mtc]
+//                        [-repetitions N] [-threads N] [-json file]
+// -threads sets the number of threads of the conversion loops of the readers (default 0 = all cores).
+// Scales up to 20M triangles are supported, but need several GB of memory and disk space.
+
+#include "src/MeshData.h"
+#include "src/MeshReader.h"
+#include "src/MeshWriter.h"
+#include "src/ThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+namespace
+{
+	struct Stats
+	{
+		double min, median, p95;
+	};
+
+	struct Result
+	{
+		std::string type;
+		std::string format;
+		long long triangles;
+		int vertices;
+		int polygons;
+		size_t fileBytes;
+		bool identical;
+		std::vector<std::pair<std::string, Stats>> stages;
+	};
+
+	/** Minimum, median and 95th percentile (nearest rank) of the samples. */
+	Stats computeStats(std::vector<double> samples)
+	{
+		Stats s = { 0.0, 0.0, 0.0 };
+		if (samples.empty())
+			return s;
+		std::sort(samples.begin(), samples.end());
+		const size_t n = samples.size();
+		s.min = samples[0];
+		s.median = (n % 2 == 1) ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+		s.p95 = samples[std::min(n - 1, (size_t)ceil(0.95 * (double)n) - 1)];
+		return s;
+	}
+
+	/** Mesh on a res x res vertex grid with a wave, see the types above. */
+	Utilities::MeshData generateMesh(const std::string &type, const int res)
+	{
+		Utilities::MeshData m;
+		const size_t n = (size_t)res * (size_t)res;
+		m.positions.resize(4 * n);
+		m.normals.resize(3 * n);
+		m.colors.resize(4 * n);
+		for (int j = 0; j < res; j++)
+		{
+			for (int i = 0; i < res; i++)
+			{
+				const size_t v = (size_t)j * res + i;
+				const float u = (float)i / (float)(res - 1);
+				const float w = (float)j / (float)(res - 1);
+				const float h = 0.05f * sinf(20.0f * u) * cosf(15.0f * w);
+
+				// normal of the height field (u, h, w)
+				const float dhdu = 0.05f * 20.0f * cosf(20.0f * u) * cosf(15.0f * w);
+				const float dhdw = -0.05f * 15.0f * sinf(20.0f * u) * sinf(15.0f * w);
+				const float length = sqrtf(dhdu * dhdu + 1.0f + dhdw * dhdw);
+				const float p[4] = { u, h, w, 1.0f };
+				const float nv[3] = { -dhdu / length, 1.0f / length, -dhdw / length };
+
+				// colors are multiples of 1/255, so that they are stored exactly in PLY files
+				const float c[4] = { (float)(i % 256) / 255.0f, (float)(j % 256) / 255.0f, (float)((i + j) % 256) / 255.0f, 1.0f };
+				std::copy(p, p + 4, &m.positions[4 * v]);
+				std::copy(nv, nv + 3, &m.normals[3 * v]);
+				std::copy(c, c + 4, &m.colors[4 * v]);
+			}
+		}
+
+		const bool tri = type == "tri";
+		const bool mixed = type == "mixed";
+		const bool faceVarying = type == "fv";
+		for (int j = 0; j < res - 1; j++)
+		{
+			for (int i = 0; i < res - 1; i++)
+			{
+				const int v00 = j * res + i, v10 = v00 + 1, v01 = v00 + res, v11 = v01 + 1;
+				const int pattern = mixed ? (i + j) % 3 : ((i + 8 * j) % 8 == 0 ? 0 : 1);
+				if (tri || (pattern == 0))
+				{
+					const int t[6] = { v00, v10, v11, v00, v11, v01 };
+					m.counts.push_back(3);
+					m.counts.push_back(3);
+					m.connects.insert(m.connects.end(), t, t + 6);
+				}
+				else if ((pattern == 1) || (i + 2 >= res))
+				{
+					const int q[4] = { v00, v10, v11, v01 };
+					m.counts.push_back(4);
+					m.connects.insert(m.connects.end(), q, q + 4);
+				}
+				else
+				{
+					// hexagon covering this cell and the next one
+					const int hx[6] = { v00, v10, v10 + 1, v11 + 1, v11, v01 };
+					m.counts.push_back(6);
+					m.connects.insert(m.connects.end(), hx, hx + 6);
+					i++;
+				}
+			}
+		}
+
+		if (faceVarying)
+		{
+			// the normal of the first vertex is used for all polygon vertices, the
+			// UVs of the polygon vertices are the corners of the unit square
+			std::vector<float> vertexNormals;
+			vertexNormals.swap(m.normals);
+			std::vector<float> u, v;
+			size_t index = 0;
+			for (int f = 0; f < m.numPolygons(); f++)
+			{
+				const int first = m.connects[index];
+				m.normals.insert(m.normals.end(), &vertexNormals[3 * (size_t)first], &vertexNormals[3 * (size_t)first + 3]);
+				for (int k = 0; k < m.counts[f]; k++, index++)
+				{
+					m.normalIds.push_back(f);
+					m.uvIds.push_back((int)u.size());
+					u.push_back((k == 1) || (k == 2) ? 1.0f : 0.0f);
+					v.push_back(k >= 2 ? 1.0f : 0.0f);
+				}
+			}
+			m.uvs = u;
+			m.uvs.insert(m.uvs.end(), v.begin(), v.end());
+		}
+		m.topologyHash = m.computeTopologyHash();
+		return m;
+	}
+
+	bool writeASCIIPLY(const std::string &fileName, const Utilities::MeshData &m)
+	{
+		FILE *file = fopen(fileName.c_str(), "w");
+		if (!file)
+			return false;
+		fprintf(file, "ply\nformat ascii 1.0\nelement vertex %d\nproperty float x\nproperty float y\nproperty float z\n"
+			"property float nx\nproperty float ny\nproperty float nz\nproperty uchar red\nproperty uchar green\nproperty uchar blue\n"
+			"element face %d\nproperty list uchar int vertex_indices\nend_header\n", m.numVertices(), m.numPolygons());
+		for (int i = 0; i < m.numVertices(); i++)
+		{
+			fprintf(file, "%.9g %.9g %.9g %.9g %.9g %.9g %d %d %d\n", m.positions[4 * i], m.positions[4 * i + 1], m.positions[4 * i + 2],
+				m.normals[3 * i], m.normals[3 * i + 1], m.normals[3 * i + 2],
+				(int)lroundf(255.0f * m.colors[4 * i]), (int)lroundf(255.0f * m.colors[4 * i + 1]), (int)lroundf(255.0f * m.colors[4 * i + 2]));
+		}
+		size_t index = 0;
+		for (int count : m.counts)
+		{
+			fprintf(file, "%d", count);
+			for (int k = 0; k < count; k++)
+				fprintf(file, " %d", m.connects[index++]);
+			fprintf(file, "\n");
+		}
+		return fclose(file) == 0;
+	}
+
+	bool readFile(const std::string &fileName, std::vector<char> &data)
+	{
+		FILE *file = fopen(fileName.c_str(), "rb");
+		if (!file)
+			return false;
+		bool ok = fseek(file, 0, SEEK_END) == 0;
+		const long size = ok ? ftell(file) : -1;
+		ok = ok && (size > 0) && (fseek(file, 0, SEEK_SET) == 0);
+		if (ok)
+		{
+			data.resize((size_t)size);
+			ok = fread(data.data(), 1, data.size(), file) == data.size();
+		}
+		fclose(file);
+		return ok;
+	}
+
+	/** Arrays of the Maya mesh, see MayaMeshArrays. */
+	struct MayaArrays
+	{
+		std::vector<float> points;		// MFloatPointArray
+		std::vector<double> normals;	// MVectorArray
+		std::vector<float> colors;		// MColorArray
+		std::vector<int> normalFaces;	// MIntArray, face-varying normals only
+		std::vector<int> vertexList;	// MIntArray, kept between frames
+		std::vector<int> counts;
+		std::vector<int> connects;
+		std::vector<float> uvs;			// MFloatArray u, v
+		std::vector<int> uvIds;			// MIntArray
+	};
+
+	void convert(const Utilities::MeshData &mesh, MayaArrays &a)
+	{
+		const int n = mesh.numVertices();
+		a.points.assign(mesh.positions.begin(), mesh.positions.end());
+		a.normalFaces.clear();
+		if (mesh.hasNormals())
+			a.normals.assign(mesh.normals.begin(), mesh.normals.end());
+		else if (mesh.hasFaceVaryingNormals())
+		{
+			a.normals.resize(3 * mesh.normalIds.size());
+			for (size_t i = 0; i < mesh.normalIds.size(); i++)
+				for (int k = 0; k < 3; k++)
+					a.normals[3 * i + k] = mesh.normals[3 * (size_t)mesh.normalIds[i] + k];
+			a.normalFaces.resize(mesh.connects.size());
+			size_t index = 0;
+			for (int f = 0; f < mesh.numPolygons(); f++)
+				for (int k = 0; k < mesh.counts[f]; k++)
+					a.normalFaces[index++] = f;
+		}
+		else
+			a.normals.clear();
+		if (mesh.hasColors())
+			a.colors.assign(mesh.colors.begin(), mesh.colors.end());
+		else
+			a.colors.clear();
+		const int numFilled = (int)a.vertexList.size();
+		a.vertexList.resize(n);
+		for (int j = numFilled; j < n; j++)
+			a.vertexList[j] = j;
+		a.counts.assign(mesh.counts.begin(), mesh.counts.end());
+		a.connects.assign(mesh.connects.begin(), mesh.connects.end());
+		if (mesh.hasUVs())
+		{
+			a.uvs.assign(mesh.uvs.begin(), mesh.uvs.end());
+			if (mesh.uvIds.empty())
+				a.uvIds.assign(mesh.connects.begin(), mesh.connects.end());
+			else
+				a.uvIds.assign(mesh.uvIds.begin(), mesh.uvIds.end());
+		}
+		else
+		{
+			a.uvs.clear();
+			a.uvIds.clear();
+		}
+	}
+
+	/** Attribute with dim floats of polygon vertex i, the values are interleaved or split (all u, then all v). */
+	inline float cornerValue(const std::vector<float> &values, const std::vector<int> &ids, const std::vector<int> &connects, const size_t i,
+		const int dim, const int k, const bool split)
+	{
+		const size_t id = (size_t)(ids.empty() ? connects[i] : ids[i]);
+		return split ? values[k * (values.size() / dim) + id] : values[dim * id + k];
+	}
+
+	/** Compare a mesh which was read with the generated one. Colors are stored with
+	* 8 bits in PLY files, the normals with half precision in MZD files.
+	*/
+	bool compare(const std::string &format, const Utilities::MeshData &read, const Utilities::MeshData &generated)
+	{
+		if (read.positions != generated.positions)
+			return false;
+		if (((read.counts != generated.counts) || (read.connects != generated.connects) || (read.topologyHash != generated.topologyHash)))
+			return false;
+		const float normalTolerance = (format == "mzd") ? 1.0e-3f : 0.0f;
+		if (generated.hasFaceVaryingNormals())
+		{
+			if ((format == "ply") || (format == "ply-ascii"))
+			{
+				if (!read.normals.empty())
+					return false;
+			}
+			else if (!read.hasFaceVaryingNormals())
+				return false;
+			else
+			{
+				for (size_t i = 0; i < read.connects.size(); i++)
+					for (int k = 0; k < 3; k++)
+						if (fabsf(cornerValue(read.normals, read.normalIds, read.connects, i, 3, k, false) -
+							cornerValue(generated.normals, generated.normalIds, generated.connects, i, 3, k, false)) > normalTolerance)
+							return false;
+			}
+		}
+		else
+		{
+			if (!read.hasNormals() || (read.normals.size() != generated.normals.size()))
+				return false;
+			for (size_t i = 0; i < read.normals.size(); i++)
+				if (fabsf(read.normals[i] - generated.normals[i]) > normalTolerance)
+					return false;
+		}
+		if (read.hasUVs() != generated.hasUVs())
+			return false;
+		if (generated.hasUVs())
+		{
+			for (size_t i = 0; i < read.connects.size(); i++)
+				for (int k = 0; k < 2; k++)
+					if (cornerValue(read.uvs, read.uvIds, read.connects, i, 2, k, true) != cornerValue(generated.uvs, generated.uvIds, generated.connects, i, 2, k, true))
+						return false;
+		}
+		if (format == "obj")
+			return read.colors.empty();
+		if (read.colors.size() != generated.colors.size())
+			return false;
+		const float colorTolerance = (format == "mzd") ? 1.0e-3f : 0.0f;
+		for (size_t i = 0; i < read.colors.size(); i++)
+			if (fabsf(read.colors[i] - generated.colors[i]) > colorTolerance)
+				return false;
+		return true;
+	}
+
+	std::vector<std::string> split(const std::string &list)
+	{
+		std::vector<std::string> items;
+		std::stringstream in(list);
+		std::string item;
+		while (std::getline(in, item, ','))
+			if (!item.empty())
+				items.push_back(item);
+		return items;
+	}
+
+	/** Number with an optional suffix K or M. */
+	long long parseScale(const std::string &s)
+	{
+		const double value = atof(s.c_str());
+		const char suffix = s.empty() ? ' ' : (char)toupper(s.back());
+		if (suffix == 'K')
+			return (long long)(value * 1.0e3);
+		if (suffix == 'M')
+			return (long long)(value * 1.0e6);
+		return (long long)value;
+	}
+
+	double seconds(const std::chrono::high_resolution_clock::time_point &start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void writeJSON(FILE *file, const std::vector<Result> &results, const unsigned int repetitions)
+	{
+		fprintf(file, "{\n  \"benchmark\": \"LoaderBenchmark\",\n  \"unit\": \"s\",\n  \"repetitions\": %u,\n  \"results\": [\n", repetitions);
+		for (size_t r = 0; r < results.size(); r++)
+		{
+			const Result &res = results[r];
+			fprintf(file, "    {\"type\": \"%s\", \"format\": \"%s\", \"triangles\": %lld, \"vertices\": %d, \"polygons\": %d, \"fileBytes\": %zu, \"identical\": %s,\n",
+				res.type.c_str(), res.format.c_str(), res.triangles, res.vertices, res.polygons, res.fileBytes, res.identical ? "true" : "false");
+			fprintf(file, "     \"stages\": {");
+			for (size_t s = 0; s < res.stages.size(); s++)
+			{
+				const Stats &st = res.stages[s].second;
+				fprintf(file, "%s\"%s\": {\"min\": %.6g, \"median\": %.6g, \"p95\": %.6g}", (s == 0) ? "" : ", ",
+					res.stages[s].first.c_str(), st.min, st.median, st.p95);
+			}
+			fprintf(file, "}}%s\n", (r + 1 < results.size()) ? "," : "");
+		}
+		fprintf(file, "  ]\n}\n");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> scales = { "10K", "100K", "1M" };
+	std::vector<std::string> types = { "tri", "quad", "mixed", "fv" };
+	std::vector<std::string> formats = { "obj", "ply-ascii", "ply", "mzd", "mtc" };
+	unsigned int repetitions = 5;
+	std::string jsonFile;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if ((arg == "-scales") && (i + 1 < argc))
+			scales = split(argv[++i]);
+		else if ((arg == "-types") && (i + 1 < argc))
+			types = split(argv[++i]);
+		else if ((arg == "-formats") && (i + 1 < argc))
+			formats = split(argv[++i]);
+		else if ((arg == "-repetitions") && (i + 1 < argc))
+			repetitions = (unsigned int)std::max(1, atoi(argv[++i]));
+		else if ((arg == "-threads") && (i + 1 < argc))
+			Utilities::ThreadPool::getInstance().setNumThreads((unsigned int)std::max(0, atoi(argv[++i])));
+		else if ((arg == "-json") && (i + 1 < argc))
+			jsonFile = argv[++i];
+		else
+		{
+			printf("Usage: LoaderBenchmark [-scales 10K,100K,1M] [-types tri,quad,mixed,fv] [-formats obj,ply-ascii,ply,mzd,mtc] [-repetitions N] [-threads N] [-json file]\n");
+			return -1;
+		}
+	}
+
+	std::vector<Result> results;
+	bool allIdentical = true;
+	printf("%-6s %-10s %10s %10s  %-11s %10s %10s %10s\n", "type", "format", "triangles", "MB", "stage", "min [s]", "median [s]", "p95 [s]");
+	for (const std::string &scale : scales)
+	{
+		// two triangles per grid cell
+		const long long targetTriangles = std::max(2LL, parseScale(scale));
+		const int res = std::max(3, (int)ceil(sqrt((double)targetTriangles / 2.0)) + 1);
+		for (const std::string &type : types)
+		{
+			const Utilities::MeshData generated = generateMesh(type, res);
+			long long triangles = 0;
+			for (int count : generated.counts)
+				triangles += count - 2;
+
+			for (const std::string &format : formats)
+			{
+				// the ASCII PLY writer of the benchmark only writes per-vertex attributes
+				if ((format == "ply-ascii") && generated.hasFaceVaryingNormals())
+					continue;
+				const std::string ext = (format == "ply-ascii") ? "ply" : format;
+				const std::string fileName = "LoaderBenchmark_" + type + "_" + scale + "." + ext;
+				std::string error;
+				const bool written = (format == "ply-ascii") ? writeASCIIPLY(fileName, generated) : Utilities::MeshWriter::write(fileName, generated, error);
+				if (!written)
+				{
+					fprintf(stderr, "Failed to write file %s %s\n", fileName.c_str(), error.c_str());
+					return -1;
+				}
+
+				const std::string fileExt = Utilities::MeshReader::getFormat(fileName);
+				std::vector<double> tIO, tParse, tDecode, tAttributes, tConvert, tTotal;
+				std::vector<char> data;
+				Utilities::MeshData mesh;
+				MayaArrays arrays;
+				bool ok = true;
+				for (unsigned int r = 0; r < repetitions; r++)
+				{
+					auto start = std::chrono::high_resolution_clock::now();
+					ok = readFile(fileName, data) && ok;
+					tIO.push_back(seconds(start));
+
+					start = std::chrono::high_resolution_clock::now();
+					ok = Utilities::MeshReader::readFromMemory(fileExt, data.data(), data.size(), true, mesh, error) && ok;
+					tParse.push_back(seconds(start));
+
+					start = std::chrono::high_resolution_clock::now();
+					ok = Utilities::MeshReader::readFromMemory(fileExt, data.data(), data.size(), false, mesh, error) && ok;
+					tDecode.push_back(seconds(start));
+					tAttributes.push_back(std::max(0.0, tDecode.back() - tParse.back()));
+
+					start = std::chrono::high_resolution_clock::now();
+					convert(mesh, arrays);
+					tConvert.push_back(seconds(start));
+					tTotal.push_back(tIO.back() + tDecode.back() + tConvert.back());
+				}
+				remove(fileName.c_str());
+
+				Result result;
+				result.type = type;
+				result.format = format;
+				result.triangles = triangles;
+				result.vertices = generated.numVertices();
+				result.polygons = generated.numPolygons();
+				result.fileBytes = data.size();
+				result.identical = ok && compare(format, mesh, generated);
+				result.stages.push_back(std::make_pair("io", computeStats(tIO)));
+				result.stages.push_back(std::make_pair("parse", computeStats(tParse)));
+				result.stages.push_back(std::make_pair("decode", computeStats(tDecode)));
+				result.stages.push_back(std::make_pair("attributes", computeStats(tAttributes)));
+				result.stages.push_back(std::make_pair("convert", computeStats(tConvert)));
+				result.stages.push_back(std::make_pair("total", computeStats(tTotal)));
+				allIdentical = allIdentical && result.identical;
+				if (!ok)
+					fprintf(stderr, "%s: %s\n", fileName.c_str(), error.c_str());
+
+				for (size_t s = 0; s < result.stages.size(); s++)
+				{
+					const Stats &st = result.stages[s].second;
+					if (s == 0)
+						printf("%-6s %-10s %10lld %10.1f", type.c_str(), format.c_str(), triangles, 1.0e-6 * result.fileBytes);
+					else
+						printf("%-6s %-10s %10s %10s", "", "", "", "");
+					printf("  %-11s %10.4f %10.4f %10.4f\n", result.stages[s].first.c_str(), st.min, st.median, st.p95);
+				}
+				if (!result.identical)
+					printf("  results differ from the generated mesh\n");
+				results.push_back(result);
+			}
+		}
+	}
+
+	if (!jsonFile.empty())
+	{
+		FILE *file = fopen(jsonFile.c_str(), "w");
+		if (!file)
+		{
+			fprintf(stderr, "Failed to write file %s\n", jsonFile.c_str());
+			return -1;
+		}
+		writeJSON(file, results, repetitions);
+		fclose(file);
+	}
+	printf("results identical: %s\n", allIdentical ? "yes" : "NO");
+	return allIdentical ? 0 : 1;
+}
@@ -0,0 +1,239 @@
+// Benchmark of the MZD reader. A quad grid with the requested number of
+// vertices (default 10M) and half float vertex normals is written to a
+// temporary file. The file is read with the previous per-element fread()
+// pattern (one call per vertex and per polygon) and with readMZD() and
+// readMZDFromMemory(), which read each array with one call. Only the vertex
+// chunk is decoded, the normal chunk is skipped by all readers. The two pass
+// variant readMZDInfoFromMemory() + readMZDDataFromMemory() decodes into
+// caller provided vectors without intermediate allocations.
+//
+// The grid is written with the streaming interface of writeMZD.h. The write
+// and read round trips are tested by the mzdRoundTrip test in the directory
+// tests.
+//
+// Usage: MZDBenchmark [numVertices] [repetitions]
+
+#include "extern/mzd/readMZD.h"
+#include "extern/mzd/writeMZD.h"
+#include "src/MemoryMappedFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace
+{
+	/** Write a res x res quad grid with half float normals row by row. */
+	bool writeGrid(const std::string &fileName, const int res)
+	{
+		const int numVertices = res * res;
+		const int numPolygons = (res - 1) * (res - 1);
+
+		MZDWriter writer;
+		writeMZDOpen(writer, fileName.c_str());
+		writeMZDBeginVertices(writer, numVertices);
+		std::vector<float> row(3 * res);
+		for (int j = 0; j < res; j++)
+		{
+			for (int i = 0; i < res; i++)
+			{
+				row[3 * i] = (float)i / (float)res;
+				row[3 * i + 1] = 0.1f * sinf(10.0f * row[3 * i]);
+				row[3 * i + 2] = (float)j / (float)res;
+			}
+			writeMZDPositions(writer, row.data(), res);
+		}
+		writeMZDBeginPolygons(writer, numPolygons);
+		std::vector<unsigned char> counts(res - 1, 4);
+		for (int j = 0; j < res - 1; j++)
+			writeMZDPolygonCounts(writer, counts.data(), counts.size());
+		std::vector<int> quads(4 * (res - 1));
+		for (int j = 0; j < res - 1; j++)
+		{
+			for (int i = 0; i < res - 1; i++)
+			{
+				quads[4 * i] = j * res + i;
+				quads[4 * i + 1] = j * res + i + 1;
+				quads[4 * i + 2] = (j + 1) * res + i + 1;
+				quads[4 * i + 3] = (j + 1) * res + i;
+			}
+			writeMZDPolygonIndices(writer, quads.data(), quads.size());
+		}
+		writeMZDEndChunk(writer);
+
+		// normals (0, 1, 0)
+		writeMZDBeginAttribute(writer, 0xDA7A0001);
+		for (int j = 0; j < res; j++)
+		{
+			for (int i = 0; i < res; i++)
+			{
+				row[3 * i] = 0.0f;
+				row[3 * i + 1] = 1.0f;
+				row[3 * i + 2] = 0.0f;
+			}
+			writeMZDAttribute(writer, row.data(), res);
+		}
+		writeMZDEndChunk(writer);
+		return writeMZDClose(writer) == 0;
+	}
+
+	/** Reference implementation: reads the vertex chunk with one fread() per vertex and per polygon
+	  * as done by readMZD before the arrays were read in bulk.
+	  */
+	bool readPerElement(const std::string &fileName, std::vector<float> &positions, std::vector<int> &indices)
+	{
+		FILE *stream = fopen(fileName.c_str(), "rb");
+		if (!stream)
+			return false;
+		bool ok = fseek(stream, 24, SEEK_SET) == 0;
+		while (ok)
+		{
+			unsigned int chunkID, chunkSize;
+			char chunkName[24];
+			if ((fread(&chunkID, 4, 1, stream) != 1) || (fread(chunkName, 1, 24, stream) != 24) || (fread(&chunkSize, 4, 1, stream) != 1))
+				break;
+			if (chunkID != 0x0ABC0001)
+			{
+				ok = fseek(stream, chunkSize, SEEK_CUR) == 0;
+				continue;
+			}
+			int numVertices, numPolygons, numBytesPerIndex;
+			ok = fread(&numVertices, 4, 1, stream) == 1;
+			positions.resize(3 * (size_t)numVertices);
+			float *v = positions.data();
+			for (int i = 0; ok && (i < numVertices); i++, v += 3)
+				ok = fread(v, 4, 3, stream) == 3;
+			ok = ok && (fread(&numPolygons, 4, 1, stream) == 1);
+			std::vector<unsigned char> counts(numPolygons);
+			ok = ok && (fread(counts.data(), 1, numPolygons, stream) == (size_t)numPolygons);
+			ok = ok && (fread(&numBytesPerIndex, 4, 1, stream) == 1) && ((numBytesPerIndex == 4) || (numBytesPerIndex == 2));
+			size_t numNodes = 0;
+			for (int i = 0; i < numPolygons; i++)
+				numNodes += counts[i];
+			indices.resize(numNodes);
+			int *pvi = indices.data();
+			for (int i = 0; ok && (i < numPolygons); i++)
+			{
+				if (numBytesPerIndex == 4)
+					ok = fread(pvi, 4, counts[i], stream) == counts[i];
+				else
+				{
+					for (int j = 0; ok && (j < counts[i]); j++)
+					{
+						unsigned short index;
+						ok = fread(&index, 2, 1, stream) == 1;
+						pvi[j] = index;
+					}
+				}
+				pvi += counts[i];
+			}
+			break;
+		}
+		fclose(stream);
+		return ok;
+	}
+
+	template<class Fct>
+	double timeMin(Fct fct, const unsigned int repetitions)
+	{
+		double best = 1.0e30;
+		for (unsigned int r = 0; r < repetitions; r++)
+		{
+			const auto start = std::chrono::high_resolution_clock::now();
+			fct();
+			const auto stop = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double>(stop - start).count());
+		}
+		return best;
+	}
+
+	struct MZDData
+	{
+		int numVertices = 0, numPolygons = 0, numNodes = 0;
+		float *vertPositions = nullptr;
+		unsigned char *polyVIndicesNum = nullptr;
+		int *polyVIndices = nullptr;
+
+		void clear()
+		{
+			free(vertPositions);
+			free(polyVIndicesNum);
+			free(polyVIndices);
+			*this = MZDData();
+		}
+	};
+}
+
+int main(int argc, char *argv[])
+{
+	const int numVertices = (argc > 1) ? atoi(argv[1]) : 10000000;
+	const unsigned int repetitions = (argc > 2) ? (unsigned int)atoi(argv[2]) : 3;
+	const int res = std::max(2, (int)sqrt((double)numVertices));
+	const std::string fileName = "MZDBenchmark_grid.mzd";
+
+	if (!writeGrid(fileName, res))
+	{
+		fprintf(stderr, "Failed to write file: %s\n", fileName.c_str());
+		return -1;
+	}
+
+	std::vector<float> refPositions;
+	std::vector<int> refIndices;
+	const double t0 = timeMin([&]() { readPerElement(fileName, refPositions, refIndices); }, repetitions);
+
+	MZDData d1, d2;
+	int ret1 = 0, ret2 = 0;
+	const double t1 = timeMin([&]()
+	{
+		d1.clear();
+		ret1 = readMZD(fileName.c_str(), d1.numVertices, d1.numPolygons, d1.numNodes, &d1.vertPositions, &d1.polyVIndicesNum, &d1.polyVIndices);
+	}, repetitions);
+	const double t2 = timeMin([&]()
+	{
+		d2.clear();
+		Utilities::MemoryMappedFile file(fileName);
+		ret2 = readMZDFromMemory(file.data(), file.size(), d2.numVertices, d2.numPolygons, d2.numNodes, &d2.vertPositions, &d2.polyVIndicesNum, &d2.polyVIndices);
+	}, repetitions);
+	std::vector<float> positions3;
+	std::vector<int> counts3, indices3;
+	int ret3 = 0;
+	const double t3 = timeMin([&]()
+	{
+		Utilities::MemoryMappedFile file(fileName);
+		MZDInfo info;
+		ret3 = readMZDInfoFromMemory(file.data(), file.size(), info);
+		if (ret3 != 0)
+			return;
+		positions3.resize(3 * (size_t)info.numVertices);
+		counts3.resize(info.numPolygons);
+		indices3.resize(info.numNodes);
+		MZDBuffers buffers = {};
+		buffers.vertPositions = positions3.data();
+		buffers.polyVIndicesNum = counts3.data();
+		buffers.polyVIndices = indices3.data();
+		ret3 = readMZDDataFromMemory(file.data(), file.size(), info, buffers);
+	}, repetitions);
+	remove(fileName.c_str());
+
+	const bool identical = (ret1 == 0) && (ret2 == 0) && (refPositions.size() == 3 * (size_t)d1.numVertices) && (refIndices.size() == (size_t)d1.numNodes) &&
+		(memcmp(refPositions.data(), d1.vertPositions, refPositions.size() * sizeof(float)) == 0) &&
+		(memcmp(refIndices.data(), d1.polyVIndices, refIndices.size() * sizeof(int)) == 0) &&
+		(memcmp(d1.vertPositions, d2.vertPositions, refPositions.size() * sizeof(float)) == 0) &&
+		(memcmp(d1.polyVIndices, d2.polyVIndices, refIndices.size() * sizeof(int)) == 0) &&
+		(ret3 == 0) && (positions3 == refPositions) && (indices3 == refIndices) &&
+		(counts3.size() == (size_t)d1.numPolygons) && std::equal(counts3.begin(), counts3.end(), d1.polyVIndicesNum);
+
+	printf("file: %d vertices, %d quads\n", d1.numVertices, d1.numPolygons);
+	printf("per-element fread:                     %8.3f s\n", t0);
+	printf("readMZD:                               %8.3f s  (speedup %.1fx)\n", t1, t0 / t1);
+	printf("readMZDFromMemory (mapped file):       %8.3f s  (speedup %.1fx)\n", t2, t0 / t2);
+	printf("readMZDInfo/DataFromMemory (two pass): %8.3f s  (speedup %.1fx)\n", t3, t0 / t3);
+	printf("results identical: %s\n", identical ? "yes" : "NO");
+	d1.clear();
+	d2.clear();
+	return identical ? 0 : 1;
+}
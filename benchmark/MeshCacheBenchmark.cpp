@@ -0,0 +1,182 @@
+// Benchmark of the MTC mesh cache format (src/MeshCacheFile.h). A quad grid
+// with the requested number of vertices (default 4M) with normals and colors
+// is written as MZD and binary PLY file. Both files are read with
+// MeshReader, converted to MTC files with MeshCacheFile::write() and read
+// back. The MTC meshes must be identical to the meshes of the source files,
+// and the positions and faces must be identical to the generated grid. The
+// loading times of all formats are compared, with and without normals and
+// colors.
+//
+// Usage: MeshCacheBenchmark [numVertices] [repetitions]
+
+#include "src/MeshReader.h"
+#include "src/MeshCacheFile.h"
+#include "extern/mzd/writeMZD.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace
+{
+	/** res x res quad grid with normals and colors. */
+	Utilities::MeshData createGrid(const int res)
+	{
+		Utilities::MeshData m;
+		for (int j = 0; j < res; j++)
+		{
+			for (int i = 0; i < res; i++)
+			{
+				const float u = (float)i / (float)res;
+				const float p[4] = { u, 0.1f * sinf(10.0f * u), (float)j / (float)res, 1.0f };
+				const float n[3] = { 0.0f, 1.0f, 0.0f };
+				const float c[4] = { (float)(i % 256) / 255.0f, (float)(j % 256) / 255.0f, 0.0f, 1.0f };
+				m.positions.insert(m.positions.end(), p, p + 4);
+				m.normals.insert(m.normals.end(), n, n + 3);
+				m.colors.insert(m.colors.end(), c, c + 4);
+			}
+		}
+		for (int j = 0; j < res - 1; j++)
+		{
+			for (int i = 0; i < res - 1; i++)
+			{
+				m.counts.push_back(4);
+				m.connects.push_back(j * res + i);
+				m.connects.push_back(j * res + i + 1);
+				m.connects.push_back((j + 1) * res + i + 1);
+				m.connects.push_back((j + 1) * res + i);
+			}
+		}
+		m.topologyHash = m.computeTopologyHash();
+		return m;
+	}
+
+	bool writeMZDFile(const std::string &fileName, const Utilities::MeshData &m)
+	{
+		const int n = m.numVertices();
+		std::vector<float> x(3 * (size_t)n);
+		for (int i = 0; i < n; i++)
+			for (int k = 0; k < 3; k++)
+				x[3 * i + k] = m.positions[4 * i + k];
+		std::vector<unsigned char> counts(m.counts.begin(), m.counts.end());
+		return writeMZD(fileName.c_str(), n, m.numPolygons(), x.data(), counts.data(), m.connects.data(),
+			m.normals.data(), NULL, m.colors.data()) == 0;
+	}
+
+	template<class T>
+	void put(std::string &out, const T value)
+	{
+		out.append((const char*)&value, sizeof(T));
+	}
+
+	bool writePLYFile(const std::string &fileName, const Utilities::MeshData &m)
+	{
+		const int n = m.numVertices();
+		std::string data = "ply\nformat binary_little_endian 1.0\nelement vertex " + std::to_string(n) +
+			"\nproperty float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\n"
+			"property uchar red\nproperty uchar green\nproperty uchar blue\nelement face " + std::to_string(m.numPolygons()) +
+			"\nproperty list uchar int vertex_indices\nend_header\n";
+		for (int i = 0; i < n; i++)
+		{
+			for (int k = 0; k < 3; k++)
+				put(data, m.positions[4 * i + k]);
+			for (int k = 0; k < 3; k++)
+				put(data, m.normals[3 * i + k]);
+			for (int k = 0; k < 3; k++)
+				put(data, (unsigned char)lroundf(255.0f * m.colors[4 * i + k]));
+		}
+		size_t index = 0;
+		for (int count : m.counts)
+		{
+			put(data, (unsigned char)count);
+			for (int k = 0; k < count; k++)
+				put(data, (int32_t)m.connects[index++]);
+		}
+		FILE *file = fopen(fileName.c_str(), "wb");
+		if (!file)
+			return false;
+		const bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+		return (fclose(file) == 0) && ok;
+	}
+
+	bool equal(const Utilities::MeshData &a, const Utilities::MeshData &b)
+	{
+		return (a.positions == b.positions) && (a.counts == b.counts) && (a.connects == b.connects) &&
+			(a.normals == b.normals) && (a.colors == b.colors) && (a.topologyHash == b.topologyHash);
+	}
+
+	template<class Fct>
+	double timeMin(Fct fct, const unsigned int repetitions)
+	{
+		double best = 1.0e30;
+		for (unsigned int r = 0; r < repetitions; r++)
+		{
+			const auto start = std::chrono::high_resolution_clock::now();
+			fct();
+			const auto stop = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double>(stop - start).count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const int numVertices = (argc > 1) ? atoi(argv[1]) : 4000000;
+	const unsigned int repetitions = (argc > 2) ? (unsigned int)atoi(argv[2]) : 3;
+	const int res = std::max(2, (int)sqrt((double)numVertices));
+	const Utilities::MeshData grid = createGrid(res);
+	printf("file: %d vertices, %d quads\n", grid.numVertices(), grid.numPolygons());
+
+	if (!writeMZDFile("MeshCacheBenchmark.mzd", grid) || !writePLYFile("MeshCacheBenchmark.ply", grid))
+	{
+		fprintf(stderr, "Failed to write the source files.\n");
+		return -1;
+	}
+
+	bool allIdentical = true;
+	const char *formats[] = { "mzd", "ply" };
+	for (const char *format : formats)
+	{
+		const std::string sourceFile = std::string("MeshCacheBenchmark.") + format;
+		const std::string cacheFile = std::string("MeshCacheBenchmark_") + format + ".mtc";
+		std::string error;
+
+		Utilities::MeshData source, cached, sourcePositions, cachedPositions;
+		bool sourceOk = false, cachedOk = false, sourcePositionsOk = false, cachedPositionsOk = false;
+		const double tSource = timeMin([&]() { sourceOk = Utilities::MeshReader::read(sourceFile, false, source, error); }, repetitions);
+		const double tSourcePositions = timeMin([&]() { sourcePositionsOk = Utilities::MeshReader::read(sourceFile, true, sourcePositions, error); }, repetitions);
+		if (!sourceOk || !Utilities::MeshCacheFile::write(cacheFile, source, error))
+		{
+			fprintf(stderr, "%s: %s\n", sourceFile.c_str(), error.c_str());
+			return -1;
+		}
+		const double tCached = timeMin([&]() { cachedOk = Utilities::MeshReader::read(cacheFile, false, cached, error); }, repetitions);
+		const double tCachedPositions = timeMin([&]() { cachedPositionsOk = Utilities::MeshReader::read(cacheFile, true, cachedPositions, error); }, repetitions);
+
+		const bool identical = sourceOk && cachedOk && sourcePositionsOk && cachedPositionsOk &&
+			equal(source, cached) && equal(sourcePositions, cachedPositions) &&
+			(cached.positions == grid.positions) && (cached.counts == grid.counts) && (cached.connects == grid.connects) &&
+			(cached.topologyHash == grid.topologyHash) && cached.hasNormals() && cached.hasColors() &&
+			cachedPositions.normals.empty() && cachedPositions.colors.empty();
+		allIdentical = allIdentical && identical;
+
+		printf("%s\n", format);
+		printf("  %s, all arrays:                %8.3f s\n", format, tSource);
+		printf("  mtc, all arrays:                %8.3f s  (speedup %.1fx)\n", tCached, tSource / tCached);
+		printf("  %s, positions only:            %8.3f s\n", format, tSourcePositions);
+		printf("  mtc, positions only:            %8.3f s  (speedup %.1fx)\n", tCachedPositions, tSourcePositions / tCachedPositions);
+		printf("  results identical: %s\n", identical ? "yes" : "NO");
+	}
+
+	remove("MeshCacheBenchmark.mzd");
+	remove("MeshCacheBenchmark.ply");
+	remove("MeshCacheBenchmark_mzd.mtc");
+	remove("MeshCacheBenchmark_ply.mtc");
+	return allIdentical ? 0 : 1;
+}
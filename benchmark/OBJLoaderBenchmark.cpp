@@ -0,0 +1,278 @@
+// Benchmark of the OBJ parser. A synthetic triangle mesh is written to a
+// temporary file and loaded with the previous std::stringstream based loader
+// and with OBJLoader::loadObj. The throughput is reported in lines/second.
+// Large files are parsed with one and with all hardware threads.
+//
+// Usage: OBJLoaderBenchmark [gridResolution] [repetitions]
+
+#include "src/OBJLoader.h"
+#include "src/StringTools.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+using namespace Utilities;
+using Vec3f = OBJLoader::Vec3f;
+using Vec2f = OBJLoader::Vec2f;
+
+namespace
+{
+	/** Vertex indices of a triangle of the previous loader, which only supports triangulated meshes. */
+	struct MeshFaceIndices
+	{
+		int posIndices[3];
+		int texIndices[3];
+		int normalIndices[3];
+	};
+
+	/** Reference implementation: the loader used before the byte buffer parser (one stringstream and
+	  * several std::string objects per line).
+	  */
+	void loadObjStringStream(const std::string &filename, std::vector<Vec3f> *x, std::vector<MeshFaceIndices> *faces, std::vector<Vec3f> *normals, std::vector<Vec2f> *texcoords, const Vec3f &scale)
+	{
+		//std::cout << "Loading " << filename << "\n";
+		
+		std::ifstream filestream;
+		filestream.open(filename.c_str());
+		if (filestream.fail())
+		{
+			std::cerr << "Failed to open file: " << filename << "\n";
+			return;
+		}
+
+		std::string line_stream;
+		bool vt = false;
+		bool vn = false;
+
+		std::vector<std::string> pos_buffer;
+		std::vector<std::string> f_buffer;
+
+		while (getline(filestream, line_stream))
+		{
+			std::stringstream str_stream(line_stream);
+			std::string type_str;
+			str_stream >> type_str;
+
+			if (type_str == "v")
+			{
+				Vec3f pos;
+				pos_buffer.clear();
+				std::string parse_str = line_stream.substr(line_stream.find("v") + 1);
+				StringTools::tokenize(parse_str, pos_buffer);
+				for (unsigned int i = 0; i < 3; i++)
+					pos[i] = stof(pos_buffer[i]) * scale[i];
+
+				x->push_back(pos);
+			}
+			else if (type_str == "vt")
+			{
+				if (texcoords != nullptr)
+				{
+					Vec2f tex;
+					pos_buffer.clear();
+					std::string parse_str = line_stream.substr(line_stream.find("vt") + 2);
+					StringTools::tokenize(parse_str, pos_buffer);
+					for (unsigned int i = 0; i < 2; i++)
+						tex[i] = stof(pos_buffer[i]);
+
+					texcoords->push_back(tex);
+					vt = true;
+				}
+			}
+			else if (type_str == "vn")
+			{
+				if (normals != nullptr)
+				{
+					Vec3f nor;
+					pos_buffer.clear();
+					std::string parse_str = line_stream.substr(line_stream.find("vn") + 2);
+					StringTools::tokenize(parse_str, pos_buffer);
+					for (unsigned int i = 0; i < 3; i++)
+						nor[i] = stof(pos_buffer[i]);
+
+					normals->push_back(nor);
+					vn = true;
+				}
+			}
+			else if (type_str == "f")
+			{
+				MeshFaceIndices faceIndex;
+				if (vn && vt)
+				{
+					f_buffer.clear();
+					std::string parse_str = line_stream.substr(line_stream.find("f") + 1);
+					StringTools::tokenize(parse_str, f_buffer);
+					for (int i = 0; i < 3; ++i)
+					{
+						pos_buffer.clear();
+						StringTools::tokenize(f_buffer[i], pos_buffer, "/");
+						faceIndex.posIndices[i] = stoi(pos_buffer[0]);
+						faceIndex.texIndices[i] = stoi(pos_buffer[1]);
+						faceIndex.normalIndices[i] = stoi(pos_buffer[2]);
+					}
+				}
+				else if (vn)
+				{
+					f_buffer.clear();
+					std::string parse_str = line_stream.substr(line_stream.find("f") + 1);
+					StringTools::tokenize(parse_str, f_buffer);
+					for (int i = 0; i < 3; ++i)
+					{
+						pos_buffer.clear();
+						StringTools::tokenize(f_buffer[i], pos_buffer, "/");
+						faceIndex.posIndices[i] = stoi(pos_buffer[0]);
+
+						// Check if the vertex normal indices were found in the file
+						if (pos_buffer.size() > 1)
+							faceIndex.normalIndices[i] = stoi(pos_buffer[1]);
+						else
+						{
+							vn = false;
+							normals->clear();
+						}
+					}
+				}
+				else if (vt)
+				{
+					f_buffer.clear();
+					std::string parse_str = line_stream.substr(line_stream.find("f") + 1);
+					StringTools::tokenize(parse_str, f_buffer);
+					for (int i = 0; i < 3; ++i)
+					{
+						pos_buffer.clear();
+						StringTools::tokenize(f_buffer[i], pos_buffer, "/");
+						faceIndex.posIndices[i] = stoi(pos_buffer[0]);
+						faceIndex.texIndices[i] = stoi(pos_buffer[1]);
+					}
+				}
+				else
+				{
+					f_buffer.clear();
+					std::string parse_str = line_stream.substr(line_stream.find("f") + 1);
+					StringTools::tokenize(parse_str, f_buffer);
+					for (int i = 0; i < 3; ++i)
+					{
+						faceIndex.posIndices[i] = stoi(f_buffer[i]);
+					}
+				}
+				faces->push_back(faceIndex);
+			}
+		}
+		filestream.close();
+	}
+
+	/** Write a triangulated grid with per-vertex normals. Returns the number of lines. */
+	size_t writeGrid(const std::string &fileName, const unsigned int res)
+	{
+		FILE *f = fopen(fileName.c_str(), "w");
+		if (!f)
+			return 0;
+		size_t lines = 0;
+		for (unsigned int j = 0; j <= res; j++)
+		{
+			for (unsigned int i = 0; i <= res; i++)
+			{
+				const float x = (float)i / (float)res;
+				const float z = (float)j / (float)res;
+				fprintf(f, "v %.6f %.6f %.6f\n", x, 0.1f * sinf(10.0f * x) * cosf(7.0f * z), z);
+				lines++;
+			}
+		}
+		for (unsigned int j = 0; j <= res; j++)
+		{
+			for (unsigned int i = 0; i <= res; i++)
+			{
+				fprintf(f, "vn %.6f %.6f %.6f\n", 0.0f, 1.0f, 0.0f);
+				lines++;
+			}
+		}
+		for (unsigned int j = 0; j < res; j++)
+		{
+			for (unsigned int i = 0; i < res; i++)
+			{
+				const unsigned int v0 = j * (res + 1) + i + 1;
+				const unsigned int v1 = v0 + 1;
+				const unsigned int v2 = v0 + res + 1;
+				const unsigned int v3 = v2 + 1;
+				fprintf(f, "f %u//%u %u//%u %u//%u\n", v0, v0, v1, v1, v3, v3);
+				fprintf(f, "f %u//%u %u//%u %u//%u\n", v0, v0, v3, v3, v2, v2);
+				lines += 2;
+			}
+		}
+		fclose(f);
+		return lines;
+	}
+
+	template<class Faces, class LoadFct>
+	double timeLoad(LoadFct load, const std::string &fileName, const unsigned int repetitions, std::vector<Vec3f> &x, Faces &faces, std::vector<Vec3f> &normals)
+	{
+		double best = 1.0e30;
+		for (unsigned int r = 0; r < repetitions; r++)
+		{
+			x.clear();
+			faces.clear();
+			normals.clear();
+			const auto start = std::chrono::high_resolution_clock::now();
+			load(fileName, &x, &faces, &normals, nullptr, { 1.0f, 1.0f, 1.0f });
+			const auto stop = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double>(stop - start).count());
+		}
+		return best;
+	}
+
+	/** Compare the one based triangles of the reference loader with the zero based polygons of OBJLoader. */
+	bool sameFaces(const std::vector<MeshFaceIndices> &triangles, const ObjFaces &faces)
+	{
+		if ((faces.counts.size() != triangles.size()) || (faces.posIndices.size() != 3 * triangles.size()))
+			return false;
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			if (faces.counts[i] != 3)
+				return false;
+			for (size_t j = 0; j < 3; j++)
+			{
+				if ((faces.posIndices[3 * i + j] != triangles[i].posIndices[j] - 1) ||
+					(faces.normalIndices[3 * i + j] != triangles[i].normalIndices[j] - 1))
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned int res = (argc > 1) ? (unsigned int)atoi(argv[1]) : 1000;
+	const unsigned int repetitions = (argc > 2) ? (unsigned int)atoi(argv[2]) : 3;
+	const std::string fileName = "OBJLoaderBenchmark_grid.obj";
+
+	const size_t lines = writeGrid(fileName, res);
+	if (lines == 0)
+	{
+		std::cerr << "Failed to write file: " << fileName << "\n";
+		return -1;
+	}
+
+	std::vector<Vec3f> x0, n0, x1, n1, x2, n2;
+	std::vector<MeshFaceIndices> f0;
+	ObjFaces f1, f2;
+	const double t0 = timeLoad(loadObjStringStream, fileName, repetitions, x0, f0, n0);
+	const double t1 = timeLoad([](const std::string &fn, std::vector<Vec3f> *x, ObjFaces *f, std::vector<Vec3f> *n, std::vector<Vec2f> *t, const Vec3f &s)
+		{ OBJLoader::loadObj(fn, x, f, n, t, s, 1); }, fileName, repetitions, x1, f1, n1);
+	const double t2 = timeLoad([](const std::string &fn, std::vector<Vec3f> *x, ObjFaces *f, std::vector<Vec3f> *n, std::vector<Vec2f> *t, const Vec3f &s)
+		{ OBJLoader::loadObj(fn, x, f, n, t, s, 0); }, fileName, repetitions, x2, f2, n2);
+	remove(fileName.c_str());
+
+	const bool identical = (x0 == x1) && (n0 == n1) && sameFaces(f0, f1) && (x1 == x2) && (n1 == n2) && sameFaces(f0, f2);
+
+	printf("file: %u x %u grid, %zu lines, %zu vertices, %zu triangles\n", res, res, lines, x1.size(), f1.counts.size());
+	printf("stringstream loader:   %8.3f s  %12.0f lines/s\n", t0, (double)lines / t0);
+	printf("loadObj (1 thread):    %8.3f s  %12.0f lines/s  (speedup %.1fx)\n", t1, (double)lines / t1, t0 / t1);
+	printf("loadObj (%2u threads):  %8.3f s  %12.0f lines/s  (speedup %.1fx)\n", std::thread::hardware_concurrency(), t2, (double)lines / t2, t0 / t2);
+	printf("results identical: %s\n", identical ? "yes" : "NO");
+	return identical ? 0 : 1;
+}
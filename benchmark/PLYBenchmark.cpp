@@ -0,0 +1,271 @@
+// Benchmark of the binary PLY reader. A quad grid with the requested number of
+// vertices (default 4M) with float positions and normals and uchar colors is
+// written as binary little endian and binary big endian PLY file. The files
+// are read with the previous per-element pattern (one virtual
+// readNext() per property and element) and with happly::PLYData, which reads
+// fixed stride elements in bulk and list elements directly from the stream
+// buffer. A plain copy of the file data is timed as bandwidth limit. All
+// results are compared with the generated mesh. Finally, the conversion of the
+// faces to the flat count/connect arrays needed by Maya is timed for
+// getFaceIndices() (one vector per face) and getFaceIndicesFlat().
+//
+// Usage: PLYBenchmark [numVertices] [repetitions]
+
+#include "extern/happly/happly.h"
+#include "src/MemoryMappedFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace
+{
+	struct Mesh
+	{
+		std::vector<float> x, y, z, nx, ny, nz;
+		std::vector<unsigned char> r, g, b;
+		std::vector<int> faces;		// 4 indices per quad
+	};
+
+	Mesh createGrid(const int res)
+	{
+		Mesh m;
+		for (int j = 0; j < res; j++)
+		{
+			for (int i = 0; i < res; i++)
+			{
+				const float u = (float)i / (float)res;
+				m.x.push_back(u);
+				m.y.push_back(0.1f * sinf(10.0f * u));
+				m.z.push_back((float)j / (float)res);
+				m.nx.push_back(0.0f);
+				m.ny.push_back(1.0f);
+				m.nz.push_back(0.0f);
+				m.r.push_back((unsigned char)i);
+				m.g.push_back((unsigned char)j);
+				m.b.push_back((unsigned char)(i + j));
+			}
+		}
+		for (int j = 0; j < res - 1; j++)
+		{
+			for (int i = 0; i < res - 1; i++)
+			{
+				m.faces.push_back(j * res + i);
+				m.faces.push_back(j * res + i + 1);
+				m.faces.push_back((j + 1) * res + i + 1);
+				m.faces.push_back((j + 1) * res + i);
+			}
+		}
+		return m;
+	}
+
+	template<class T>
+	void put(std::vector<char> &out, T value, const bool bigEndian)
+	{
+		char bytes[sizeof(T)];
+		memcpy(bytes, &value, sizeof(T));
+		if (bigEndian)
+			std::reverse(bytes, bytes + sizeof(T));
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	bool writeFile(const std::string &fileName, const Mesh &m, const std::string &format)
+	{
+		const size_t numVertices = m.x.size();
+		const size_t numFaces = m.faces.size() / 4;
+		std::string header = "ply\nformat " + format + " 1.0\nelement vertex " + std::to_string(numVertices) +
+			"\nproperty float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\n"
+			"property uchar red\nproperty uchar green\nproperty uchar blue\nelement face " + std::to_string(numFaces) +
+			"\nproperty list uchar int vertex_indices\nend_header\n";
+		std::vector<char> data(header.begin(), header.end());
+		const bool bigEndian = format == "binary_big_endian";
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			put(data, m.x[i], bigEndian);
+			put(data, m.y[i], bigEndian);
+			put(data, m.z[i], bigEndian);
+			put(data, m.nx[i], bigEndian);
+			put(data, m.ny[i], bigEndian);
+			put(data, m.nz[i], bigEndian);
+			put(data, m.r[i], bigEndian);
+			put(data, m.g[i], bigEndian);
+			put(data, m.b[i], bigEndian);
+		}
+		for (size_t i = 0; i < numFaces; i++)
+		{
+			put(data, (unsigned char)4, bigEndian);
+			for (int j = 0; j < 4; j++)
+				put(data, m.faces[4 * i + j], bigEndian);
+		}
+		FILE *f = fopen(fileName.c_str(), "wb");
+		if (!f)
+			return false;
+		const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+		fclose(f);
+		return ok;
+	}
+
+	/** Reference implementation: reads the binary data with one readNext() call per property and element
+	  * as done by happly before the bulk paths were added.
+	  */
+	bool readPerElement(const std::string &fileName, const bool bigEndian, Mesh &m)
+	{
+		Utilities::MemoryMappedFile file(fileName);
+		const char *endHeader = strstr(file.data(), "end_header\n");
+		if (!endHeader)
+			return false;
+		const size_t headerSize = endHeader + 11 - file.data();
+		happly::MemoryBuffer buffer(file.data() + headerSize, file.size() - headerSize);
+		std::istream stream(&buffer);
+
+		happly::TypedProperty<float> x("x"), y("y"), z("z"), nx("nx"), ny("ny"), nz("nz");
+		happly::TypedProperty<unsigned char> r("red"), g("green"), b("blue");
+		happly::TypedListProperty<int> faces("vertex_indices", 1);
+		happly::Property *vertexProps[] = { &x, &y, &z, &nx, &ny, &nz, &r, &g, &b };
+		const size_t numVertices = m.x.size();
+		const size_t numFaces = m.faces.size() / 4;
+		for (size_t i = 0; i < numVertices; i++)
+			for (happly::Property *p : vertexProps)
+				bigEndian ? p->readNextBigEndian(stream) : p->readNext(stream);
+		for (size_t i = 0; i < numFaces; i++)
+			bigEndian ? faces.readNextBigEndian(stream) : faces.readNext(stream);
+
+		m.x = x.data; m.y = y.data; m.z = z.data;
+		m.nx = nx.data; m.ny = ny.data; m.nz = nz.data;
+		m.r = r.data; m.g = g.data; m.b = b.data;
+		m.faces = faces.flattenedData;
+		return stream.good();
+	}
+
+	bool readHapply(happly::PLYData &ply, Mesh &m)
+	{
+		happly::Element &vertex = ply.getElement("vertex");
+		m.x = vertex.getPropertyTypeRef<float>("x");
+		m.y = vertex.getPropertyTypeRef<float>("y");
+		m.z = vertex.getPropertyTypeRef<float>("z");
+		m.nx = vertex.getPropertyTypeRef<float>("nx");
+		m.ny = vertex.getPropertyTypeRef<float>("ny");
+		m.nz = vertex.getPropertyTypeRef<float>("nz");
+		m.r = vertex.getPropertyTypeRef<unsigned char>("red");
+		m.g = vertex.getPropertyTypeRef<unsigned char>("green");
+		m.b = vertex.getPropertyTypeRef<unsigned char>("blue");
+		std::vector<int32_t> counts;
+		ply.getFaceIndicesFlat(counts, m.faces);
+		return std::all_of(counts.begin(), counts.end(), [](int32_t c) { return c == 4; });
+	}
+
+	bool equal(const Mesh &a, const Mesh &b)
+	{
+		return (a.x == b.x) && (a.y == b.y) && (a.z == b.z) && (a.nx == b.nx) && (a.ny == b.ny) && (a.nz == b.nz) &&
+			(a.r == b.r) && (a.g == b.g) && (a.b == b.b) && (a.faces == b.faces);
+	}
+
+	template<class Fct>
+	double timeMin(Fct fct, const unsigned int repetitions)
+	{
+		double best = 1.0e30;
+		for (unsigned int r = 0; r < repetitions; r++)
+		{
+			const auto start = std::chrono::high_resolution_clock::now();
+			fct();
+			const auto stop = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double>(stop - start).count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const int numVertices = (argc > 1) ? atoi(argv[1]) : 4000000;
+	const unsigned int repetitions = (argc > 2) ? (unsigned int)atoi(argv[2]) : 3;
+	const int res = std::max(2, (int)sqrt((double)numVertices));
+	const Mesh grid = createGrid(res);
+	printf("file: %zu vertices, %zu quads\n", grid.x.size(), grid.faces.size() / 4);
+
+	bool allIdentical = true;
+	const char *formats[] = { "binary_little_endian", "binary_big_endian" };
+	for (const char *format : formats)
+	{
+		const std::string fileName = std::string("PLYBenchmark_") + format + ".ply";
+		if (!writeFile(fileName, grid, format))
+		{
+			fprintf(stderr, "Failed to write file: %s\n", fileName.c_str());
+			return -1;
+		}
+		const bool bigEndian = strcmp(format, "binary_big_endian") == 0;
+
+		// bandwidth limit: copy the mapped file
+		std::vector<char> copy;
+		const double tCopy = timeMin([&]()
+		{
+			Utilities::MemoryMappedFile file(fileName);
+			copy.assign(file.data(), file.end());
+		}, repetitions);
+
+		Mesh reference = grid;
+		bool refOk = false;
+		const double tRef = timeMin([&]() { refOk = readPerElement(fileName, bigEndian, reference); }, repetitions);
+
+		Mesh fromMemory, fromFile;
+		bool memOk = false, fileOk = false;
+		const double tMem = timeMin([&]()
+		{
+			Utilities::MemoryMappedFile file(fileName);
+			happly::PLYData ply(file.data(), file.size());
+			memOk = readHapply(ply, fromMemory);
+		}, repetitions);
+		const double tFile = timeMin([&]()
+		{
+			happly::PLYData ply(fileName);
+			fileOk = readHapply(ply, fromFile);
+		}, repetitions);
+		remove(fileName.c_str());
+
+		const bool identical = refOk && memOk && fileOk && equal(reference, grid) && equal(fromMemory, grid) && equal(fromFile, grid);
+		allIdentical = allIdentical && identical;
+
+		printf("%s (%.1f MB)\n", format, 1.0e-6 * copy.size());
+		printf("  copy of mapped file:              %8.3f s\n", tCopy);
+		printf("  per-element readNext():           %8.3f s\n", tRef);
+		printf("  PLYData from memory:              %8.3f s  (speedup %.1fx)\n", tMem, tRef / tMem);
+		printf("  PLYData from file stream:         %8.3f s  (speedup %.1fx)\n", tFile, tRef / tFile);
+		printf("  results identical: %s\n", identical ? "yes" : "NO");
+
+		if (bigEndian)
+			continue;
+
+		// face conversion
+		if (!writeFile(fileName, grid, format))
+			return -1;
+		Utilities::MemoryMappedFile file(fileName);
+		happly::PLYData ply(file.data(), file.size());
+		std::vector<int> counts, connects, countsFlat, connectsFlat;
+		const double tNested = timeMin([&]()
+		{
+			std::vector<std::vector<size_t>> faces = ply.getFaceIndices<size_t>();
+			counts.clear();
+			connects.clear();
+			for (const std::vector<size_t> &face : faces)
+			{
+				counts.push_back((int)face.size());
+				for (size_t index : face)
+					connects.push_back((int)index);
+			}
+		}, repetitions);
+		const double tFlat = timeMin([&]() { ply.getFaceIndicesFlat(countsFlat, connectsFlat); }, repetitions);
+		file.close();
+		remove(fileName.c_str());
+		const bool facesIdentical = (counts == countsFlat) && (connects == connectsFlat) && (connectsFlat == grid.faces);
+		allIdentical = allIdentical && facesIdentical;
+		printf("faces to flat arrays\n");
+		printf("  getFaceIndices():                 %8.3f s\n", tNested);
+		printf("  getFaceIndicesFlat():             %8.3f s  (speedup %.1fx)\n", tFlat, tNested / tFlat);
+		printf("  results identical: %s\n", facesIdentical ? "yes" : "NO");
+	}
+	return allIdentical ? 0 : 1;
+}
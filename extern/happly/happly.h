@@ -47,8 +47,10 @@ SOFTWARE.
 */
 // clang-format on
 
+#include <algorithm>
 #include <array>
 #include <cctype>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <limits>
@@ -161,6 +163,60 @@ public:
    */
   virtual void readNextBigEndian(std::istream& stream) = 0;
 
+  /**
+   * @brief (binary reading) Size in bytes of one value of this property. List properties return 0, since their size
+   * varies per element.
+   *
+   * @return Size in bytes, or 0.
+   */
+  virtual size_t fixedByteSize() { return 0; }
+
+  /**
+   * @brief (binary reading) Append the values of count elements from a block of memory, in which consecutive values of
+   * this property are stride bytes apart. Only supported by properties with fixedByteSize() > 0.
+   *
+   * @param block Pointer to the value of the first element.
+   * @param count Number of elements.
+   * @param stride Distance in bytes between the values of consecutive elements.
+   * @param bigEndian Whether the values are stored big endian.
+   */
+  virtual void readStrided(const char* /*block*/, size_t /*count*/, size_t /*stride*/, bool /*bigEndian*/) {
+    throw std::runtime_error("PLY parser: property " + name + " does not support strided reading");
+  }
+
+  /**
+   * @brief (binary reading) Read the values of count consecutive elements, assuming this is the only property of the
+   * element.
+   *
+   * @param stream Stream to read from.
+   * @param count Number of elements.
+   * @param bigEndian Whether the values are stored big endian.
+   */
+  virtual void readAll(std::istream& stream, size_t count, bool bigEndian) {
+    for (size_t iEntry = 0; iEntry < count; iEntry++) {
+      if (bigEndian) {
+        readNextBigEndian(stream);
+      } else {
+        readNext(stream);
+      }
+    }
+  }
+
+  /**
+   * @brief (binary reading) Read the values of count consecutive elements from a block of memory, assuming this is the
+   * only property of the element. Only supported by list properties.
+   *
+   * @param data Pointer to the first element.
+   * @param size Number of bytes available at data.
+   * @param count Number of elements.
+   * @param bigEndian Whether the values are stored big endian.
+   *
+   * @return Number of bytes read.
+   */
+  virtual size_t readAllInPlace(const char* /*data*/, size_t /*size*/, size_t /*count*/, bool /*bigEndian*/) {
+    throw std::runtime_error("PLY parser: property " + name + " does not support in place reading");
+  }
+
   /**
    * @brief (reading) Write a header entry for this property.
    *
@@ -340,6 +396,34 @@ public:
     data.back() = swapEndian(data.back());
   }
 
+  /**
+   * @brief (binary reading) Size in bytes of one value.
+   */
+  virtual size_t fixedByteSize() override { return sizeof(T); }
+
+  /**
+   * @brief (binary reading) Append the values of count elements which are stride bytes apart in a block of memory.
+   *
+   * @param block Pointer to the value of the first element.
+   * @param count Number of elements.
+   * @param stride Distance in bytes between the values of consecutive elements.
+   * @param bigEndian Whether the values are stored big endian.
+   */
+  virtual void readStrided(const char* block, size_t count, size_t stride, bool bigEndian) override {
+    if (count == 0) return;
+    size_t currSize = data.size();
+    data.resize(currSize + count);
+    T* out = &data[currSize];
+    for (size_t i = 0; i < count; i++) {
+      std::memcpy(&out[i], block + i * stride, sizeof(T));
+    }
+    if (bigEndian) {
+      for (size_t i = 0; i < count; i++) {
+        out[i] = swapEndian(out[i]);
+      }
+    }
+  }
+
   /**
    * @brief (reading) Write a header entry for this property.
    *
@@ -532,6 +616,122 @@ public:
     }
   }
 
+  /**
+   * @brief (binary reading) Read the lists of count consecutive elements directly from the stream buffer, which avoids
+   * the per-element overhead of std::istream::read().
+   *
+   * @param stream Stream to read from.
+   * @param count Number of elements.
+   * @param bigEndian Whether the values are stored big endian.
+   */
+  virtual void readAll(std::istream& stream, size_t count, bool bigEndian) override {
+
+    std::streambuf* buf = stream.rdbuf();
+    size_t startSize = flattenedData.size();
+    flattenedIndexStart.reserve(flattenedIndexStart.size() + count);
+    for (size_t iEntry = 0; iEntry < count; iEntry++) {
+
+      // Read the size of the list
+      size_t listCount = 0;
+      if (buf->sgetn((char*)&listCount, listCountBytes) != listCountBytes) {
+        throw std::runtime_error("PLY parser: unexpected end of file in list property " + name);
+      }
+      if (bigEndian) {
+        if (listCountBytes == 8) {
+          listCount = (size_t)swapEndian((uint64_t)listCount);
+        } else if (listCountBytes == 4) {
+          listCount = (size_t)swapEndian((uint32_t)listCount);
+        } else if (listCountBytes == 2) {
+          listCount = (size_t)swapEndian((uint16_t)listCount);
+        }
+      }
+
+      // Read list elements
+      size_t currSize = flattenedData.size();
+      size_t afterSize = currSize + listCount;
+      flattenedData.resize(afterSize);
+      std::streamsize numBytes = (std::streamsize)(listCount * sizeof(T));
+      if (listCount > 0 && buf->sgetn((char*)&flattenedData[currSize], numBytes) != numBytes) {
+        throw std::runtime_error("PLY parser: unexpected end of file in list property " + name);
+      }
+      flattenedIndexStart.emplace_back(afterSize);
+    }
+
+    // Swap endian order of list elements
+    if (bigEndian) {
+      for (size_t iFlat = startSize; iFlat < flattenedData.size(); iFlat++) {
+        flattenedData[iFlat] = swapEndian(flattenedData[iFlat]);
+      }
+    }
+  }
+  /**
+   * @brief (binary reading) Read the lists of count consecutive elements from a block of memory. The list sizes are
+   * scanned first, so that the flattened data is allocated once and filled with one copy per list.
+   *
+   * @param data Pointer to the first element.
+   * @param size Number of bytes available at data.
+   * @param count Number of elements.
+   * @param bigEndian Whether the values are stored big endian.
+   *
+   * @return Number of bytes read.
+   */
+  virtual size_t readAllInPlace(const char* data, size_t size, size_t count, bool bigEndian) override {
+
+    // Scan the list sizes
+    const size_t startSize = flattenedData.size();
+    const size_t startIndex = flattenedIndexStart.size();
+    flattenedIndexStart.reserve(startIndex + count);
+    size_t pos = 0;
+    size_t afterSize = startSize;
+    for (size_t iEntry = 0; iEntry < count; iEntry++) {
+      if (size - pos < (size_t)listCountBytes) {
+        flattenedIndexStart.resize(startIndex);
+        throw std::runtime_error("PLY parser: unexpected end of file in list property " + name);
+      }
+      size_t listCount = 0;
+      std::memcpy(&listCount, data + pos, listCountBytes);
+      if (bigEndian) {
+        if (listCountBytes == 8) {
+          listCount = (size_t)swapEndian((uint64_t)listCount);
+        } else if (listCountBytes == 4) {
+          listCount = (size_t)swapEndian((uint32_t)listCount);
+        } else if (listCountBytes == 2) {
+          listCount = (size_t)swapEndian((uint16_t)listCount);
+        }
+      }
+      pos += listCountBytes;
+      if ((size - pos) / sizeof(T) < listCount) {
+        flattenedIndexStart.resize(startIndex);
+        throw std::runtime_error("PLY parser: unexpected end of file in list property " + name);
+      }
+      pos += listCount * sizeof(T);
+      afterSize += listCount;
+      flattenedIndexStart.emplace_back(afterSize);
+    }
+
+    // Copy the lists
+    flattenedData.resize(afterSize);
+    pos = 0;
+    for (size_t iEntry = 0; iEntry < count; iEntry++) {
+      size_t listStart = flattenedIndexStart[startIndex + iEntry - 1];
+      size_t listCount = flattenedIndexStart[startIndex + iEntry] - listStart;
+      pos += listCountBytes;
+      if (listCount > 0) {
+        std::memcpy(&flattenedData[listStart], data + pos, listCount * sizeof(T));
+      }
+      pos += listCount * sizeof(T);
+    }
+
+    // Swap endian order of list elements
+    if (bigEndian) {
+      for (size_t iFlat = startSize; iFlat < afterSize; iFlat++) {
+        flattenedData[iFlat] = swapEndian(flattenedData[iFlat]);
+      }
+    }
+    return pos;
+  }
+
+
   /**
    * @brief (reading) Write a header entry for this property. Note that we already use "uchar" for the list count type.
    *
@@ -953,6 +1153,30 @@ public:
                              ". Has type " + prop->propertyTypeName());
   }
 
+  /**
+   * @brief Get a reference to the data of a property for this element, without copying it. Like getPropertyType(),
+   * only returns if the ply record contains a type that matches T exactly. Throws if requested data is unavailable.
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   *
+   * @return The data, valid as long as the element.
+   */
+  template <class T>
+  const std::vector<T>& getPropertyTypeRef(const std::string& propertyName) {
+
+    // Find the property
+    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
+    TypedProperty<T>* castedProp = dynamic_cast<TypedProperty<T>*>(prop.get());
+    if (castedProp) {
+      return castedProp->data;
+    }
+
+    // No match, failure
+    throw std::runtime_error("PLY parser: property " + prop->name + " is not of type type " + typeName<T>() +
+                             ". Has type " + prop->propertyTypeName());
+  }
+
   /**
    * @brief Get a vector of lists of data from a property for this element. Automatically promotes to larger types.
    * Throws if requested data is unavailable.
@@ -1040,6 +1264,59 @@ public:
   }
 
 
+  /**
+   * @brief Get the data of an integer list property as flat arrays: the number of entries of each list and all entries
+   * concatenated. Like getListPropertyAnySign(), converts naively from integer types of any size and sign. Unlike it,
+   * needs no per-list allocations and one linear copy of the data. Throws if requested data is unavailable.
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   * @param counts Output, number of entries of each list.
+   * @param flatData Output, the entries of all lists.
+   */
+  template <class T>
+  void getListPropertyFlat(const std::string& propertyName, std::vector<int32_t>& counts, std::vector<T>& flatData) {
+
+    // Find the property
+    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
+
+    if (getFlatFromListProperty<T, int32_t>(prop.get(), counts, flatData) ||
+        getFlatFromListProperty<T, uint32_t>(prop.get(), counts, flatData) ||
+        getFlatFromListProperty<T, int16_t>(prop.get(), counts, flatData) ||
+        getFlatFromListProperty<T, uint16_t>(prop.get(), counts, flatData) ||
+        getFlatFromListProperty<T, int8_t>(prop.get(), counts, flatData) ||
+        getFlatFromListProperty<T, uint8_t>(prop.get(), counts, flatData)) {
+      return;
+    }
+
+    // No match, failure
+    throw std::runtime_error("PLY parser: list property " + prop->name + " is not of an integer type. Has type " +
+                             prop->propertyTypeName());
+  }
+
+  /**
+   * @brief Get the data of a list property with entries of type T as flat arrays, see getListPropertyFlat(). Unlike
+   * it, no type conversion is done, so it can be used for lists of floating point values. Throws if requested data is
+   * unavailable.
+   *
+   * @tparam T The type of data requested
+   * @param propertyName The name of the property to get.
+   * @param counts Output, number of entries of each list.
+   * @param flatData Output, the entries of all lists.
+   */
+  template <class T>
+  void getListPropertyTypeFlat(const std::string& propertyName, std::vector<int32_t>& counts, std::vector<T>& flatData) {
+
+    std::unique_ptr<Property>& prop = getPropertyPtr(propertyName);
+
+    if (getFlatFromListProperty<T, T>(prop.get(), counts, flatData)) {
+      return;
+    }
+
+    throw std::runtime_error("PLY parser: list property " + prop->name + " does not have the requested type. Has type " +
+                             prop->propertyTypeName());
+  }
+
   /**
    * @brief Performs sanity checks on the element, throwing if any fail.
    */
@@ -1133,6 +1410,35 @@ public:
   }
 
 
+  /**
+   * @brief Helper function for getListPropertyFlat(), which copies the flattened data if the property is a list of type
+   * T.
+   *
+   * @tparam D The desired output type
+   * @tparam T The attempt for the actual type of the property
+   * @param prop The property to get (does not delete nor share pointer)
+   * @param counts Output, number of entries of each list.
+   * @param flatData Output, the entries of all lists.
+   *
+   * @return Whether the property has type T.
+   */
+  template <class D, class T>
+  bool getFlatFromListProperty(Property* prop, std::vector<int32_t>& counts, std::vector<D>& flatData) {
+
+    TypedListProperty<T>* castedProp = dynamic_cast<TypedListProperty<T>*>(prop);
+    if (!castedProp) {
+      return false;
+    }
+
+    const std::vector<size_t>& indexStart = castedProp->flattenedIndexStart;
+    counts.resize(indexStart.size() - 1);
+    for (size_t i = 0; i < counts.size(); i++) {
+      counts[i] = (int32_t)(indexStart[i + 1] - indexStart[i]);
+    }
+    flatData.assign(castedProp->flattenedData.begin(), castedProp->flattenedData.end());
+    return true;
+  }
+
   /**
    * @brief Helper function which does the hard work to implement type promotion for data getters. Throws if type
    * conversion fails.
@@ -1261,6 +1567,64 @@ inline bool startsWith(const std::string& input, const std::string& query) {
 }; // namespace
 
 
+/**
+ * @brief Read-only stream buffer on top of a block of memory (e.g. a memory mapped file). The parser reads the bytes
+ * directly from the block without copying them into an intermediate buffer.
+ */
+class MemoryBuffer : public std::streambuf {
+
+public:
+  MemoryBuffer(const char* data, size_t size) {
+    char* begin = const_cast<char*>(data);
+    setg(begin, begin, begin + size);
+  }
+
+  /**
+   * @brief Skip the next size bytes and return a pointer to them, which stays valid as long as the block.
+   *
+   * @param size Number of bytes.
+   *
+   * @return Pointer to the bytes, or nullptr if fewer bytes are left.
+   */
+  const char* take(size_t size) {
+    if ((size_t)(egptr() - gptr()) < size) {
+      return nullptr;
+    }
+    const char* data = gptr();
+    setg(eback(), gptr() + size, egptr());
+    return data;
+  }
+
+  /**
+   * @brief The bytes which have not been read yet.
+   */
+  const char* current() const { return gptr(); }
+  size_t remaining() const { return (size_t)(egptr() - gptr()); }
+
+protected:
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which = std::ios_base::in) override {
+    char* target = nullptr;
+    if (dir == std::ios_base::beg) {
+      target = eback() + off;
+    } else if (dir == std::ios_base::cur) {
+      target = gptr() + off;
+    } else {
+      target = egptr() + off;
+    }
+    if (!(which & std::ios_base::in) || target < eback() || target > egptr()) {
+      return pos_type(off_type(-1));
+    }
+    setg(eback(), target, egptr());
+    return pos_type(target - eback());
+  }
+
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) override {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+};
+
+
 /**
  * @brief Primary class; represents a set of data in the .ply format.
  */
@@ -1320,6 +1684,30 @@ public:
     }
   }
 
+  /**
+   * @brief Initialize a PLYData by reading from a block of memory, e.g. a memory mapped file. Throws if any failures
+   * occur.
+   *
+   * @param data Pointer to the first byte of the file contents.
+   * @param size Size of the block in bytes.
+   * @param verbose If true, print useful info about the file to stdout
+   */
+  PLYData(const char* data, size_t size, bool verbose = false) {
+
+    using std::cout;
+    using std::endl;
+
+    if (verbose) cout << "PLY parser: Reading ply file from memory" << endl;
+
+    MemoryBuffer buffer(data, size);
+    std::istream inStream(&buffer);
+    parsePLY(inStream, verbose);
+
+    if (verbose) {
+      cout << "  - Finished parsing memory block." << endl;
+    }
+  }
+
   /**
    * @brief Perform sanity checks on the file, throwing if any fail.
    */
@@ -1501,6 +1889,29 @@ public:
     throw std::runtime_error("PLY parser: could not find face vertex indices attribute under any common name.");
   }
 
+  /**
+   * @brief Common-case helper to get face indices for a mesh as flat arrays, as expected by most mesh APIs. Needs no
+   * per-face allocations, see Element::getListPropertyFlat().
+   *
+   * @param counts Output, number of vertices of each face.
+   * @param connects Output, the vertex indices of all faces, concatenated.
+   */
+  template <typename T = int32_t>
+  void getFaceIndicesFlat(std::vector<int32_t>& counts, std::vector<T>& connects) {
+
+    for (const std::string& f : std::vector<std::string>{"face"}) {
+      for (const std::string& p : std::vector<std::string>{"vertex_indices", "vertex_index"}) {
+        try {
+          getElement(f).getListPropertyFlat<T>(p, counts, connects);
+          return;
+        } catch (const std::runtime_error& e) {
+          // that's fine
+        }
+      }
+    }
+    throw std::runtime_error("PLY parser: could not find face vertex indices attribute under any common name.");
+  }
+
 
   /**
    * @brief Common-case helper set mesh vertex positons. Creates vertex element, if necessary.
@@ -1874,14 +2285,7 @@ private:
         std::cout << "  - Processing element: " << elem.name << std::endl;
       }
 
-      for (size_t iP = 0; iP < elem.properties.size(); iP++) {
-        elem.properties[iP]->reserve(elem.count);
-      }
-      for (size_t iEntry = 0; iEntry < elem.count; iEntry++) {
-        for (size_t iP = 0; iP < elem.properties.size(); iP++) {
-          elem.properties[iP]->readNext(inStream);
-        }
-      }
+      parseElementBinary(elem, inStream, false);
     }
   }
 
@@ -1907,12 +2311,78 @@ private:
         std::cout << "  - Processing element: " << elem.name << std::endl;
       }
 
-      for (size_t iP = 0; iP < elem.properties.size(); iP++) {
-        elem.properties[iP]->reserve(elem.count);
+      parseElementBinary(elem, inStream, true);
+    }
+  }
+
+  /**
+   * @brief Read the binary data of one element. Elements whose properties all have a fixed size are read in blocks
+   * and each property extracts its values with a constant stride. Elements with a single list property (e.g. faces)
+   * read their lists directly from the stream buffer. For memory blocks (see MemoryBuffer) both are read in place. All
+   * other elements are read value by value.
+   *
+   * @param elem The element to read.
+   * @param inStream
+   * @param bigEndian Whether the data is stored big endian.
+   */
+  void parseElementBinary(Element& elem, std::istream& inStream, bool bigEndian) {
+
+    for (size_t iP = 0; iP < elem.properties.size(); iP++) {
+      elem.properties[iP]->reserve(elem.count);
+    }
+
+    // Fixed stride?
+    size_t stride = 0;
+    bool fixedStride = !elem.properties.empty();
+    for (size_t iP = 0; iP < elem.properties.size(); iP++) {
+      size_t propSize = elem.properties[iP]->fixedByteSize();
+      fixedStride = fixedStride && (propSize > 0);
+      stride += propSize;
+    }
+
+    if (fixedStride) {
+
+      // Read in place from memory, or block-wise with one read per block
+      MemoryBuffer* memBuffer = dynamic_cast<MemoryBuffer*>(inStream.rdbuf());
+      const size_t blockCount = std::max<size_t>(1, (1 << 20) / stride);
+      std::vector<char> block;
+      for (size_t iStart = 0; iStart < elem.count; iStart += blockCount) {
+        size_t count = std::min(blockCount, elem.count - iStart);
+        const char* data = nullptr;
+        if (memBuffer != nullptr) {
+          data = memBuffer->take(count * stride);
+        } else {
+          block.resize(count * stride);
+          inStream.read(block.data(), count * stride);
+          if ((size_t)inStream.gcount() == count * stride) {
+            data = block.data();
+          }
+        }
+        if (data == nullptr) {
+          throw std::runtime_error("PLY parser: unexpected end of file in element " + elem.name);
+        }
+
+        size_t offset = 0;
+        for (size_t iP = 0; iP < elem.properties.size(); iP++) {
+          elem.properties[iP]->readStrided(data + offset, count, stride, bigEndian);
+          offset += elem.properties[iP]->fixedByteSize();
+        }
       }
+    } else if (elem.properties.size() == 1) {
+      MemoryBuffer* memBuffer = dynamic_cast<MemoryBuffer*>(inStream.rdbuf());
+      if (memBuffer != nullptr) {
+        memBuffer->take(elem.properties[0]->readAllInPlace(memBuffer->current(), memBuffer->remaining(), elem.count, bigEndian));
+      } else {
+        elem.properties[0]->readAll(inStream, elem.count, bigEndian);
+      }
+    } else {
       for (size_t iEntry = 0; iEntry < elem.count; iEntry++) {
         for (size_t iP = 0; iP < elem.properties.size(); iP++) {
-          elem.properties[iP]->readNextBigEndian(inStream);
+          if (bigEndian) {
+            elem.properties[iP]->readNextBigEndian(inStream);
+          } else {
+            elem.properties[iP]->readNext(inStream);
+          }
         }
       }
     }
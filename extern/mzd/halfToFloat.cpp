@@ -0,0 +1,222 @@
+/* ____________________________________________________________________________
+	Conversion between half precision floats and floats, see halfToFloat.h.
+  ____________________________________________________________________________
+*/
+
+#include "halfToFloat.h"
+#include "string.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define MZD_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#endif
+
+// GCC and Clang only emit F16C/AVX instructions in functions which are
+// explicitly compiled for these extensions. MSVC accepts the intrinsics anyway.
+#if defined(MZD_X86) && (defined(__GNUC__) || defined(__clang__))
+	#define MZD_TARGET_F16C __attribute__((target("avx,f16c")))
+#else
+	#define MZD_TARGET_F16C
+#endif
+
+
+// converts a single value by moving exponent and mantissa to their float
+// positions. Denormals are renormalized by a float subtraction, which is exact.
+// All cases are computed and selected without branches, so that compilers
+// can vectorize the loop in mzd_halfToFloatPortable().
+static inline float mzd_halfToFloat1(unsigned short h)
+{
+	const unsigned int shiftedExp = 0x7c00u << 13;		// exponent mask after shift.
+	const unsigned int em  = (h & 0x7fffu) << 13;		// exponent/mantissa bits.
+	const unsigned int exp = em & shiftedExp;			// just the exponent.
+
+	// normalized numbers: exponent adjust.
+	const unsigned int normal = em + ((127 - 15) << 23);
+
+	// Inf/NaN: extra exponent adjust, NaNs become quiet NaNs.
+	const unsigned int quiet  = (0u - (unsigned int)((em & 0x007fe000u) != 0)) & 0x00400000u;
+	const unsigned int infNaN = (normal + ((128 - 16) << 23)) | quiet;
+
+	// zero/denormal: extra exponent adjust and renormalize.
+	const unsigned int magicBits = 113 << 23;
+	unsigned int denormalBits = normal + (1 << 23);
+	float denormal, magic;
+	memcpy(&denormal, &denormalBits, 4);
+	memcpy(&magic, &magicBits, 4);
+	denormal -= magic;
+	memcpy(&denormalBits, &denormal, 4);
+
+	const unsigned int isInfNaN   = 0u - (unsigned int)(exp == shiftedExp);
+	const unsigned int isDenormal = 0u - (unsigned int)(exp == 0);
+	unsigned int o = normal;
+	o = (o & ~isInfNaN)   | (infNaN & isInfNaN);
+	o = (o & ~isDenormal) | (denormalBits & isDenormal);
+	o |= (h & 0x8000u) << 16;							// sign bit.
+
+	float result;
+	memcpy(&result, &o, 4);
+	return result;
+}
+
+
+void mzd_halfToFloatPortable(const unsigned short *in_half, float *out_float, size_t in_count)
+{
+	for (size_t i=0;i<in_count;i++)
+		out_float[i] = mzd_halfToFloat1(in_half[i]);
+}
+
+
+// converts a single value with round to nearest even. Denormal results are
+// rounded by a float addition, which uses the rounding mode of the FPU.
+static inline unsigned short mzd_floatToHalf1(float v)
+{
+	unsigned int f;
+	memcpy(&f, &v, 4);
+	const unsigned int sign = f & 0x80000000u;
+	f ^= sign;
+
+	unsigned int o;
+	if (f >= 0x47800000u)					// >= 65536: Inf or NaN.
+		o = (f > 0x7f800000u) ? (0x7e00u | ((f >> 13) & 0x3ffu)) : 0x7c00u;
+	else if (f < 0x38800000u)				// < 2^-14: zero or denormal.
+	{
+		const unsigned int magicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+		float fv, magic;
+		memcpy(&fv, &f, 4);
+		memcpy(&magic, &magicBits, 4);
+		fv += magic;
+		memcpy(&o, &fv, 4);
+		o -= magicBits;
+	}
+	else									// normalized: adjust exponent and round.
+	{
+		const unsigned int mantOdd = (f >> 13) & 1;
+		f += ((unsigned int)(15 - 127) << 23) + 0xfffu;
+		f += mantOdd;
+		o = f >> 13;						// overflows to Inf if necessary.
+	}
+	return (unsigned short)(o | (sign >> 16));
+}
+
+
+void mzd_floatToHalfPortable(const float *in_float, unsigned short *out_half, size_t in_count)
+{
+	for (size_t i=0;i<in_count;i++)
+		out_half[i] = mzd_floatToHalf1(in_float[i]);
+}
+
+
+#ifdef MZD_X86
+
+// converts eight values per instruction.
+MZD_TARGET_F16C static void mzd_halfToFloatF16C(const unsigned short *in_half, float *out_float, size_t in_count)
+{
+	size_t i = 0;
+	for (;i+8<=in_count;i+=8)
+	{
+		__m128i h = _mm_loadu_si128((const __m128i *)(in_half + i));
+		_mm256_storeu_ps(out_float + i, _mm256_cvtph_ps(h));
+	}
+
+	// remaining values.
+	if (i < in_count)
+	{
+		unsigned short	h[8] = { 0 };
+		float			f[8];
+		memcpy(h, in_half + i, (in_count - i) * sizeof(unsigned short));
+		_mm256_storeu_ps(f, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)h)));
+		memcpy(out_float + i, f, (in_count - i) * sizeof(float));
+	}
+}
+
+// converts eight values per instruction, rounding to nearest even.
+MZD_TARGET_F16C static void mzd_floatToHalfF16C(const float *in_float, unsigned short *out_half, size_t in_count)
+{
+	size_t i = 0;
+	for (;i+8<=in_count;i+=8)
+	{
+		__m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in_float + i), _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128((__m128i *)(out_half + i), h);
+	}
+
+	// remaining values.
+	if (i < in_count)
+	{
+		float			f[8] = { 0 };
+		unsigned short	h[8];
+		memcpy(f, in_float + i, (in_count - i) * sizeof(float));
+		_mm_storeu_si128((__m128i *)h, _mm256_cvtps_ph(_mm256_loadu_ps(f), _MM_FROUND_TO_NEAREST_INT));
+		memcpy(out_half + i, h, (in_count - i) * sizeof(unsigned short));
+	}
+}
+
+// checks for F16C and for AVX support of the CPU and the operating system.
+static int mzd_detectF16C()
+{
+	unsigned int a = 0, b = 0, c = 0, d = 0;
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	c = (unsigned int)info[2];
+#else
+	if (!__get_cpuid(1, &a, &b, &c, &d))
+		return 0;
+#endif
+	const unsigned int osxsave = 1u << 27, avx = 1u << 28, f16c = 1u << 29;
+	if ((c & (osxsave | avx | f16c)) != (osxsave | avx | f16c))
+		return 0;
+
+	// the OS must save the ymm registers (XCR0 bits 1 and 2).
+#ifdef _MSC_VER
+	unsigned long long xcr0 = _xgetbv(0);
+#else
+	unsigned int lo, hi;
+	__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	unsigned long long xcr0 = ((unsigned long long)hi << 32) | lo;
+#endif
+	return (xcr0 & 6) == 6 ? 1 : 0;
+}
+
+#endif
+
+
+int mzd_halfToFloatHasF16C()
+{
+#ifdef MZD_X86
+	static const int hasF16C = mzd_detectF16C();
+	return hasF16C;
+#else
+	return 0;
+#endif
+}
+
+
+void mzd_halfToFloat(const unsigned short *in_half, float *out_float, size_t in_count)
+{
+#ifdef MZD_X86
+	if (mzd_halfToFloatHasF16C())
+	{
+		mzd_halfToFloatF16C(in_half, out_float, in_count);
+		return;
+	}
+#endif
+	mzd_halfToFloatPortable(in_half, out_float, in_count);
+}
+
+
+void mzd_floatToHalf(const float *in_float, unsigned short *out_half, size_t in_count)
+{
+#ifdef MZD_X86
+	if (mzd_halfToFloatHasF16C())
+	{
+		mzd_floatToHalfF16C(in_float, out_half, in_count);
+		return;
+	}
+#endif
+	mzd_floatToHalfPortable(in_float, out_half, in_count);
+}
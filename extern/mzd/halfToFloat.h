@@ -0,0 +1,38 @@
+/* ____________________________________________________________________________
+	Conversion of half precision floats (as stored in ".mzd" files) to floats
+	and back.
+
+	mzd_halfToFloat() uses the F16C instructions if the CPU supports them
+	(checked once at runtime) and a portable bit manipulation otherwise. Both
+	paths return exactly the same bits as the lookup table in
+	readMZD_half2float.h, i.e. signaling NaNs are converted to quiet NaNs.
+
+	mzd_floatToHalf() rounds to nearest even. Values beyond the half range
+	become infinite, NaNs keep the upper bits of their payload and become
+	quiet NaNs. Again both paths return the same bits.
+  ____________________________________________________________________________
+*/
+
+#ifndef HALFTOFLOAT_H
+#define HALFTOFLOAT_H
+
+#include "stdlib.h"
+
+// converts in_count half floats to floats using the fastest available path.
+void mzd_halfToFloat(const unsigned short *in_half, float *out_float, size_t in_count);
+
+// portable conversion without any SIMD instructions.
+void mzd_halfToFloatPortable(const unsigned short *in_half, float *out_float, size_t in_count);
+
+// converts in_count floats to half floats using the fastest available path.
+void mzd_floatToHalf(const float *in_float, unsigned short *out_half, size_t in_count);
+
+// portable conversion without any SIMD instructions.
+void mzd_floatToHalfPortable(const float *in_float, unsigned short *out_half, size_t in_count);
+
+// returns 1 if mzd_halfToFloat() and mzd_floatToHalf() use the F16C
+// instructions, otherwise 0.
+int mzd_halfToFloatHasF16C();
+
+
+#endif // HALFTOFLOAT_H
@@ -20,26 +20,302 @@
 */
 
 #include "readMZD.h"
+#include "halfToFloat.h"
 
-// conversion from half float to float.
-union  mzd_h2f { unsigned int ui; float f; };
-static mzd_h2f lookupH2F[65536] =
+// 64 bit file offsets.
+#ifdef _WIN32
+	#define mzd_fseek64	_fseeki64
+	#define mzd_ftell64	_ftelli64
+#else
+	#define mzd_fseek64	fseeko
+	#define mzd_ftell64	ftello
+#endif
+
+
+// Input of the reader: either a file or a block of memory (e.g. a memory
+// mapped file). Latter is read without any intermediate buffering.
+struct mzd_stream
 {
-	#include "readMZD_half2float.h"
+	FILE				*file;		// file stream or NULL.
+	const unsigned char	*data;		// memory block or NULL.
+	size_t				 size;		// size of the memory block in bytes.
+	size_t				 pos;		// current read position in the memory block.
 };
 
+// Equivalent of fread() for a mzd_stream. Returns the amount of elements read.
+static size_t mzd_read(void *dst, size_t size, size_t count, mzd_stream *stream)
+{
+	if (stream->file)
+		return fread(dst, size, count, stream->file);
+
+	size_t avail = (stream->size - stream->pos) / size;
+	if (count > avail)
+		count = avail;
+	memcpy(dst, stream->data + stream->pos, size * count);
+	stream->pos += size * count;
+	return count;
+}
 
-// Reads a .mzd file and stores the result in the output arrays. Latter are
-// allocated by this function and must be freed manually by the caller once
-// they are no longer needed.
-// Parameters: see parameter descriptions.
-// Return values:	 0: success.
-//					-1: unable to open file.
-//					-2: read error.
-//					-3: failed to allocate memory.
-//					-4: wrong file format.
-//					-5: illegal parameter value.
-int readMZD(const char		 *in_fname,				// input file name.
+// Equivalent of fseek(..., SEEK_CUR) for a mzd_stream. Returns 0 on success.
+// The offset is 64 bit, since long has 32 bits on Windows.
+static int mzd_seek(mzd_stream *stream, long long offset)
+{
+	if (stream->file)
+		return mzd_fseek64(stream->file, offset, SEEK_CUR);
+
+	if (offset < 0 && (unsigned long long)(-offset) > stream->pos)				return -1;
+	if (offset > 0 && (unsigned long long)offset > stream->size - stream->pos)	return -1;
+	stream->pos += (size_t)offset;
+	return 0;
+}
+
+// Equivalent of fseek(..., SEEK_SET) for a mzd_stream. Returns 0 on success.
+static int mzd_seekSet(mzd_stream *stream, long long offset)
+{
+	if (stream->file)
+		return mzd_fseek64(stream->file, offset, SEEK_SET);
+
+	if (offset < 0 || (unsigned long long)offset > stream->size)		return -1;
+	stream->pos = (size_t)offset;
+	return 0;
+}
+
+// Equivalent of ftell() for a mzd_stream.
+static long long mzd_tell(mzd_stream *stream)
+{
+	if (stream->file)
+		return mzd_ftell64(stream->file);
+	return (long long)stream->pos;
+}
+
+
+// Number of elements which are converted per block when reading 16 bit data.
+#define MZD_BLOCK_SIZE	4096
+
+// Reads in_count unsigned shorts and stores them as ints. The data is read
+// in blocks. Returns 0 on success and -2 on a read error.
+static int mzd_readUShorts(mzd_stream *stream, int *out, size_t count)
+{
+	unsigned short block[MZD_BLOCK_SIZE];
+	while (count > 0)
+	{
+		size_t n = count < MZD_BLOCK_SIZE ? count : MZD_BLOCK_SIZE;
+		if (mzd_read(block, 2, n, stream) != n)
+			return -2;
+		for (size_t i=0;i<n;i++)
+			out[i] = block[i];
+		out   += n;
+		count -= n;
+	}
+	return 0;
+}
+
+// Reads in_count unsigned chars and stores them as ints. The data is read
+// in blocks. Returns 0 on success and -2 on a read error.
+static int mzd_readUChars(mzd_stream *stream, int *out, size_t count)
+{
+	unsigned char block[MZD_BLOCK_SIZE];
+	while (count > 0)
+	{
+		size_t n = count < MZD_BLOCK_SIZE ? count : MZD_BLOCK_SIZE;
+		if (mzd_read(block, 1, n, stream) != n)
+			return -2;
+		for (size_t i=0;i<n;i++)
+			out[i] = block[i];
+		out   += n;
+		count -= n;
+	}
+	return 0;
+}
+
+// Reads in_count half floats and converts them to floats. The data is read
+// in blocks which are converted with SIMD instructions if available.
+// Returns 0 on success and -2 on a read error.
+static int mzd_readHalfs(mzd_stream *stream, float *out, size_t count)
+{
+	unsigned short block[MZD_BLOCK_SIZE];
+	while (count > 0)
+	{
+		size_t n = count < MZD_BLOCK_SIZE ? count : MZD_BLOCK_SIZE;
+		if (mzd_read(block, 2, n, stream) != n)
+			return -2;
+		mzd_halfToFloat(block, out, n);
+		out   += n;
+		count -= n;
+	}
+	return 0;
+}
+
+
+// _____________________________________________________________________________
+// chunk table scan and decoding of single chunks.
+
+
+// Scans the chunks of a stream. Shared by readMZDInfo() and readMZDInfoFromMemory().
+static int readMZDInfo_stream(mzd_stream *stream, MZDInfo &out_info)
+{
+	memset(&out_info, 0, sizeof(MZDInfo));
+	if (!stream)
+		return -1;
+
+	// read and check the file header.
+	char head[24];
+	if (mzd_read(head, 1, 24, stream) != 24)	return -4;
+	if (memcmp(head, MZD_HEAD, 24))				return -4;
+
+	// read the chunk headers.
+	while (true)
+	{
+		// the first 24 bytes are either the file tail or the beginning of a
+		// chunk header (ID and the first 20 characters of the name).
+		unsigned char header[32];
+		if (mzd_read(header, 1, 24, stream) != 24)		return -2;
+		if (memcmp(header, MZD_TAIL, 24) == 0)			break;
+		if (mzd_read(header + 24, 1, 8, stream) != 8)	return -2;
+		if (out_info.numChunks >= MZD_MAX_CHUNKS)		return -127;
+
+		MZDChunk &chunk = out_info.chunks[out_info.numChunks++];
+		memcpy(&chunk.id,   header,      4);
+		memcpy(&chunk.size, header + 28, 4);
+		chunk.offset = mzd_tell(stream);
+
+		// the counts of the vertex chunk are part of the info.
+		if (chunk.id == 0x0ABC0001)
+		{
+			int numVertices, numPolygons, numBytesPerPolyVInd;
+			if (mzd_read(&numVertices, 4, 1, stream) != 1)					return -2;
+			if (numVertices < 0)											return -127;
+			size_t numBytes = 4 + 12 * (size_t)numVertices;
+			if (numBytes + 4 > chunk.size)									return -127;
+			if (mzd_seek(stream, 12 * (long long)numVertices) != 0)			return -2;
+
+			if (mzd_read(&numPolygons, 4, 1, stream) != 1)					return -2;
+			if (numPolygons < 0)											return -127;
+			numBytes += 4 + (size_t)numPolygons;
+			if (numBytes + 4 > chunk.size)									return -127;
+
+			// sum up the polygon vertex counts.
+			size_t numNodes = 0;
+			unsigned char block[MZD_BLOCK_SIZE];
+			for (size_t remaining=numPolygons;remaining>0;)
+			{
+				size_t n = remaining < MZD_BLOCK_SIZE ? remaining : MZD_BLOCK_SIZE;
+				if (mzd_read(block, 1, n, stream) != n)						return -2;
+				for (size_t i=0;i<n;i++)
+					numNodes += block[i];
+				remaining -= n;
+			}
+			if (numNodes > 0x7fffffff)										return -127;
+
+			if (mzd_read(&numBytesPerPolyVInd, 4, 1, stream) != 1)			return -2;
+			if (numBytesPerPolyVInd != 4 && numBytesPerPolyVInd != 2)		return -127;
+			numBytes += 4 + numBytesPerPolyVInd * numNodes;
+			if (numBytes > chunk.size)										return -127;
+
+			out_info.numVertices			= numVertices;
+			out_info.numPolygons			= numPolygons;
+			out_info.numNodes				= (int)numNodes;
+			out_info.numBytesPerPolyVInd	= numBytesPerPolyVInd;
+		}
+
+		// continue with the next chunk.
+		if (mzd_seekSet(stream, chunk.offset + chunk.size) != 0)			return -2;
+	}
+
+	return 0;
+}
+
+
+// Decodes the requested chunks. Shared by readMZDData() and readMZDDataFromMemory().
+static int readMZDData_stream(mzd_stream *stream, const MZDInfo &in_info, const MZDBuffers &io_buffers)
+{
+	if (!stream)
+		return -1;
+
+	for (int c=0;c<in_info.numChunks;c++)
+	{
+		const MZDChunk &chunk = in_info.chunks[c];
+
+		// vertices and polygons.
+		if (chunk.id == 0x0ABC0001)
+		{
+			if (!io_buffers.vertPositions && !io_buffers.polyVIndicesNum && !io_buffers.polyVIndices)
+				continue;
+
+			int num;
+			if (mzd_seekSet(stream, chunk.offset) != 0)						return -2;
+			if (mzd_read(&num, 4, 1, stream) != 1)							return -2;
+			if (num != in_info.numVertices)									return -127;
+			if (io_buffers.vertPositions)
+			{
+				if (mzd_read(io_buffers.vertPositions, 4, 3 * (size_t)num, stream) != 3 * (size_t)num)	return -2;
+			}
+			else if (mzd_seek(stream, 12 * (long long)num) != 0)			return -2;
+
+			if (mzd_read(&num, 4, 1, stream) != 1)							return -2;
+			if (num != in_info.numPolygons)									return -127;
+			if (io_buffers.polyVIndicesNum)
+			{
+				if (mzd_readUChars(stream, io_buffers.polyVIndicesNum, num) != 0)	return -2;
+			}
+			else if (mzd_seek(stream, num) != 0)							return -2;
+
+			if (io_buffers.polyVIndices)
+			{
+				if (mzd_seek(stream, 4) != 0)								return -2;
+				if (in_info.numBytesPerPolyVInd == 4)
+				{
+					if (mzd_read(io_buffers.polyVIndices, 4, in_info.numNodes, stream) != (size_t)in_info.numNodes)	return -2;
+				}
+				else if (mzd_readUShorts(stream, io_buffers.polyVIndices, in_info.numNodes) != 0)					return -2;
+			}
+			continue;
+		}
+
+		// attributes: destination, number of elements and components.
+		float	*dst		= NULL;
+		int		 numElem	= 0;
+		int		 numComp	= 3;
+		bool	 isHalf		= true;
+		switch (chunk.id)
+		{
+			case 0xDA7A0001:	dst = io_buffers.vertNormals;	numElem = in_info.numVertices;							break;
+			case 0xDA7A0002:	dst = io_buffers.vertMotions;	numElem = in_info.numVertices;							break;
+			case 0xDA7A0003:	dst = io_buffers.vertColors;	numElem = in_info.numVertices;	numComp = 4;			break;
+			case 0xDA7A0004:	dst = io_buffers.vertUVWs;		numElem = in_info.numVertices;	isHalf  = false;		break;
+			case 0xDA7A0011:	dst = io_buffers.nodeNormals;	numElem = in_info.numNodes;								break;
+			case 0xDA7A0013:	dst = io_buffers.nodeColors;	numElem = in_info.numNodes;		numComp = 4;			break;
+			case 0xDA7A0014:	dst = io_buffers.nodeUVWs;		numElem = in_info.numNodes;		isHalf  = false;		break;
+			default:			break;
+		}
+		if (!dst)
+			continue;
+
+		int num;
+		if (mzd_seekSet(stream, chunk.offset) != 0)									return -2;
+		if (mzd_read(&num, 4, 1, stream) != 1)										return -2;
+		if (num != numElem)															return -127;
+		const size_t numValues = (size_t)numComp * num;
+		if (4 + numValues * (isHalf ? 2 : 4) > chunk.size)							return -127;
+		if (isHalf)
+		{
+			if (mzd_readHalfs(stream, dst, numValues) != 0)							return -2;
+		}
+		else if (mzd_read(dst, 4, numValues, stream) != numValues)					return -2;
+	}
+
+	return 0;
+}
+
+
+// _____________________________________________________________________________
+// single pass reading: readMZD().
+
+
+// Reads the chunks from a stream. Shared by readMZD() and readMZDFromMemory().
+// The chunk table is scanned first, then only the chunks with an output
+// array are decoded.
+static int readMZD_stream(mzd_stream *stream,				// input stream or NULL if it could not be opened.
 			int				 &out_numVertices,		// amount of vertices.
 			int				 &out_numPolygons,		// amount of polygons.
 			int				 &out_numNodes,			// amount of polygon nodes.
@@ -76,430 +352,82 @@ int readMZD(const char		 *in_fname,				// input file name.
 	if (!out_vertPositions || !out_polyVIndicesNum || !out_polyVIndices)
 		ret = -5;
 
-	// __________
-	// open file.
-	FILE *stream = fopen(in_fname, "rb");
 	if (!stream)
 		ret = -1;
 
-	// _____________
-	// read content.
+	// _____________________
+	// scan the chunk table.
+	MZDInfo info;
 	if (ret == 0)
-	{
-		// read and check the file header.
-		char head[24];
-		if (fread(head, 1, 24, stream) != 24)	ret = -4;
-		else if (memcmp(head, MZD_HEAD, 24))	ret = -4;
+		ret = readMZDInfo_stream(stream, info);
 
-		// read the chunks.
-		while (ret == 0)
+	// ____________________________________________________________
+	// allocate the output arrays of the chunks present in the file.
+	MZDBuffers buffers;
+	memset(&buffers, 0, sizeof(MZDBuffers));
+	if (ret == 0 && info.numVertices > 0)
+	{
+		// vertices and polygons. The polygon vertex counts are read separately
+		// below, since readMZDData_stream() widens them to int.
+		*out_vertPositions		= (float *)malloc(3 * (size_t)info.numVertices * sizeof(float));
+		*out_polyVIndicesNum	= (unsigned char *)malloc(info.numPolygons * sizeof(unsigned char));
+		*out_polyVIndices		= (int *)malloc(info.numNodes * sizeof(int));
+		if (!*out_vertPositions || (info.numPolygons && !*out_polyVIndicesNum) || (info.numNodes && !*out_polyVIndices))
+			ret = -3;
+		buffers.vertPositions	= *out_vertPositions;
+		buffers.polyVIndices	= *out_polyVIndices;
+
+		// attributes.
+		for (int i=0;i<info.numChunks && ret == 0;i++)
 		{
-			// read chunk header.
-			unsigned int	chunkID;
-			char			chunkName[24];
-			unsigned int	chunkSize;
-			if (fread(&chunkID,   4,  1, stream) !=  1)	{	ret = -2;	break;	}
-			if (fread(chunkName,  1, 24, stream) != 24)	{	ret = -2;	break;	}
-			if (fread(&chunkSize, 4,  1, stream) !=  1)	{	ret = -2;	break;	}
-
-			// load/skip chunk.
-			switch(chunkID)
+			float	**out		= NULL;
+			float	**buffer	= NULL;
+			size_t	  num		= 0;
+			switch (info.chunks[i].id)
 			{
-				case 0x0ABC0001:		// vertices and polygons.
-					{
-						// read num vertices.
-						if (fread(&out_numVertices, 4, 1, stream) != 1)		{	ret = -2;	break;	}
-						if (out_numVertices  < 0)							{	ret = -127;	break;	}
-						if (out_numVertices == 0)							{				break;	}
-
-						// allocate memory for vertex positions and fill it.
-						*out_vertPositions = (float *)malloc(3 * out_numVertices * sizeof(float));
-						if (*out_vertPositions)
-						{
-							float *v = *out_vertPositions;
-							for (int i=0;i<out_numVertices;i++,v+=3)
-								if (fread(v, 4, 3, stream) != 3)	{	ret = -2;	break;	}
-							if (ret != 0)
-								break;
-						}
-						else
-						{
-							ret = -3;
-							break;
-						}
-
-						// read num polygons.
-						if (fread(&out_numPolygons, 4, 1, stream) != 1)		{	ret = -2;	break;	}
-						if (out_numPolygons < 0)							{	ret = -127;	break;	}
-
-						// allocate memory for polygon vertex indices count and fill it.
-						*out_polyVIndicesNum = (unsigned char *)malloc(out_numPolygons * sizeof(unsigned char));
-						if (*out_polyVIndicesNum)
-						{
-							if (fread(*out_polyVIndicesNum, 1, out_numPolygons, stream) != out_numPolygons)
-							{
-								ret = -2;
-								break;
-							}
-						}
-						else
-						{
-							ret = -3;
-							break;
-						}
-
-						// calculate the amount of polygon nodes.
-						for (int i=0;i<out_numPolygons;i++)
-							out_numNodes += (*out_polyVIndicesNum)[i];
-
-						// read numBytesPerPolyVInd.
-						int numBytesPerPolyVInd;
-						if (fread(&numBytesPerPolyVInd, 4, 1, stream) != 1)		{	ret = -2;	break;	}
-
-						// allocate memory for polygon vertex indices and fill it.
-						*out_polyVIndices = (int *)malloc(out_numNodes * sizeof(int));
-						if (*out_polyVIndices)
-						{
-							// int.
-							if (numBytesPerPolyVInd == 4)
-							{
-								unsigned char	*pvn = *out_polyVIndicesNum;
-								int				*pvi = *out_polyVIndices;
-								for (int i=0;i<out_numPolygons;i++,pvn++)
-								{
-									if (fread(pvi, 4, *pvn, stream) != *pvn)
-									{
-										ret = -2;
-										break;
-									}
-									pvi += *pvn;
-								}	
-								if (ret != 0)
-									break;
-							}
-
-							// unsigned short.
-							else if (numBytesPerPolyVInd == 2)
-							{
-								unsigned short	 us256[256];
-								unsigned char	*pvn = *out_polyVIndicesNum;
-								int				*pvi = *out_polyVIndices;
-								for (int i=0;i<out_numPolygons;i++,pvn++)
-								{
-									if (fread(us256, 2, *pvn, stream) != *pvn)
-									{
-										ret = -2;
-										break;
-									}
-									for (unsigned char j=0;j<*pvn;j++,pvi++)
-										*pvi = us256[j];
-								}	
-								if (ret != 0)
-									break;
-							}
-
-							// unsupported.
-							else
-							{
-								ret = -127;
-								break;
-							}
-						}
-						else
-						{
-							ret = -3;
-							break;
-						}
-					}
-					break;
-				case 0xDA7A0001:		// vertex normals.
-					{
-						// skip this chunk?
-						if (!out_vertNormals)
-						{
-							if (fseek(stream, chunkSize, SEEK_CUR) != 0)
-								ret = -2;
-							break;
-						}
-
-						// read num.
-						int num = 0;
-						if (fread(&num, 4, 1, stream) != 1)		{	ret = -2;	break;	}
-						if (num != out_numVertices)				{	ret = -127;	break;	}
-
-						// allocate memory and fill it.
-						*out_vertNormals = (float *)malloc(3 * num * sizeof(float));
-						if (*out_vertNormals)
-						{
-							unsigned short	 h[3];
-							float			*v = *out_vertNormals;
-							for (int i=0;i<num;i++,v+=3)
-							{
-								if (fread(h, 2, 3, stream) != 3)	{	ret = -2;	break;	}
-								v[0] = lookupH2F[h[0]].f;
-								v[1] = lookupH2F[h[1]].f;
-								v[2] = lookupH2F[h[2]].f;
-							}
-							if (ret != 0)
-								break;
-						}
-						else
-						{
-							ret = -3;
-							break;
-						}
-					}
-					break;
-				case 0xDA7A0002:		// vertex motions.
-					{
-						// skip this chunk?
-						if (!out_vertMotions)
-						{
-							if (fseek(stream, chunkSize, SEEK_CUR) != 0)
-								ret = -2;
-							break;
-						}
-
-						// read num.
-						int num = 0;
-						if (fread(&num, 4, 1, stream) != 1)		{	ret = -2;	break;	}
-						if (num != out_numVertices)				{	ret = -127;	break;	}
-
-						// allocate memory and fill it.
-						*out_vertMotions = (float *)malloc(3 * num * sizeof(float));
-						if (*out_vertMotions)
-						{
-							unsigned short	 h[3];
-							float			*v = *out_vertMotions;
-							for (int i=0;i<num;i++,v+=3)
-							{
-								if (fread(h, 2, 3, stream) != 3)	{	ret = -2;	break;	}
-								v[0] = lookupH2F[h[0]].f;
-								v[1] = lookupH2F[h[1]].f;
-								v[2] = lookupH2F[h[2]].f;
-							}
-							if (ret != 0)
-								break;
-						}
-						else
-						{
-							ret = -3;
-							break;
-						}
-					}
-					break;
-				case 0xDA7A0003:		// vertex colors.
-					{
-						// skip this chunk?
-						if (!out_vertColors)
-						{
-							if (fseek(stream, chunkSize, SEEK_CUR) != 0)
-								ret = -2;
-							break;
-						}
-
-						// read num.
-						int num = 0;
-						if (fread(&num, 4, 1, stream) != 1)		{	ret = -2;	break;	}
-						if (num != out_numVertices)				{	ret = -127;	break;	}
-
-						// allocate memory and fill it.
-						*out_vertColors = (float *)malloc(4 * num * sizeof(float));
-						if (*out_vertColors)
-						{
-							unsigned short	 h[4];
-							float			*v = *out_vertColors;
-							for (int i=0;i<num;i++,v+=4)
-							{
-								if (fread(h, 2, 4, stream) != 4)	{	ret = -2;	break;	}
-								v[0] = lookupH2F[h[0]].f;
-								v[1] = lookupH2F[h[1]].f;
-								v[2] = lookupH2F[h[2]].f;
-								v[3] = lookupH2F[h[3]].f;
-							}
-							if (ret != 0)
-								break;
-						}
-						else
-						{
-							ret = -3;
-							break;
-						}
-					}
-					break;
-				case 0xDA7A0004:		// vertex UVWs.
-					{
-						// skip this chunk?
-						if (!out_vertUVWs)
-						{
-							if (fseek(stream, chunkSize, SEEK_CUR) != 0)
-								ret = -2;
-							break;
-						}
-
-						// read num.
-						int num = 0;
-						if (fread(&num, 4, 1, stream) != 1)		{	ret = -2;	break;	}
-						if (num != out_numVertices)				{	ret = -127;	break;	}
-
-						// allocate memory and fill it.
-						*out_vertUVWs = (float *)malloc(3 * num * sizeof(float));
-						if (*out_vertUVWs)
-						{
-							float *v = *out_vertUVWs;
-							for (int i=0;i<num;i++,v+=3)
-								if (fread(v, 4, 3, stream) != 3)	{	ret = -2;	break;	}
-							if (ret != 0)
-								break;
-						}
-						else
-						{
-							ret = -3;
-							break;
-						}
-					}
-					break;
-				case 0xDA7A0011:		// node normals.
-					{
-						// skip this chunk?
-						if (!out_nodeNormals)
-						{
-							if (fseek(stream, chunkSize, SEEK_CUR) != 0)
-								ret = -2;
-							break;
-						}
-
-						// read num.
-						int num = 0;
-						if (fread(&num, 4, 1, stream) != 1)		{	ret = -2;	break;	}
-						if (num != out_numNodes)				{	ret = -127;	break;	}
-
-						// allocate memory and fill it.
-						*out_nodeNormals = (float *)malloc(3 * num * sizeof(float));
-						if (*out_nodeNormals)
-						{
-							unsigned short	 h[3];
-							float			*v = *out_nodeNormals;
-							for (int i=0;i<num;i++,v+=3)
-							{
-								if (fread(h, 2, 3, stream) != 3)	{	ret = -2;	break;	}
-								v[0] = lookupH2F[h[0]].f;
-								v[1] = lookupH2F[h[1]].f;
-								v[2] = lookupH2F[h[2]].f;
-							}
-							if (ret != 0)
-								break;
-						}
-						else
-						{
-							ret = -3;
-							break;
-						}
-					}
-					break;
-				case 0xDA7A0013:		// node colors.
-					{
-						// skip this chunk?
-						if (!out_nodeColors)
-						{
-							if (fseek(stream, chunkSize, SEEK_CUR) != 0)
-								ret = -2;
-							break;
-						}
-
-						// read num.
-						int num = 0;
-						if (fread(&num, 4, 1, stream) != 1)		{	ret = -2;	break;	}
-						if (num != out_numNodes)				{	ret = -127;	break;	}
-
-						// allocate memory and fill it.
-						*out_nodeColors = (float *)malloc(4 * num * sizeof(float));
-						if (*out_nodeColors)
-						{
-							unsigned short	 h[4];
-							float			*v = *out_nodeColors;
-							for (int i=0;i<num;i++,v+=4)
-							{
-								if (fread(h, 2, 4, stream) != 4)	{	ret = -2;	break;	}
-								v[0] = lookupH2F[h[0]].f;
-								v[1] = lookupH2F[h[1]].f;
-								v[2] = lookupH2F[h[2]].f;
-								v[3] = lookupH2F[h[3]].f;
-							}
-							if (ret != 0)
-								break;
-						}
-						else
-						{
-							ret = -3;
-							break;
-						}
-					}
-					break;
-				case 0xDA7A0014:		// node UVWs.
-					{
-						// skip this chunk?
-						if (!out_nodeUVWs)
-						{
-							if (fseek(stream, chunkSize, SEEK_CUR) != 0)
-								ret = -2;
-							break;
-						}
-
-						// read num.
-						int num = 0;
-						if (fread(&num, 4, 1, stream) != 1)		{	ret = -2;	break;	}
-						if (num != out_numNodes)				{	ret = -127;	break;	}
-
-						// allocate memory and fill it.
-						*out_nodeUVWs = (float *)malloc(3 * num * sizeof(float));
-						if (*out_nodeUVWs)
-						{
-							float *v = *out_nodeUVWs;
-							for (int i=0;i<num;i++,v+=3)
-								if (fread(v, 4, 3, stream) != 3)	{	ret = -2;	break;	}
-							if (ret != 0)
-								break;
-						}
-						else
-						{
-							ret = -3;
-							break;
-						}
-					}
-					break;
-				default:				// skip this chunk.
-					{
-						if (fseek(stream, chunkSize, SEEK_CUR) != 0)
-							ret = -2;
-					}
-					break;
+				case 0xDA7A0001:	out = out_vertNormals;	buffer = &buffers.vertNormals;	num = 3 * (size_t)info.numVertices;	break;
+				case 0xDA7A0002:	out = out_vertMotions;	buffer = &buffers.vertMotions;	num = 3 * (size_t)info.numVertices;	break;
+				case 0xDA7A0003:	out = out_vertColors;	buffer = &buffers.vertColors;	num = 4 * (size_t)info.numVertices;	break;
+				case 0xDA7A0004:	out = out_vertUVWs;		buffer = &buffers.vertUVWs;		num = 3 * (size_t)info.numVertices;	break;
+				case 0xDA7A0011:	out = out_nodeNormals;	buffer = &buffers.nodeNormals;	num = 3 * (size_t)info.numNodes;	break;
+				case 0xDA7A0013:	out = out_nodeColors;	buffer = &buffers.nodeColors;	num = 4 * (size_t)info.numNodes;	break;
+				case 0xDA7A0014:	out = out_nodeUVWs;		buffer = &buffers.nodeUVWs;		num = 3 * (size_t)info.numNodes;	break;
+				default:			break;
 			}
 
-			// error?
-			if (ret != 0)
-				break;
+			// skip this chunk?
+			if (!out || *out)
+				continue;
 
-			// have we reached the end?
-			char tail[24];
-			if (fread(tail, 1, 24, stream) != 24)	{	ret = -2;	break;	}
-			if (memcmp(tail, MZD_TAIL, 24) == 0)	{				break;	}
-			else
-			{
-				// still some chunks left.
-				if (fseek(stream, -24, SEEK_CUR) != 0)
-				{
-					ret = -2;
-					break;
-				}
-			}
+			*out = (float *)malloc(num * sizeof(float));
+			if (num && !*out)
+				ret = -3;
+			*buffer = *out;
 		}
 	}
 
-	// _______________
-	// close the file.
-	if (stream)
-		fclose(stream);
+	// ______________________________
+	// decode the requested chunks.
+	if (ret == 0 && info.numVertices > 0)
+		ret = readMZDData_stream(stream, info, buffers);
+
+	// _______________________________________________________
+	// read the polygon vertex counts of the last vertex chunk.
+	for (int i=info.numChunks-1;i>=0 && ret == 0 && info.numVertices > 0;i--)
+	{
+		if (info.chunks[i].id != 0x0ABC0001)
+			continue;
+		if (mzd_seekSet(stream, info.chunks[i].offset + 4 + 12 * (long long)info.numVertices + 4) != 0)					ret = -2;
+		else if (mzd_read(*out_polyVIndicesNum, 1, info.numPolygons, stream) != (size_t)info.numPolygons)				ret = -2;
+		break;
+	}
+
+	if (ret == 0)
+	{
+		out_numVertices	= info.numVertices;
+		out_numPolygons	= info.numPolygons;
+		out_numNodes	= info.numNodes;
+	}
 
 	// _________
 	// clean up?
@@ -526,3 +454,121 @@ int readMZD(const char		 *in_fname,				// input file name.
 }
 
 
+// Reads a .mzd file and stores the result in the output arrays. Latter are
+// allocated by this function and must be freed manually by the caller once
+// they are no longer needed.
+// Parameters: see parameter descriptions.
+// Return values:	 0: success.
+//					-1: unable to open file.
+//					-2: read error.
+//					-3: failed to allocate memory.
+//					-4: wrong file format.
+//					-5: illegal parameter value.
+int readMZD(const char		 *in_fname,				// input file name.
+			int				 &out_numVertices,		// amount of vertices.
+			int				 &out_numPolygons,		// amount of polygons.
+			int				 &out_numNodes,			// amount of polygon nodes.
+			float			**out_vertPositions,	// array of vertex positions.
+			unsigned char	**out_polyVIndicesNum,	// array of polygon vertex indices count.
+			int				**out_polyVIndices,		// array of polygon vertex indices.
+			float			**out_vertNormals,		// array of vertex normal vectors.
+			float			**out_vertMotions,		// array of vertex motion vectors.
+			float			**out_vertColors,		// array of vertex colors.
+			float			**out_vertUVWs,			// array of vertex UVW coordinates.
+			float			**out_nodeNormals,		// array of polygon node normal vectors.
+			float			**out_nodeColors,		// array of polygon node colors.
+			float			**out_nodeUVWs)			// array of polygon node UVW coordinates.
+{
+	// __________
+	// open file.
+	FILE *file = fopen(in_fname, "rb");
+	mzd_stream stream = { file, NULL, 0, 0 };
+
+	// _____________
+	// read content.
+	int ret = readMZD_stream(file ? &stream : NULL, out_numVertices, out_numPolygons, out_numNodes, out_vertPositions, out_polyVIndicesNum, out_polyVIndices,
+							 out_vertNormals, out_vertMotions, out_vertColors, out_vertUVWs, out_nodeNormals, out_nodeColors, out_nodeUVWs);
+
+	// _______________
+	// close the file.
+	if (file)
+		fclose(file);
+
+	// _____
+	// done.
+	return ret;
+}
+
+
+// Same as readMZD() but reads the content of a .mzd file from a block of
+// memory, e.g. a memory mapped file.
+// Return values: see readMZD(), -1 is returned if in_data is NULL.
+int readMZDFromMemory(const void *in_data,				// file content.
+			size_t			  in_size,				// size of the file content in bytes.
+			int				 &out_numVertices,		// amount of vertices.
+			int				 &out_numPolygons,		// amount of polygons.
+			int				 &out_numNodes,			// amount of polygon nodes.
+			float			**out_vertPositions,	// array of vertex positions.
+			unsigned char	**out_polyVIndicesNum,	// array of polygon vertex indices count.
+			int				**out_polyVIndices,		// array of polygon vertex indices.
+			float			**out_vertNormals,		// array of vertex normal vectors.
+			float			**out_vertMotions,		// array of vertex motion vectors.
+			float			**out_vertColors,		// array of vertex colors.
+			float			**out_vertUVWs,			// array of vertex UVW coordinates.
+			float			**out_nodeNormals,		// array of polygon node normal vectors.
+			float			**out_nodeColors,		// array of polygon node colors.
+			float			**out_nodeUVWs)			// array of polygon node UVW coordinates.
+{
+	mzd_stream stream = { NULL, (const unsigned char *)in_data, in_size, 0 };
+	return readMZD_stream(in_data ? &stream : NULL, out_numVertices, out_numPolygons, out_numNodes, out_vertPositions, out_polyVIndicesNum, out_polyVIndices,
+						  out_vertNormals, out_vertMotions, out_vertColors, out_vertUVWs, out_nodeNormals, out_nodeColors, out_nodeUVWs);
+}
+
+
+// _____________________________________________________________________________
+// two pass reading: readMZDInfo() + readMZDData().
+
+
+// Reads the counts and the chunk table of a .mzd file without decoding any
+// payload, so that the caller can allocate the output arrays.
+// Return values: see readMZD().
+int readMZDInfo(const char *in_fname, MZDInfo &out_info)
+{
+	FILE *file = fopen(in_fname, "rb");
+	mzd_stream stream = { file, NULL, 0, 0 };
+	int ret = readMZDInfo_stream(file ? &stream : NULL, out_info);
+	if (file)
+		fclose(file);
+	return ret;
+}
+
+
+// Same as readMZDInfo() for the content of a .mzd file in memory.
+int readMZDInfoFromMemory(const void *in_data, size_t in_size, MZDInfo &out_info)
+{
+	mzd_stream stream = { NULL, (const unsigned char *)in_data, in_size, 0 };
+	return readMZDInfo_stream(in_data ? &stream : NULL, out_info);
+}
+
+
+// Decodes the chunks of a .mzd file straight into the caller provided
+// arrays of io_buffers. Chunks whose array is NULL are not read.
+// in_info must have been obtained by readMZDInfo() for the same file.
+// Return values: see readMZD().
+int readMZDData(const char *in_fname, const MZDInfo &in_info, const MZDBuffers &io_buffers)
+{
+	FILE *file = fopen(in_fname, "rb");
+	mzd_stream stream = { file, NULL, 0, 0 };
+	int ret = readMZDData_stream(file ? &stream : NULL, in_info, io_buffers);
+	if (file)
+		fclose(file);
+	return ret;
+}
+
+
+// Same as readMZDData() for the content of a .mzd file in memory.
+int readMZDDataFromMemory(const void *in_data, size_t in_size, const MZDInfo &in_info, const MZDBuffers &io_buffers)
+{
+	mzd_stream stream = { NULL, (const unsigned char *)in_data, in_size, 0 };
+	return readMZDData_stream(in_data ? &stream : NULL, in_info, io_buffers);
+}
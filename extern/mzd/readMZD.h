@@ -28,6 +28,43 @@
 #define MZD_HEAD	"    MZD-File-Format    "
 #define MZD_TAIL	"   >> END OF FILE <<   "
 
+#define MZD_MAX_CHUNKS	64
+
+// a chunk of a .mzd file.
+struct MZDChunk
+{
+	unsigned int	id;				// chunk ID, e.g. 0x0ABC0001 for vertices and polygons.
+	unsigned int	size;			// size of the chunk data in bytes.
+	long long		offset;			// file offset of the chunk data.
+};
+
+// counts and chunk table of a .mzd file, see readMZDInfo().
+struct MZDInfo
+{
+	int				numVertices;			// amount of vertices.
+	int				numPolygons;			// amount of polygons.
+	int				numNodes;				// amount of polygon nodes.
+	int				numBytesPerPolyVInd;	// size of a polygon vertex index in the file (2 or 4).
+	int				numChunks;				// amount of chunks.
+	MZDChunk		chunks[MZD_MAX_CHUNKS];	// chunk table.
+};
+
+// caller provided output arrays for readMZDData(). Chunks whose array is NULL
+// are skipped. The arrays must have the sizes given in the comments.
+struct MZDBuffers
+{
+	float			*vertPositions;		// 3 * numVertices.
+	int				*polyVIndicesNum;	// numPolygons.
+	int				*polyVIndices;		// numNodes.
+	float			*vertNormals;		// 3 * numVertices.
+	float			*vertMotions;		// 3 * numVertices.
+	float			*vertColors;		// 4 * numVertices.
+	float			*vertUVWs;			// 3 * numVertices.
+	float			*nodeNormals;		// 3 * numNodes.
+	float			*nodeColors;		// 4 * numNodes.
+	float			*nodeUVWs;			// 3 * numNodes.
+};
+
 int readMZD(const char		 *in_fname,
 			int				 &out_numVertices,
 			int				 &out_numPolygons,
@@ -43,6 +80,31 @@ int readMZD(const char		 *in_fname,
 			float			**out_nodeColors	= NULL,
 			float			**out_nodeUVWs		= NULL);
 
+// reads the content of a .mzd file from a block of memory (e.g. a memory mapped file).
+int readMZDFromMemory(const void *in_data,
+			size_t			  in_size,
+			int				 &out_numVertices,
+			int				 &out_numPolygons,
+			int				 &out_numNodes,
+			float			**out_vertPositions,
+			unsigned char	**out_polyVIndicesNum,
+			int				**out_polyVIndices,
+			float			**out_vertNormals	= NULL,
+			float			**out_vertMotions	= NULL,
+			float			**out_vertColors	= NULL,
+			float			**out_vertUVWs		= NULL,
+			float			**out_nodeNormals	= NULL,
+			float			**out_nodeColors	= NULL,
+			float			**out_nodeUVWs		= NULL);
+
+
+// reads the counts and the chunk table without decoding any payload.
+int readMZDInfo(const char *in_fname, MZDInfo &out_info);
+int readMZDInfoFromMemory(const void *in_data, size_t in_size, MZDInfo &out_info);
+
+// decodes the chunks straight into the caller provided arrays.
+int readMZDData(const char *in_fname, const MZDInfo &in_info, const MZDBuffers &io_buffers);
+int readMZDDataFromMemory(const void *in_data, size_t in_size, const MZDInfo &in_info, const MZDBuffers &io_buffers);
 
 #endif // READMZD_H
 
@@ -0,0 +1,360 @@
+/* ____________________________________________________________________________
+	Writing of ".mzd" mesh files, see writeMZD.h.
+  ____________________________________________________________________________
+*/
+
+#include "writeMZD.h"
+#include "halfToFloat.h"
+
+// 64 bit file offsets.
+#ifdef _WIN32
+	#define mzd_fseek64	_fseeki64
+	#define mzd_ftell64	_ftelli64
+#else
+	#define mzd_fseek64	fseeko
+	#define mzd_ftell64	ftello
+#endif
+
+// number of values which are converted per block.
+#define MZD_BLOCK_SIZE	4096
+
+// sections of the open chunk.
+enum
+{
+	MZD_SECTION_NONE = 0,
+	MZD_SECTION_POSITIONS,
+	MZD_SECTION_POLYGON_COUNTS,
+	MZD_SECTION_POLYGON_INDICES,
+	MZD_SECTION_ATTRIBUTE
+};
+
+
+// Stores the error in the writer and returns it.
+static int mzd_fail(MZDWriter &io_writer, int in_error)
+{
+	if (io_writer.error == 0)
+		io_writer.error = in_error;
+	return io_writer.error;
+}
+
+// Writes a block of data. Returns 0 on success.
+static int mzd_write(MZDWriter &io_writer, const void *in_data, size_t in_size, size_t in_count)
+{
+	if (in_count > 0 && fwrite(in_data, in_size, in_count, io_writer.file) != in_count)
+		return mzd_fail(io_writer, -2);
+	return 0;
+}
+
+// Writes a chunk header with a size of 0, which is patched by writeMZDEndChunk().
+static int mzd_beginChunk(MZDWriter &io_writer, unsigned int in_chunkID, const char *in_chunkName)
+{
+	char chunkName[24];
+	memset(chunkName, 0, 24);
+	strncpy(chunkName, in_chunkName, 23);
+	const unsigned int chunkSize = 0;
+	if (mzd_write(io_writer, &in_chunkID, 4, 1) != 0)		return io_writer.error;
+	if (mzd_write(io_writer, chunkName, 1, 24) != 0)		return io_writer.error;
+	if (mzd_write(io_writer, &chunkSize, 4, 1) != 0)		return io_writer.error;
+	io_writer.chunkID		= in_chunkID;
+	io_writer.chunkOffset	= mzd_ftell64(io_writer.file);
+	if (io_writer.chunkOffset < 0)
+		return mzd_fail(io_writer, -2);
+	return 0;
+}
+
+// Checks that a chunk is open and that its section can take in_count more values.
+static int mzd_checkSection(MZDWriter &io_writer, int in_section, size_t in_count)
+{
+	if (io_writer.error != 0)						return io_writer.error;
+	if (io_writer.section != in_section)			return mzd_fail(io_writer, -5);
+	if ((long long)in_count > io_writer.numExpected - io_writer.numWritten)
+		return mzd_fail(io_writer, -5);
+	return 0;
+}
+
+
+// Opens a .mzd file for writing and writes the file header.
+int writeMZDOpen(MZDWriter &io_writer, const char *in_fname)
+{
+	memset(&io_writer, 0, sizeof(MZDWriter));
+	io_writer.file = fopen(in_fname, "wb");
+	if (!io_writer.file)
+		return mzd_fail(io_writer, -1);
+	return mzd_write(io_writer, MZD_HEAD, 1, 24);
+}
+
+
+// Begins the vertex and polygon chunk. The index width is chosen from the
+// amount of vertices.
+int writeMZDBeginVertices(MZDWriter &io_writer, int in_numVertices)
+{
+	if (io_writer.error != 0)								return io_writer.error;
+	if (io_writer.chunkID != 0 || in_numVertices < 0)		return mzd_fail(io_writer, -5);
+	if (io_writer.numBytesPerPolyVInd != 0)					return mzd_fail(io_writer, -5);	// only one vertex chunk.
+	if (mzd_beginChunk(io_writer, 0x0ABC0001, "vertices and polygons") != 0)
+		return io_writer.error;
+	if (mzd_write(io_writer, &in_numVertices, 4, 1) != 0)
+		return io_writer.error;
+	io_writer.numVertices			= in_numVertices;
+	io_writer.numBytesPerPolyVInd	= in_numVertices <= 65536 ? 2 : 4;
+	io_writer.section				= MZD_SECTION_POSITIONS;
+	io_writer.numExpected			= in_numVertices;
+	io_writer.numWritten			= 0;
+	return 0;
+}
+
+
+// Writes the positions (3 floats each) of the next in_numVertices vertices.
+int writeMZDPositions(MZDWriter &io_writer, const float *in_positions, size_t in_numVertices)
+{
+	if (mzd_checkSection(io_writer, MZD_SECTION_POSITIONS, in_numVertices) != 0)
+		return io_writer.error;
+	if (mzd_write(io_writer, in_positions, 4, 3 * in_numVertices) != 0)
+		return io_writer.error;
+	io_writer.numWritten += in_numVertices;
+	return 0;
+}
+
+
+// Begins the polygon section of the vertex chunk once all positions are written.
+int writeMZDBeginPolygons(MZDWriter &io_writer, int in_numPolygons)
+{
+	if (mzd_checkSection(io_writer, MZD_SECTION_POSITIONS, 0) != 0)		return io_writer.error;
+	if (io_writer.numWritten != io_writer.numExpected)				return mzd_fail(io_writer, -5);
+	if (in_numPolygons < 0)											return mzd_fail(io_writer, -5);
+	if (mzd_write(io_writer, &in_numPolygons, 4, 1) != 0)
+		return io_writer.error;
+	io_writer.numPolygons	= in_numPolygons;
+	io_writer.section		= MZD_SECTION_POLYGON_COUNTS;
+	io_writer.numExpected	= in_numPolygons;
+	io_writer.numWritten	= 0;
+	return 0;
+}
+
+
+// Writes the vertex counts of the next in_numPolygons polygons.
+int writeMZDPolygonCounts(MZDWriter &io_writer, const unsigned char *in_counts, size_t in_numPolygons)
+{
+	if (mzd_checkSection(io_writer, MZD_SECTION_POLYGON_COUNTS, in_numPolygons) != 0)
+		return io_writer.error;
+	long long numNodes = io_writer.numNodes;
+	for (size_t i=0;i<in_numPolygons;i++)
+		numNodes += in_counts[i];
+	if (numNodes > 0x7fffffff)
+		return mzd_fail(io_writer, -5);
+	if (mzd_write(io_writer, in_counts, 1, in_numPolygons) != 0)
+		return io_writer.error;
+	io_writer.numNodes		 = numNodes;
+	io_writer.numWritten	+= in_numPolygons;
+	return 0;
+}
+
+
+// Writes the next in_numIndices polygon vertex indices, once all polygon
+// counts are written. Indices outside of the vertex range are rejected.
+int writeMZDPolygonIndices(MZDWriter &io_writer, const int *in_indices, size_t in_numIndices)
+{
+	// start the index section.
+	if (io_writer.error == 0 && io_writer.section == MZD_SECTION_POLYGON_COUNTS)
+	{
+		if (io_writer.numWritten != io_writer.numExpected)
+			return mzd_fail(io_writer, -5);
+		if (mzd_write(io_writer, &io_writer.numBytesPerPolyVInd, 4, 1) != 0)
+			return io_writer.error;
+		io_writer.section		= MZD_SECTION_POLYGON_INDICES;
+		io_writer.numExpected	= io_writer.numNodes;
+		io_writer.numWritten	= 0;
+	}
+	if (mzd_checkSection(io_writer, MZD_SECTION_POLYGON_INDICES, in_numIndices) != 0)
+		return io_writer.error;
+	for (size_t i=0;i<in_numIndices;i++)
+		if (in_indices[i] < 0 || in_indices[i] >= io_writer.numVertices)
+			return mzd_fail(io_writer, -5);
+
+	// int.
+	if (io_writer.numBytesPerPolyVInd == 4)
+	{
+		if (mzd_write(io_writer, in_indices, 4, in_numIndices) != 0)
+			return io_writer.error;
+	}
+
+	// unsigned short.
+	else
+	{
+		unsigned short block[MZD_BLOCK_SIZE];
+		for (size_t i=0;i<in_numIndices;i+=MZD_BLOCK_SIZE)
+		{
+			size_t n = in_numIndices - i < MZD_BLOCK_SIZE ? in_numIndices - i : MZD_BLOCK_SIZE;
+			for (size_t j=0;j<n;j++)
+				block[j] = (unsigned short)in_indices[i + j];
+			if (mzd_write(io_writer, block, 2, n) != 0)
+				return io_writer.error;
+		}
+	}
+	io_writer.numWritten += in_numIndices;
+	return 0;
+}
+
+
+// Begins an attribute chunk, e.g. 0xDA7A0001 for vertex normals. The amount
+// of elements is given by the vertex chunk, which must have been written.
+int writeMZDBeginAttribute(MZDWriter &io_writer, unsigned int in_chunkID)
+{
+	if (io_writer.error != 0)												return io_writer.error;
+	if (io_writer.chunkID != 0 || io_writer.numBytesPerPolyVInd == 0)		return mzd_fail(io_writer, -5);
+
+	const char	*name		= NULL;
+	long long	 num		= io_writer.numVertices;
+	int			 numComp	= 3;
+	switch (in_chunkID)
+	{
+		case 0xDA7A0001:	name = "vertex normals";										break;
+		case 0xDA7A0002:	name = "vertex motions";										break;
+		case 0xDA7A0003:	name = "vertex colors";		numComp = 4;						break;
+		case 0xDA7A0004:	name = "vertex UVWs";											break;
+		case 0xDA7A0011:	name = "node normals";		num = io_writer.numNodes;			break;
+		case 0xDA7A0013:	name = "node colors";		num = io_writer.numNodes;	numComp = 4;	break;
+		case 0xDA7A0014:	name = "node UVWs";			num = io_writer.numNodes;			break;
+		default:			return mzd_fail(io_writer, -5);
+	}
+
+	const int num32 = (int)num;
+	if (mzd_beginChunk(io_writer, in_chunkID, name) != 0)		return io_writer.error;
+	if (mzd_write(io_writer, &num32, 4, 1) != 0)				return io_writer.error;
+	io_writer.section		= MZD_SECTION_ATTRIBUTE;
+	io_writer.numComponents	= numComp;
+	io_writer.numExpected	= num;
+	io_writer.numWritten	= 0;
+	return 0;
+}
+
+
+// Writes the next in_numElements elements of the open attribute chunk.
+// Normals, motions and colors are converted to half floats.
+int writeMZDAttribute(MZDWriter &io_writer, const float *in_values, size_t in_numElements)
+{
+	if (mzd_checkSection(io_writer, MZD_SECTION_ATTRIBUTE, in_numElements) != 0)
+		return io_writer.error;
+	const size_t numValues = io_writer.numComponents * in_numElements;
+
+	// float.
+	if (io_writer.chunkID == 0xDA7A0004 || io_writer.chunkID == 0xDA7A0014)
+	{
+		if (mzd_write(io_writer, in_values, 4, numValues) != 0)
+			return io_writer.error;
+	}
+
+	// half.
+	else
+	{
+		unsigned short block[MZD_BLOCK_SIZE];
+		for (size_t i=0;i<numValues;i+=MZD_BLOCK_SIZE)
+		{
+			size_t n = numValues - i < MZD_BLOCK_SIZE ? numValues - i : MZD_BLOCK_SIZE;
+			mzd_floatToHalf(in_values + i, block, n);
+			if (mzd_write(io_writer, block, 2, n) != 0)
+				return io_writer.error;
+		}
+	}
+	io_writer.numWritten += in_numElements;
+	return 0;
+}
+
+
+// Ends the open chunk and writes its size into the chunk header.
+int writeMZDEndChunk(MZDWriter &io_writer)
+{
+	if (io_writer.error != 0)		return io_writer.error;
+	if (io_writer.chunkID == 0)		return mzd_fail(io_writer, -5);
+
+	// a vertex chunk without polygons gets an empty index section.
+	if (io_writer.section == MZD_SECTION_POLYGON_COUNTS && io_writer.numNodes == 0)
+	{
+		if (writeMZDPolygonIndices(io_writer, NULL, 0) != 0)
+			return io_writer.error;
+	}
+	if (io_writer.section == MZD_SECTION_POSITIONS || io_writer.section == MZD_SECTION_POLYGON_COUNTS)
+		return mzd_fail(io_writer, -5);
+	if (io_writer.numWritten != io_writer.numExpected)
+		return mzd_fail(io_writer, -5);
+
+	// patch the chunk size.
+	const long long end = mzd_ftell64(io_writer.file);
+	if (end < io_writer.chunkOffset)								return mzd_fail(io_writer, -2);
+	if (end - io_writer.chunkOffset > 0xffffffffLL)				return mzd_fail(io_writer, -5);
+	const unsigned int chunkSize = (unsigned int)(end - io_writer.chunkOffset);
+	if (mzd_fseek64(io_writer.file, io_writer.chunkOffset - 4, SEEK_SET) != 0)	return mzd_fail(io_writer, -2);
+	if (mzd_write(io_writer, &chunkSize, 4, 1) != 0)								return io_writer.error;
+	if (mzd_fseek64(io_writer.file, end, SEEK_SET) != 0)							return mzd_fail(io_writer, -2);
+
+	io_writer.chunkID		= 0;
+	io_writer.section		= MZD_SECTION_NONE;
+	io_writer.numExpected	= 0;
+	io_writer.numWritten	= 0;
+	return 0;
+}
+
+
+// Writes the file tail and closes the file. All chunks must have been ended.
+int writeMZDClose(MZDWriter &io_writer)
+{
+	if (io_writer.error == 0 && io_writer.chunkID != 0)
+		mzd_fail(io_writer, -5);
+	if (io_writer.error == 0)
+		mzd_write(io_writer, MZD_TAIL, 1, 24);
+	if (io_writer.file)
+	{
+		if (fclose(io_writer.file) != 0)
+			mzd_fail(io_writer, -2);
+		io_writer.file = NULL;
+	}
+	return io_writer.error;
+}
+
+
+// Writes a .mzd file with all chunks whose array is not NULL.
+// Return values:	 0: success.
+//					-1: unable to open file.
+//					-2: write error.
+//					-5: illegal parameter value.
+int writeMZD(const char				*in_fname,
+			 int					 in_numVertices,
+			 int					 in_numPolygons,
+			 const float			*in_vertPositions,
+			 const unsigned char	*in_polyVIndicesNum,
+			 const int				*in_polyVIndices,
+			 const float			*in_vertNormals,
+			 const float			*in_vertMotions,
+			 const float			*in_vertColors,
+			 const float			*in_vertUVWs,
+			 const float			*in_nodeNormals,
+			 const float			*in_nodeColors,
+			 const float			*in_nodeUVWs)
+{
+	if (in_numVertices < 0 || in_numPolygons < 0)
+		return -5;
+	if ((in_numVertices > 0 && !in_vertPositions) || (in_numPolygons > 0 && (!in_polyVIndicesNum || !in_polyVIndices)))
+		return -5;
+
+	MZDWriter writer;
+	if (writeMZDOpen(writer, in_fname) == 0 &&
+		writeMZDBeginVertices(writer, in_numVertices) == 0 &&
+		writeMZDPositions(writer, in_vertPositions, in_numVertices) == 0 &&
+		writeMZDBeginPolygons(writer, in_numPolygons) == 0 &&
+		writeMZDPolygonCounts(writer, in_polyVIndicesNum, in_numPolygons) == 0 &&
+		writeMZDPolygonIndices(writer, in_polyVIndices, (size_t)writer.numNodes) == 0 &&
+		writeMZDEndChunk(writer) == 0)
+	{
+		const unsigned int	 ids[7]		= { 0xDA7A0001, 0xDA7A0002, 0xDA7A0003, 0xDA7A0004, 0xDA7A0011, 0xDA7A0013, 0xDA7A0014 };
+		const float			*arrays[7]	= { in_vertNormals, in_vertMotions, in_vertColors, in_vertUVWs, in_nodeNormals, in_nodeColors, in_nodeUVWs };
+		for (int i=0;i<7;i++)
+		{
+			if (!arrays[i])
+				continue;
+			if (writeMZDBeginAttribute(writer, ids[i]) != 0)										break;
+			if (writeMZDAttribute(writer, arrays[i], (size_t)writer.numExpected) != 0)				break;
+			if (writeMZDEndChunk(writer) != 0)													break;
+		}
+	}
+	return writeMZDClose(writer);
+}
@@ -0,0 +1,75 @@
+/* ____________________________________________________________________________
+	Header file for writing ".mzd" mesh files, counterpart of readMZD.h.
+
+	writeMZD() writes a complete mesh with one call. For meshes which do not
+	fit into memory at once, the MZDWriter functions write the file piece by
+	piece: each chunk is begun, its arrays are written in any number of calls
+	and the chunk is ended, which patches its size in the chunk header.
+
+	Vertex positions and UVWs are stored as floats and are written without
+	any loss. Normals, motions and colors are stored as half floats and are
+	rounded to nearest even, values which are representable as half floats
+	are written without any loss. The polygon vertex indices are stored with
+	2 bytes if there are at most 65536 vertices, otherwise with 4 bytes.
+  ____________________________________________________________________________
+*/
+
+#ifndef WRITEMZD_H
+#define WRITEMZD_H
+
+#include "readMZD.h"
+
+// state of a streaming writer, see writeMZDOpen().
+struct MZDWriter
+{
+	FILE			*file;					// output file or NULL.
+	unsigned int	 chunkID;				// ID of the open chunk or 0.
+	long long		 chunkOffset;			// file offset of the data of the open chunk.
+	int				 section;				// section of the open chunk that is written.
+	int				 numVertices;			// amount of vertices.
+	int				 numPolygons;			// amount of polygons.
+	long long		 numNodes;				// amount of polygon nodes.
+	int				 numBytesPerPolyVInd;	// size of a polygon vertex index in the file (2 or 4).
+	int				 numComponents;			// components per element of the open attribute chunk.
+	long long		 numExpected;			// amount of values the current section expects.
+	long long		 numWritten;			// amount of values written to the current section.
+	int				 error;					// first error, all further calls fail with it.
+};
+
+// writes a complete .mzd file. The attribute arrays are optional, chunks
+// whose array is NULL are not written. The array sizes are the same as for
+// readMZD().
+int writeMZD(const char				*in_fname,				// output file name.
+			 int					 in_numVertices,		// amount of vertices.
+			 int					 in_numPolygons,		// amount of polygons.
+			 const float			*in_vertPositions,		// array of vertex positions.
+			 const unsigned char	*in_polyVIndicesNum,	// array of polygon vertex indices count.
+			 const int				*in_polyVIndices,		// array of polygon vertex indices.
+			 const float			*in_vertNormals	= NULL,	// array of vertex normal vectors.
+			 const float			*in_vertMotions	= NULL,	// array of vertex motion vectors.
+			 const float			*in_vertColors	= NULL,	// array of vertex colors.
+			 const float			*in_vertUVWs	= NULL,	// array of vertex UVW coordinates.
+			 const float			*in_nodeNormals	= NULL,	// array of polygon node normal vectors.
+			 const float			*in_nodeColors	= NULL,	// array of polygon node colors.
+			 const float			*in_nodeUVWs	= NULL);// array of polygon node UVW coordinates.
+
+// streaming writer. All functions return 0 on success and a negative value
+// on failure, see writeMZD(). After a failure writeMZDClose() just closes the
+// file. The call order is:
+//	writeMZDOpen()
+//	writeMZDBeginVertices(), writeMZDPositions()..., writeMZDBeginPolygons(),
+//		writeMZDPolygonCounts()..., writeMZDPolygonIndices()..., writeMZDEndChunk()
+//	{ writeMZDBeginAttribute(), writeMZDAttribute()..., writeMZDEndChunk() }
+//	writeMZDClose()
+int writeMZDOpen(MZDWriter &io_writer, const char *in_fname);
+int writeMZDBeginVertices(MZDWriter &io_writer, int in_numVertices);
+int writeMZDPositions(MZDWriter &io_writer, const float *in_positions, size_t in_numVertices);
+int writeMZDBeginPolygons(MZDWriter &io_writer, int in_numPolygons);
+int writeMZDPolygonCounts(MZDWriter &io_writer, const unsigned char *in_counts, size_t in_numPolygons);
+int writeMZDPolygonIndices(MZDWriter &io_writer, const int *in_indices, size_t in_numIndices);
+int writeMZDBeginAttribute(MZDWriter &io_writer, unsigned int in_chunkID);
+int writeMZDAttribute(MZDWriter &io_writer, const float *in_values, size_t in_numElements);
+int writeMZDEndChunk(MZDWriter &io_writer);
+int writeMZDClose(MZDWriter &io_writer);
+
+#endif // WRITEMZD_H
@@ -0,0 +1,133 @@
+#ifndef __FileSequence_h__
+#define __FileSequence_h__
+
+#include "FileSystem.h"
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstdio>
+
+namespace Utilities
+{
+	/** \brief File names of a sequence given by a pattern, independent of Maya.
+	* The first run of '#' in the pattern is the placeholder of the frame index,
+	* which is padded with zeros to the length of the run, e.g. "mesh_###.ply"
+	* is "mesh_007.ply" for frame 7. Larger indices use more digits. Quotes in
+	* the pattern are ignored. The pattern is parsed once by setPattern(), which
+	* also prepares the file name with a zero index, so that getFileName() only
+	* formats the index into a copy of it.
+	*/
+	class FileSequence
+	{
+	public:
+		FileSequence() : m_padding(0) {}
+
+		explicit FileSequence(const std::string &pattern)
+		{
+			setPattern(pattern);
+		}
+
+		void setPattern(const std::string &pattern)
+		{
+			m_pattern = pattern;
+
+			// remove "
+			m_pattern.erase(std::remove(m_pattern.begin(), m_pattern.end(), '\"'), m_pattern.end());
+
+			const std::string::size_type pos1 = m_pattern.find_first_of("#", 0);
+			if (pos1 == std::string::npos)
+			{
+				m_prefix = m_pattern;
+				m_suffix = "";
+				m_padding = 0;
+				m_fileName = m_pattern;
+				return;
+			}
+			std::string::size_type pos2 = m_pattern.find_first_not_of("#", pos1);
+			if (pos2 == std::string::npos)
+				pos2 = m_pattern.length();
+			m_prefix = m_pattern.substr(0, pos1);
+			m_suffix = m_pattern.substr(pos2);
+			m_padding = (unsigned int)(pos2 - pos1);
+			m_fileName = m_prefix + std::string(m_padding, '0') + m_suffix;
+		}
+
+		const std::string &getPattern() const { return m_pattern; }
+
+		/** True if the pattern contains a placeholder for the frame index. */
+		bool isSequence() const { return m_padding > 0; }
+
+		/** File name of a frame, the pattern itself if it is no sequence. */
+		std::string getFileName(const unsigned int frame) const
+		{
+			if (!isSequence())
+				return m_prefix;
+			char digits[16];
+			const int numDigits = snprintf(digits, sizeof(digits), "%u", frame);
+			if ((unsigned int)numDigits > m_padding)
+				return m_prefix + digits + m_suffix;
+			// right aligned in the zeros of the prepared name
+			std::string fileName = m_fileName;
+			fileName.replace(m_prefix.length() + m_padding - numDigits, numDigits, digits, numDigits);
+			return fileName;
+		}
+
+		/** Find the first and last frame index of the existing files of the
+		* sequence by listing the directory of the pattern. Returns false if
+		* there is no file.
+		*/
+		bool findFrameRange(int &firstFrame, int &lastFrame) const
+		{
+			if (!isSequence())
+				return false;
+
+			const std::string::size_type slash = m_prefix.find_last_of("/\\");
+			const std::string dir = (slash == std::string::npos) ? "." : m_prefix.substr(0, slash + 1);
+			const std::string prefix = (slash == std::string::npos) ? m_prefix : m_prefix.substr(slash + 1);
+			if ((m_suffix.find_first_of("/\\") != std::string::npos))
+				return false;
+
+			std::vector<std::string> files;
+			if (!FileSystem::getFilesInDirectory(dir, files))
+				return false;
+
+			firstFrame = INT_MAX;
+			lastFrame = INT_MIN;
+			for (const std::string &file : files)
+			{
+				if ((file.length() < prefix.length() + m_suffix.length() + m_padding) ||
+					(file.compare(0, prefix.length(), prefix) != 0) ||
+					(file.compare(file.length() - m_suffix.length(), m_suffix.length(), m_suffix) != 0))
+					continue;
+				const std::string number = file.substr(prefix.length(), file.length() - prefix.length() - m_suffix.length());
+				if (number.find_first_not_of("0123456789") != std::string::npos)
+					continue;
+				const int frame = atoi(number.c_str());
+				firstFrame = std::min(firstFrame, frame);
+				lastFrame = std::max(lastFrame, frame);
+			}
+			return firstFrame <= lastFrame;
+		}
+
+		static std::string zeroPadding(const unsigned int number, const unsigned int length)
+		{
+			std::ostringstream out;
+			out << std::internal << std::setfill('0') << std::setw(length) << number;
+			return out.str();
+		}
+
+	protected:
+		std::string m_pattern;
+		std::string m_prefix;
+		std::string m_suffix;
+		unsigned int m_padding;
+		/** File name of frame 0 */
+		std::string m_fileName;
+	};
+}
+
+#endif
@@ -2,6 +2,8 @@
 #define __FileSystem_h__
 
 #include "StringTools.h"
+#include <string.h>
+#include <algorithm>
 #include <sys/stat.h>
 #ifdef WIN32
 #include <direct.h>
@@ -266,6 +268,31 @@ namespace Utilities
 			return false;
 		}
 
+		/** Get the time of the last modification of a file in nanoseconds and its size
+		* in bytes. Returns false if the file does not exist. On Windows the time has a
+		* resolution of seconds.
+		*/
+		static bool getFileStatus(const std::string &path, long long &mtime, long long &fileSize)
+		{
+#ifdef WIN32
+			struct _stat64 st;
+			if (_stat64(path.c_str(), &st))
+				return false;
+			mtime = (long long)st.st_mtime * 1000000000LL;
+#else
+			struct stat st;
+			if (stat(path.c_str(), &st))
+				return false;
+#ifdef __APPLE__
+			mtime = (long long)st.st_mtimespec.tv_sec * 1000000000LL + (long long)st.st_mtimespec.tv_nsec;
+#else
+			mtime = (long long)st.st_mtim.tv_sec * 1000000000LL + (long long)st.st_mtim.tv_nsec;
+#endif
+#endif
+			fileSize = (long long)st.st_size;
+			return true;
+		}
+
 		static bool getFilesInDirectory(const std::string& path, std::vector<std::string> &res)
 		{
 #ifdef WIN32
@@ -0,0 +1,324 @@
+#ifndef __FrameCache_h__
+#define __FrameCache_h__
+
+#include "MeshData.h"
+#include "MeshReader.h"
+#include "FileSystem.h"
+#include <string>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <exception>
+#include <new>
+
+namespace Utilities
+{
+	/** \brief Process wide cache of decoded frames with least recently used eviction.
+	* All MeshLoader nodes and their prefetch threads share one instance, see
+	* getInstance(). Frames are identified by the resolved file path, the
+	* modification time and size of the file and the positions only flag. A file
+	* which was changed on disk is a miss and its old frame is removed. The memory
+	* used by all cached frames is kept below a byte budget, a budget of 0
+	* disables the cache. Frames are reference counted, so an evicted frame stays
+	* valid as long as a node still uses it.
+	*
+	* load() reads a file at most once at a time: if several threads request the
+	* same file, the first one reads it and the others wait for its result.
+	*/
+	class FrameCache
+	{
+	public:
+		/** Default budget of the shared cache: 1 GB */
+		static const size_t DEFAULT_BUDGET = (size_t)1024 * 1024 * 1024;
+
+		explicit FrameCache(const size_t budget = 0) : m_budget(budget), m_memoryUsage(0), m_hits(0), m_misses(0) {}
+
+		FrameCache(const FrameCache&) = delete;
+		FrameCache& operator=(const FrameCache&) = delete;
+
+		/** The cache shared by all nodes of the plugin. */
+		static FrameCache &getInstance()
+		{
+			static FrameCache cache(DEFAULT_BUDGET);
+			return cache;
+		}
+
+		/** Return the frame of a file. The file is only read if it is neither
+		* cached nor being read by another thread. Returns null and sets error if
+		* reading failed. If fileRead is given, it is set to true if this call read
+		* the file and to false if the frame was cached or read by another thread.
+		* measureRead is passed to MeshReader::read().
+		*/
+		std::shared_ptr<MeshData> load(const std::string &fileName, const bool positionsOnly, std::string &error, bool *fileRead = nullptr,
+			const bool measureRead = false)
+		{
+			const Key key(fileName, positionsOnly);
+			if (fileRead != nullptr)
+				*fileRead = false;
+			// the status is taken before reading, so that a concurrent change of the file is a miss next time
+			const FileStatus status = getFileStatus(fileName);
+			std::unique_lock<std::mutex> lock(m_mutex);
+			std::map<Key, std::list<Entry>::iterator>::iterator it = find(key, status);
+			if (it != m_index.end())
+			{
+				// move to the front of the LRU list
+				m_entries.splice(m_entries.begin(), m_entries, it->second);
+				m_hits++;
+				return it->second->mesh;
+			}
+
+			// wait for another thread which is reading the file
+			std::map<Key, std::shared_future<Result> >::iterator loading = m_loading.find(key);
+			if (loading != m_loading.end())
+			{
+				std::shared_future<Result> future = loading->second;
+				m_hits++;
+				lock.unlock();
+				try
+				{
+					const Result &result = future.get();
+					error = result.error;
+					return result.mesh;
+				}
+				catch (const std::exception &e)
+				{
+					error = std::string("Exception: ") + e.what();
+					return nullptr;
+				}
+			}
+
+			m_misses++;
+			if (fileRead != nullptr)
+				*fileRead = true;
+			std::promise<Result> promise;
+			m_loading[key] = promise.get_future().share();
+			lock.unlock();
+
+			// from here on the file has to be removed from m_loading and the promise
+			// has to be fulfilled, even if an exception is thrown, otherwise the
+			// waiting threads get a broken promise and the file is never read again
+			Result result;
+			std::exception_ptr exception;
+			try
+			{
+				read(fileName, positionsOnly, measureRead, result);
+			}
+			catch (...)
+			{
+				// e.g. an exception which is not derived from std::exception
+				result.mesh.reset();
+				exception = std::current_exception();
+			}
+
+			lock.lock();
+			if (result.mesh && status.exists)
+			{
+				try
+				{
+					insert(key, status, result.mesh);
+				}
+				catch (const std::bad_alloc &)
+				{
+					// the frame is returned without caching it
+				}
+			}
+			m_loading.erase(key);
+			lock.unlock();
+
+			if (exception)
+			{
+				promise.set_exception(exception);
+				std::rethrow_exception(exception);
+			}
+			try
+			{
+				promise.set_value(result);
+			}
+			catch (...)
+			{
+				promise.set_exception(std::current_exception());
+				throw;
+			}
+			error = result.error;
+			return result.mesh;
+		}
+
+		/** Check whether a file is cached without counting it or changing the LRU order. */
+		bool contains(const std::string &fileName, const bool positionsOnly)
+		{
+			const FileStatus status = getFileStatus(fileName);
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return find(Key(fileName, positionsOnly), status) != m_index.end();
+		}
+
+		/** Set the budget in bytes and evict frames which do not fit anymore. */
+		void setBudget(const size_t budget)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_budget = budget;
+			evict(m_budget);
+		}
+
+		void clear()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_entries.clear();
+			m_index.clear();
+			m_memoryUsage = 0;
+		}
+
+		void resetCounters()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_hits = 0;
+			m_misses = 0;
+		}
+
+		size_t getBudget() { std::lock_guard<std::mutex> lock(m_mutex); return m_budget; }
+		size_t getMemoryUsage() { std::lock_guard<std::mutex> lock(m_mutex); return m_memoryUsage; }
+		size_t getNumFrames() { std::lock_guard<std::mutex> lock(m_mutex); return m_entries.size(); }
+		/** Number of requests which did not read the file */
+		unsigned long long getHits() { std::lock_guard<std::mutex> lock(m_mutex); return m_hits; }
+		/** Number of requests which read the file */
+		unsigned long long getMisses() { std::lock_guard<std::mutex> lock(m_mutex); return m_misses; }
+
+	protected:
+		typedef std::pair<std::string, bool> Key;
+
+		/** Modification time in nanoseconds and size of a file */
+		struct FileStatus
+		{
+			bool exists = false;
+			long long mtime = 0;
+			long long fileSize = 0;
+
+			bool operator==(const FileStatus &other) const
+			{
+				return (exists == other.exists) && (mtime == other.mtime) && (fileSize == other.fileSize);
+			}
+		};
+
+		struct Entry
+		{
+			Key key;
+			FileStatus status;
+			/** Memory size of the frame */
+			size_t size;
+			std::shared_ptr<MeshData> mesh;
+		};
+
+		struct Result
+		{
+			std::shared_ptr<MeshData> mesh;
+			std::string error;
+		};
+
+		std::mutex m_mutex;
+		/** Most recently used frame first */
+		std::list<Entry> m_entries;
+		std::map<Key, std::list<Entry>::iterator> m_index;
+		/** Files which are currently read */
+		std::map<Key, std::shared_future<Result> > m_loading;
+		size_t m_budget;
+		size_t m_memoryUsage;
+		unsigned long long m_hits;
+		unsigned long long m_misses;
+
+		/** Read a file without locking the cache. Exceptions derived from
+		* std::exception are returned as error.
+		*/
+		static void read(const std::string &fileName, const bool positionsOnly, const bool measureRead, Result &result)
+		{
+			try
+			{
+				result.mesh = std::make_shared<MeshData>();
+				if (!MeshReader::read(fileName, positionsOnly, *result.mesh, result.error, measureRead))
+					result.mesh.reset();
+			}
+			catch (const std::exception &e)
+			{
+				result.mesh.reset();
+				result.error = std::string("Exception: ") + e.what();
+			}
+		}
+
+		/** The file system is queried before the mutex is locked, so that a slow
+		* file system does not block the other threads.
+		*/
+		static FileStatus getFileStatus(const std::string &fileName)
+		{
+			FileStatus status;
+			status.exists = FileSystem::getFileStatus(fileName, status.mtime, status.fileSize);
+			return status;
+		}
+
+		/** Find an up to date frame. Frames of files which were modified or deleted
+		* since they were read, i.e. whose current status differs, are removed.
+		*/
+		std::map<Key, std::list<Entry>::iterator>::iterator find(const Key &key, const FileStatus &status)
+		{
+			std::map<Key, std::list<Entry>::iterator>::iterator it = m_index.find(key);
+			if (it == m_index.end())
+				return it;
+			if (!status.exists || !(status == it->second->status))
+			{
+				remove(key);
+				return m_index.end();
+			}
+			return it;
+		}
+
+		/** Add a frame, older frames are evicted until it fits into the budget.
+		* Frames which are larger than the budget are not cached. If an exception
+		* is thrown, the frame is not added and the cache is unchanged.
+		*/
+		void insert(const Key &key, const FileStatus &status, const std::shared_ptr<MeshData> &mesh)
+		{
+			remove(key);
+			const size_t size = mesh->memorySize();
+			if (size > m_budget)
+				return;
+
+			Entry entry;
+			entry.key = key;
+			entry.status = status;
+			entry.size = size;
+			entry.mesh = mesh;
+			m_entries.push_front(entry);
+			try
+			{
+				m_index[key] = m_entries.begin();
+			}
+			catch (...)
+			{
+				m_entries.pop_front();
+				throw;
+			}
+
+			// the new frame is at the front of the LRU list, so it is not evicted itself
+			m_memoryUsage += size;
+			evict(m_budget);
+		}
+
+		void remove(const Key &key)
+		{
+			std::map<Key, std::list<Entry>::iterator>::iterator it = m_index.find(key);
+			if (it == m_index.end())
+				return;
+			m_memoryUsage -= it->second->size;
+			m_entries.erase(it->second);
+			m_index.erase(it);
+		}
+
+		/** Remove the least recently used frames until the memory usage is at most budget. */
+		void evict(const size_t budget)
+		{
+			while ((m_memoryUsage > budget) && !m_entries.empty())
+				remove(m_entries.back().key);
+		}
+	};
+}
+
+#endif
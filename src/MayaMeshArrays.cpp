@@ -0,0 +1,83 @@
+#include "MayaMeshArrays.h"
+#include "ThreadPool.h"
+
+void MayaMeshArrays::set(const Utilities::MeshData &mesh)
+{
+	const unsigned int numVertices = (unsigned int)mesh.numVertices();
+	const unsigned int numConnects = (unsigned int)mesh.connects.size();
+
+	// the positions are stored as (x, y, z, 1) like MFloatPoint
+	points = MFloatPointArray(reinterpret_cast<const float (*)[4]>(mesh.positions.data()), numVertices);
+	polyCounts = MIntArray(mesh.counts.data(), (unsigned int)mesh.counts.size());
+	polyConnects = MIntArray(mesh.connects.data(), numConnects);
+
+	normalFaces.clear();
+	if (mesh.hasNormals())
+		normals = MVectorArray(reinterpret_cast<const float (*)[3]>(mesh.normals.data()), numVertices);
+	else if (mesh.hasFaceVaryingNormals())
+	{
+		m_normalBuffer.resize(3 * (size_t)numConnects);
+		const float *n = mesh.normals.data();
+		float *out = m_normalBuffer.data();
+		Utilities::ThreadPool::getInstance().parallelFor(0, numConnects, [&](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const float *fn = &n[3 * mesh.normalIds[i]];
+				out[3 * i] = fn[0];
+				out[3 * i + 1] = fn[1];
+				out[3 * i + 2] = fn[2];
+			}
+		});
+		normals = MVectorArray(reinterpret_cast<const float (*)[3]>(m_normalBuffer.data()), numConnects);
+
+		m_faceBuffer.resize(numConnects);
+		size_t index = 0;
+		for (int f = 0; f < mesh.numPolygons(); f++)
+			for (int k = 0; k < mesh.counts[f]; k++)
+				m_faceBuffer[index++] = f;
+		normalFaces = MIntArray(m_faceBuffer.data(), numConnects);
+	}
+	else
+		normals.clear();
+
+	if (mesh.hasColors())
+		colors = MColorArray(reinterpret_cast<const float (*)[4]>(mesh.colors.data()), numVertices);
+	else
+		colors.clear();
+
+	// all u values are followed by all v values, per-vertex UVs are indexed by the vertex indices
+	if (mesh.hasUVs())
+	{
+		const unsigned int numUVs = (unsigned int)mesh.numUVs();
+		uArray = MFloatArray(mesh.uvs.data(), numUVs);
+		vArray = MFloatArray(mesh.uvs.data() + numUVs, numUVs);
+		if (mesh.uvIds.empty())
+			uvIds = polyConnects;
+		else
+			uvIds = MIntArray(mesh.uvIds.data(), numConnects);
+	}
+	else
+	{
+		uArray.clear();
+		vArray.clear();
+		uvIds.clear();
+	}
+
+	// only the entries after the ones of the largest mesh so far are filled
+	if (m_vertexList.length() != numVertices)
+	{
+		const size_t numFilled = m_vertexIndices.size();
+		if (numFilled < numVertices)
+		{
+			m_vertexIndices.resize(numVertices);
+			int *indices = m_vertexIndices.data();
+			Utilities::ThreadPool::getInstance().parallelFor(numFilled, numVertices, [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					indices[i] = (int)i;
+			});
+		}
+		m_vertexList = MIntArray(m_vertexIndices.data(), numVertices);
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef __MayaMeshArrays_h__
+#define __MayaMeshArrays_h__
+
+#include <maya/MFloatPointArray.h>
+#include <maya/MFloatArray.h>
+#include <maya/MIntArray.h>
+#include <maya/MVectorArray.h>
+#include <maya/MColorArray.h>
+#include "MeshData.h"
+#include <vector>
+
+/** \brief Arrays of a Maya mesh as passed to MFnMesh, converted from a MeshData object.
+* The float arrays of MeshData have the layout of the Maya arrays, so points,
+* per-vertex normals, colors and UVs are filled by the bulk constructors of the
+* Maya arrays from the contiguous buffers instead of element by element. Only
+* face-varying normals are resolved by a loop over their index array. This loop
+* and the one which fills the identity vertex list run on the shared ThreadPool.
+* They write to plain buffers, which are then copied by the bulk constructors,
+* since the Maya arrays must not be written by several threads.
+*
+* The identity vertex list, which setVertexNormals() and setVertexColors() need
+* for per-vertex attributes, is kept between frames and only the new entries
+* are filled if a mesh has more vertices than all meshes before.
+*/
+class MayaMeshArrays
+{
+public:
+	MFloatPointArray points;
+	MIntArray polyCounts;
+	MIntArray polyConnects;
+	/** Normal of each vertex or, for face-varying normals, of each polygon vertex */
+	MVectorArray normals;
+	/** Polygon of each polygon vertex for setFaceVertexNormals(), only set for face-varying normals */
+	MIntArray normalFaces;
+	MColorArray colors;
+	MFloatArray uArray;
+	MFloatArray vArray;
+	MIntArray uvIds;
+
+	/** Convert a mesh. Attributes which the mesh does not have are cleared. */
+	void set(const Utilities::MeshData &mesh);
+
+	/** Vertex indices 0, ..., numVertices - 1 of the last converted mesh. */
+	const MIntArray &vertexList() const { return m_vertexList; }
+
+protected:
+	MIntArray m_vertexList;
+	/** Identity vertex list of the largest mesh so far */
+	std::vector<int> m_vertexIndices;
+	/** Buffer of the resolved face-varying normals */
+	std::vector<float> m_normalBuffer;
+	/** Buffer of normalFaces */
+	std::vector<int> m_faceBuffer;
+};
+
+#endif
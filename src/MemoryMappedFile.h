@@ -0,0 +1,163 @@
+#ifndef __MemoryMappedFile_h__
+#define __MemoryMappedFile_h__
+
+#include <string>
+#include <cstddef>
+#ifdef WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include "windows.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Utilities
+{
+	/** \brief Read-only memory mapped view of a file.
+	* The file is mapped with a sequential access hint, so the parsers can read
+	* the data directly from the page cache without copying it into stream buffers.
+	* An empty file cannot be mapped, it is opened with a null data pointer and
+	* a size of 0.
+	*/
+	class MemoryMappedFile
+	{
+	public:
+		MemoryMappedFile() : m_data(nullptr), m_size(0), m_open(false)
+		{
+#ifdef WIN32
+			m_file = INVALID_HANDLE_VALUE;
+			m_mapping = NULL;
+#endif
+		}
+
+		explicit MemoryMappedFile(const std::string &fileName) : MemoryMappedFile()
+		{
+			open(fileName);
+		}
+
+		~MemoryMappedFile()
+		{
+			close();
+		}
+
+		MemoryMappedFile(const MemoryMappedFile&) = delete;
+		MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+		/** Map the complete file. Returns false if the file cannot be opened or mapped. */
+		bool open(const std::string &fileName)
+		{
+			close();
+#ifdef WIN32
+			m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (m_file == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(m_file, &fileSize))
+			{
+				close();
+				return false;
+			}
+			if (fileSize.QuadPart == 0)
+			{
+				CloseHandle(m_file);
+				m_file = INVALID_HANDLE_VALUE;
+				m_open = true;
+				return true;
+			}
+			m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (m_mapping == NULL)
+			{
+				close();
+				return false;
+			}
+			m_data = (const char *) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+			if (m_data == nullptr)
+			{
+				close();
+				return false;
+			}
+			m_size = (size_t)fileSize.QuadPart;
+#else
+			const int fd = ::open(fileName.c_str(), O_RDONLY);
+			if (fd < 0)
+				return false;
+			struct stat st;
+			if ((fstat(fd, &st) != 0) || (st.st_size < 0))
+			{
+				::close(fd);
+				return false;
+			}
+			if (st.st_size == 0)
+			{
+				::close(fd);
+				m_open = true;
+				return true;
+			}
+			void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			// the mapping stays valid after closing the descriptor
+			::close(fd);
+			if (data == MAP_FAILED)
+				return false;
+			madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+			madvise(data, (size_t)st.st_size, MADV_WILLNEED);
+			m_data = (const char *) data;
+			m_size = (size_t)st.st_size;
+#endif
+			m_open = true;
+			return true;
+		}
+
+		void close()
+		{
+#ifdef WIN32
+			if (m_data != nullptr)
+				UnmapViewOfFile(m_data);
+			if (m_mapping != NULL)
+				CloseHandle(m_mapping);
+			if (m_file != INVALID_HANDLE_VALUE)
+				CloseHandle(m_file);
+			m_file = INVALID_HANDLE_VALUE;
+			m_mapping = NULL;
+#else
+			if (m_data != nullptr)
+				munmap((void *) m_data, m_size);
+#endif
+			m_data = nullptr;
+			m_size = 0;
+			m_open = false;
+		}
+
+		/** Read one byte of each page, so that the whole file is in memory afterwards.
+		* Used to measure the file access separately from parsing.
+		*/
+		void touch() const
+		{
+			const size_t pageSize = 4096;
+			unsigned char sum = 0;
+			for (size_t i = 0; i < m_size; i += pageSize)
+				sum ^= (unsigned char)m_data[i];
+			volatile unsigned char result = sum;
+			(void)result;
+		}
+
+		bool isOpen() const { return m_open; }
+		const char *data() const { return m_data; }
+		const char *end() const { return m_data + m_size; }
+		size_t size() const { return m_size; }
+
+	protected:
+		const char *m_data;
+		size_t m_size;
+		bool m_open;
+#ifdef WIN32
+		HANDLE m_file;
+		HANDLE m_mapping;
+#endif
+	};
+}
+
+#endif
@@ -0,0 +1,233 @@
+#include "MeshCacheFile.h"
+#include "MemoryMappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <new>
+
+using namespace Utilities;
+
+namespace
+{
+	/** Reserve an aligned range of size bytes at offset and advance offset. */
+	uint64_t nextOffset(uint64_t &offset, const uint64_t size)
+	{
+		const uint64_t start = (offset + MeshCacheFile::ALIGNMENT - 1) / MeshCacheFile::ALIGNMENT * MeshCacheFile::ALIGNMENT;
+		offset = start + size;
+		return start;
+	}
+
+	template<class T>
+	void copyToOffset(std::vector<char> &data, const uint64_t offset, const std::vector<T> &values)
+	{
+		if (!values.empty())
+			memcpy(data.data() + offset, values.data(), values.size() * sizeof(T));
+	}
+
+	bool checkArray(const uint64_t offset, const uint64_t size, const uint64_t fileSize, const bool optional)
+	{
+		if (offset == 0)
+			return optional || (size == 0);
+		return (offset % MeshCacheFile::ALIGNMENT == 0) && (offset >= sizeof(MeshCacheFile::Header)) && (offset <= fileSize) && (size <= fileSize - offset);
+	}
+
+	template<class T>
+	void copyArray(const char *data, const uint64_t offset, const size_t count, std::vector<T> &out)
+	{
+		if (offset == 0)
+			return;
+		out.resize(count);
+		if (count > 0)
+			memcpy(out.data(), data + offset, count * sizeof(T));
+	}
+
+	bool checkIds(const std::vector<int> &ids, const uint32_t numValues)
+	{
+		for (const int id : ids)
+			if ((id < 0) || ((uint32_t)id >= numValues))
+				return false;
+		return true;
+	}
+
+	/** The polygon sizes must not be negative and add up to the number of polygon vertices. */
+	bool checkCounts(const std::vector<int> &counts, const uint32_t numConnects)
+	{
+		uint64_t sum = 0;
+		for (const int count : counts)
+		{
+			if (count < 0)
+				return false;
+			sum += (uint64_t)count;
+		}
+		return sum == numConnects;
+	}
+
+	void computeBoundingBox(const MeshData &mesh, float minX[3], float maxX[3])
+	{
+		const size_t n = (size_t)mesh.numVertices();
+		for (int k = 0; k < 3; k++)
+		{
+			minX[k] = (n > 0) ? mesh.positions[k] : 0.0f;
+			maxX[k] = minX[k];
+		}
+		for (size_t i = 1; i < n; i++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				minX[k] = std::min(minX[k], mesh.positions[4 * i + k]);
+				maxX[k] = std::max(maxX[k], mesh.positions[4 * i + k]);
+			}
+		}
+	}
+}
+
+bool MeshCacheFile::write(const std::string &fileName, const MeshData &mesh, std::string &error)
+{
+	std::vector<char> data;
+	encode(mesh, data);
+	FILE *file = fopen(fileName.c_str(), "wb");
+	if (!file)
+	{
+		error = "Error: unable to open file " + fileName;
+		return false;
+	}
+	bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+	ok = (fclose(file) == 0) && ok;
+	if (!ok)
+		error = "Error: unable to write file " + fileName;
+	return ok;
+}
+
+void MeshCacheFile::encode(const MeshData &mesh, std::vector<char> &data)
+{
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	memcpy(header.magic, "MTCF", 4);
+	header.version = VERSION;
+	header.numVertices = (uint32_t)mesh.numVertices();
+	header.numPolygons = (uint32_t)mesh.numPolygons();
+	header.numConnects = (uint32_t)mesh.connects.size();
+	header.headerSize = (uint32_t)sizeof(Header);
+	header.topologyHash = (mesh.topologyHash != 0) ? mesh.topologyHash : mesh.computeTopologyHash();
+	computeBoundingBox(mesh, header.boundingBoxMin, header.boundingBoxMax);
+
+	// layout of the arrays
+	uint64_t offset = sizeof(Header);
+	header.positionsOffset = nextOffset(offset, mesh.positions.size() * sizeof(float));
+	header.countsOffset = nextOffset(offset, mesh.counts.size() * sizeof(int32_t));
+	header.connectsOffset = nextOffset(offset, mesh.connects.size() * sizeof(int32_t));
+	const bool faceVaryingNormals = mesh.hasFaceVaryingNormals();
+	if (mesh.hasNormals() || faceVaryingNormals)
+		header.normalsOffset = nextOffset(offset, mesh.normals.size() * sizeof(float));
+	if (mesh.hasColors())
+		header.colorsOffset = nextOffset(offset, mesh.colors.size() * sizeof(float));
+	if (mesh.hasUVs())
+	{
+		header.numUVs = (uint32_t)mesh.numUVs();
+		header.uvsOffset = nextOffset(offset, mesh.uvs.size() * sizeof(float));
+		if (!mesh.uvIds.empty())
+			header.uvIdsOffset = nextOffset(offset, mesh.uvIds.size() * sizeof(int32_t));
+	}
+	if (faceVaryingNormals)
+	{
+		header.numNormals = (uint32_t)(mesh.normals.size() / 3);
+		header.normalIdsOffset = nextOffset(offset, mesh.normalIds.size() * sizeof(int32_t));
+	}
+
+	// the gaps between the arrays are zero
+	data.assign((size_t)offset, 0);
+	memcpy(data.data(), &header, sizeof(Header));
+	copyToOffset(data, header.positionsOffset, mesh.positions);
+	copyToOffset(data, header.countsOffset, mesh.counts);
+	copyToOffset(data, header.connectsOffset, mesh.connects);
+	if (header.normalsOffset != 0)
+		copyToOffset(data, header.normalsOffset, mesh.normals);
+	if (header.colorsOffset != 0)
+		copyToOffset(data, header.colorsOffset, mesh.colors);
+	if (header.uvsOffset != 0)
+		copyToOffset(data, header.uvsOffset, mesh.uvs);
+	if (header.uvIdsOffset != 0)
+		copyToOffset(data, header.uvIdsOffset, mesh.uvIds);
+	if (header.normalIdsOffset != 0)
+		copyToOffset(data, header.normalIdsOffset, mesh.normalIds);
+}
+
+bool MeshCacheFile::read(const std::string &fileName, const bool positionsOnly, MeshData &mesh, std::string &error)
+{
+	mesh.clear();
+	MemoryMappedFile file;
+	if (!file.open(fileName))
+	{
+		error = "Error: unable to open file " + fileName;
+		return false;
+	}
+	return readFromMemory(file.data(), file.size(), positionsOnly, mesh, error);
+}
+
+bool MeshCacheFile::readFromMemory(const char *data, const size_t size, const bool positionsOnly, MeshData &mesh, std::string &error)
+{
+	mesh.clear();
+	Header header;
+	if (!readHeader(data, size, header))
+	{
+		error = "Error: wrong file format.";
+		return false;
+	}
+
+	try
+	{
+		copyArray(data, header.positionsOffset, 4 * (size_t)header.numVertices, mesh.positions);
+		copyArray(data, header.countsOffset, header.numPolygons, mesh.counts);
+		copyArray(data, header.connectsOffset, header.numConnects, mesh.connects);
+		if (!positionsOnly)
+		{
+			const size_t numNormals = (header.normalIdsOffset != 0) ? header.numNormals : header.numVertices;
+			copyArray(data, header.normalsOffset, 3 * numNormals, mesh.normals);
+			copyArray(data, header.normalIdsOffset, header.numConnects, mesh.normalIds);
+			copyArray(data, header.colorsOffset, 4 * (size_t)header.numVertices, mesh.colors);
+			copyArray(data, header.uvsOffset, 2 * (size_t)header.numUVs, mesh.uvs);
+			copyArray(data, header.uvIdsOffset, header.numConnects, mesh.uvIds);
+		}
+	}
+	catch (const std::bad_alloc &)
+	{
+		mesh.clear();
+		error = "Error: failed to allocate memory.";
+		return false;
+	}
+	if (!checkCounts(mesh.counts, header.numConnects) || !checkIds(mesh.connects, header.numVertices) ||
+		!checkIds(mesh.uvIds, header.numUVs) || !checkIds(mesh.normalIds, header.numNormals))
+	{
+		mesh.clear();
+		error = "Error: wrong file format.";
+		return false;
+	}
+	mesh.topologyHash = header.topologyHash;
+	return true;
+}
+
+bool MeshCacheFile::readHeader(const char *data, const size_t size, Header &header)
+{
+	if (size < sizeof(Header))
+		return false;
+	memcpy(&header, data, sizeof(Header));
+	// version 1 files are read as well, they have no face-varying normals
+	if ((memcmp(header.magic, "MTCF", 4) != 0) || (header.version < 1) || (header.version > VERSION) || (header.headerSize != sizeof(Header)))
+		return false;
+	if ((header.version == 1) && ((header.numNormals != 0) || (header.normalIdsOffset != 0)))
+		return false;
+
+	// per-vertex UVs need one UV per vertex
+	const uint64_t nv = header.numVertices;
+	if ((header.uvsOffset != 0) && (header.uvIdsOffset == 0) && (header.numUVs != header.numVertices))
+		return false;
+	const uint64_t numNormals = (header.normalIdsOffset != 0) ? header.numNormals : nv;
+	return checkArray(header.positionsOffset, 4 * nv * sizeof(float), size, false) &&
+		checkArray(header.countsOffset, (uint64_t)header.numPolygons * sizeof(int32_t), size, false) &&
+		checkArray(header.connectsOffset, (uint64_t)header.numConnects * sizeof(int32_t), size, false) &&
+		checkArray(header.normalsOffset, 3 * numNormals * sizeof(float), size, true) &&
+		checkArray(header.colorsOffset, 4 * nv * sizeof(float), size, true) &&
+		checkArray(header.uvsOffset, 2 * (uint64_t)header.numUVs * sizeof(float), size, true) &&
+		checkArray(header.uvIdsOffset, (uint64_t)header.numConnects * sizeof(int32_t), size, true) &&
+		checkArray(header.normalIdsOffset, (uint64_t)header.numConnects * sizeof(int32_t), size, true);
+}
@@ -0,0 +1,78 @@
+#ifndef __MeshCacheFile_h__
+#define __MeshCacheFile_h__
+
+#include "MeshData.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Utilities
+{
+	/** \brief Reader and writer of ".mtc" mesh cache files.
+	* The format stores a MeshData object so that it can be loaded with one
+	* memcpy per array: a header of 128 bytes is followed by the arrays, each
+	* starting at a multiple of 64 bytes. All values are little endian.
+	*
+	* array		type		count				layout
+	* positions	float		4 * numVertices		x, y, z, 1 as in MFloatPointArray
+	* counts	int32		numPolygons			MIntArray
+	* connects	int32		numConnects			MIntArray
+	* normals	float		3 * numNormals		MFloatVectorArray (optional)
+	* colors	float		4 * numVertices		MColorArray (optional)
+	* uvs		float		2 * numUVs			all u values, then all v values (optional)
+	* uvIds		int32		numConnects			UV index of each polygon vertex (optional)
+	* normalIds	int32		numConnects			normal index of each polygon vertex (optional)
+	*
+	* The offset of an optional array is 0 if the array is not stored. Without
+	* index array, normals and UVs are per vertex (numNormals and numUVs are
+	* numVertices), see MeshData. Version 1 files have no face-varying normals,
+	* their numNormals and normalIdsOffset fields are 0.
+	*/
+	class MeshCacheFile
+	{
+	public:
+		static const unsigned int VERSION = 2;
+		static const size_t ALIGNMENT = 64;
+
+		struct Header
+		{
+			char magic[4];				// "MTCF"
+			uint32_t version;
+			uint32_t numVertices;
+			uint32_t numPolygons;
+			uint32_t numConnects;
+			uint32_t numUVs;
+			uint32_t headerSize;		// sizeof(Header)
+			uint32_t numNormals;		// 0 if the normals are per vertex
+			float boundingBoxMin[3];
+			float boundingBoxMax[3];
+			uint64_t topologyHash;		// MeshData::computeTopologyHash()
+			uint64_t positionsOffset;
+			uint64_t countsOffset;
+			uint64_t connectsOffset;
+			uint64_t normalsOffset;
+			uint64_t colorsOffset;
+			uint64_t uvsOffset;
+			uint64_t uvIdsOffset;
+			uint64_t normalIdsOffset;
+		};
+
+		/** Write a mesh. Returns false and sets error if the file cannot be written. */
+		static bool write(const std::string &fileName, const MeshData &mesh, std::string &error);
+
+		/** Store a mesh in the file format in data. */
+		static void encode(const MeshData &mesh, std::vector<char> &data);
+
+		/** Read a mesh. If positionsOnly is set, normals, colors and UVs are not read. */
+		static bool read(const std::string &fileName, const bool positionsOnly, MeshData &mesh, std::string &error);
+
+		/** Read a mesh from the contents of a file in memory, see read(). */
+		static bool readFromMemory(const char *data, const size_t size, const bool positionsOnly, MeshData &mesh, std::string &error);
+
+		/** Check the header of a file in memory, including that all arrays are inside of the data. */
+		static bool readHeader(const char *data, const size_t size, Header &header);
+	};
+}
+
+#endif
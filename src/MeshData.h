@@ -0,0 +1,110 @@
+#ifndef __MeshData_h__
+#define __MeshData_h__
+
+#include <vector>
+#include <cstddef>
+
+namespace Utilities
+{
+	/** \brief Mesh of one frame as it is read from a file, independent of Maya.
+	* The arrays have the layout of the Maya arrays passed to MFnMesh::create()
+	* (MFloatPointArray, MIntArray, MFloatVectorArray, MColorArray), so the
+	* conversion to a Maya mesh is a plain copy. Normals, colors and UVs are
+	* optional. Colors contain one entry per vertex. Normals and UVs are either
+	* per vertex or face-varying: then an index array contains the index of the
+	* value of each polygon vertex, so that equal values can be shared. The readers
+	* store attributes which are the same for all polygon vertices of a vertex per
+	* vertex, without index array. Face-varying values of MZD and PLY files are
+	* kept per polygon vertex, MeshWriter::shareValues() shares equal values.
+	*/
+	struct MeshData
+	{
+		/** Vertex positions, 4 floats (x, y, z, 1) per vertex */
+		std::vector<float> positions;
+		/** Number of vertices of each polygon */
+		std::vector<int> counts;
+		/** Vertex indices of all polygons */
+		std::vector<int> connects;
+		/** Normals, 3 floats per vertex or per entry of normalIds */
+		std::vector<float> normals;
+		/** Normal index of each polygon vertex, empty for per-vertex normals */
+		std::vector<int> normalIds;
+		/** Vertex colors as RGBA, 4 floats per vertex */
+		std::vector<float> colors;
+		/** UV coordinates, all u values followed by all v values (MFloatArray u, v) */
+		std::vector<float> uvs;
+		/** UV index of each polygon vertex (MFnMesh::assignUVs()), empty if there is one UV per vertex */
+		std::vector<int> uvIds;
+		/** Hash of counts and connects, see computeTopologyHash() */
+		unsigned long long topologyHash = 0;
+
+		/** How the mesh was read by MeshReader::read(). Times are microseconds,
+		* readStart is a time stamp of TraceLog::now().
+		*/
+		struct LoadStatistics
+		{
+			size_t fileBytes = 0;
+			long long readStart = 0;
+			long long readDuration = 0;
+			long long parseDuration = 0;
+			unsigned long long threadId = 0;
+		};
+		LoadStatistics loadStatistics;
+
+		int numVertices() const { return (int)(positions.size() / 4); }
+		int numPolygons() const { return (int)counts.size(); }
+		int numUVs() const { return (int)(uvs.size() / 2); }
+
+		/** True if there is one normal per vertex. */
+		bool hasNormals() const { return !normals.empty() && normalIds.empty() && (normals.size() / 3 == positions.size() / 4); }
+		/** True if there is a normal index per polygon vertex. */
+		bool hasFaceVaryingNormals() const { return !normals.empty() && !normalIds.empty() && (normalIds.size() == connects.size()); }
+		bool hasColors() const { return !colors.empty() && (colors.size() == positions.size()); }
+		/** True if there are UVs, either one per vertex or with an index per polygon vertex. */
+		bool hasUVs() const
+		{
+			return !uvs.empty() && (uvIds.empty() ? (uvs.size() / 2 == positions.size() / 4) : (uvIds.size() == connects.size()));
+		}
+
+		/** Number of bytes used by the arrays. */
+		size_t memorySize() const
+		{
+			return (positions.capacity() + normals.capacity() + colors.capacity() + uvs.capacity()) * sizeof(float) +
+				(counts.capacity() + connects.capacity() + normalIds.capacity() + uvIds.capacity()) * sizeof(int);
+		}
+
+		/** Hash of the polygon counts and vertex indices. Meshes with equal
+		* connectivity have the same hash, so a changed topology can be detected
+		* without keeping the index arrays of the previous frame.
+		*/
+		unsigned long long computeTopologyHash() const
+		{
+			// FNV-1a on 32 bit words, the two arrays are separated by their sizes
+			unsigned long long h = 14695981039346656037ULL;
+			const unsigned long long prime = 1099511628211ULL;
+			h = (h ^ (unsigned long long)counts.size()) * prime;
+			for (size_t i = 0; i < counts.size(); i++)
+				h = (h ^ (unsigned int)counts[i]) * prime;
+			h = (h ^ (unsigned long long)connects.size()) * prime;
+			for (size_t i = 0; i < connects.size(); i++)
+				h = (h ^ (unsigned int)connects[i]) * prime;
+			return h;
+		}
+
+		void clear()
+		{
+			positions.clear();
+			counts.clear();
+			connects.clear();
+			normals.clear();
+			normalIds.clear();
+			colors.clear();
+			uvs.clear();
+			uvIds.clear();
+			topologyHash = 0;
+			loadStatistics = LoadStatistics();
+		}
+	};
+}
+
+#endif
@@ -1,11 +1,11 @@
 #include <math.h>
 #include <algorithm>
 #include <stdlib.h>
+#include <climits>
 
 #include "MeshLoader.h"
 #include "FileSystem.h"
-#include "extern/happly/happly.h"
-#include "OBJLoader.h"
+#include "MeshReader.h"
 
 #include <maya/MVectorArray.h>
 #include <maya/MFloatArray.h>
@@ -19,6 +19,7 @@
 #include <maya/MFnDoubleArrayData.h>
 #include <maya/MFnArrayAttrsData.h>
 #include <maya/MFnMatrixData.h>
+#include <maya/MFnMatrixAttribute.h>
 
 #include <maya/MFnStringData.h>
 #include <maya/MPlugArray.h>
@@ -43,13 +44,75 @@ MTypeId MeshLoader::m_id( 0x83333 );
 MObject MeshLoader::m_activeAttr;
 MObject MeshLoader::m_meshFileAttr;
 MObject MeshLoader::m_frameIndex;
+MObject MeshLoader::m_positionsOnlyAttr;
+MObject MeshLoader::m_prefetchDepthAttr;
+MObject MeshLoader::m_rigidBodyAttr;
+MObject MeshLoader::m_referenceFrameAttr;
+MObject MeshLoader::m_rigidToleranceAttr;
+MObject MeshLoader::m_transformFileAttr;
+MObject MeshLoader::m_outMatrixAttr;
 MObject MeshLoader::m_outMeshAttr;
+MObject MeshLoader::m_traceFileAttr;
+MObject MeshLoader::m_measureReadAttr;
+MObject MeshLoader::m_pathTimeAttr;
+MObject MeshLoader::m_readTimeAttr;
+MObject MeshLoader::m_parseTimeAttr;
+MObject MeshLoader::m_convertTimeAttr;
+MObject MeshLoader::m_buildTimeAttr;
+MObject MeshLoader::m_bytesReadAttr;
+MObject MeshLoader::m_earlyOutAttr;
+
+std::mutex MeshLoader::m_sceneMutex;
+std::string MeshLoader::m_sceneDirectory;
+bool MeshLoader::m_sceneDirectoryValid = false;
+std::atomic<unsigned int> MeshLoader::m_sceneVersion(1);
+MCallbackIdArray MeshLoader::m_sceneCallbacks;
+
+namespace
+{
+	/** Read-only output for the statistics of the last evaluation */
+	MObject createStatisticsAttribute(const char *name, const char *shortName, const MFnNumericData::Type type)
+	{
+		MFnNumericAttribute nAttr;
+		MObject attr = nAttr.create(name, shortName, type, 0.0);
+		nAttr.setReadable(true);
+		nAttr.setWritable(false);
+		nAttr.setKeyable(false);
+		nAttr.setConnectable(true);
+		nAttr.setStorable(false);
+		return attr;
+	}
+
+	double toMilliseconds(const long long microseconds)
+	{
+		return 0.001 * (double)microseconds;
+	}
+}
 
 MeshLoader::MeshLoader()
 {
 	m_currentFrame = -1;
 	m_lastFileName = "";
+	m_lastPositionsOnly = false;
+	m_measureRead = false;
+	m_lastFrameIndex = INT_MIN;
+	m_lastFrameDelta = 0;
+	m_frameStep = 1;
+	m_hasOutputMesh = false;
+	m_outputNumVertices = 0;
+	m_outputNumPolygons = 0;
+	m_outputNumConnects = 0;
+	m_outputTopologyHash = 0;
+	m_outputHasNormals = false;
+	m_outputHasColors = false;
+	m_outputHasFaceNormals = false;
+	m_outputHasUVs = false;
+	m_outputNumUVs = 0;
+	m_outputIsReference = false;
+	m_rigidReferencePositionsOnly = false;
+	m_rigidReferenceDiagonal = 0.0;
 	m_meshFile = "c:/example/mesh_data_###.ply";
+	setPattern(m_meshPattern, m_meshFile);
 }
 
 
@@ -66,6 +129,7 @@ MStatus MeshLoader::initialize()
 {
 	MFnTypedAttribute tAttr;
 	MFnNumericAttribute nAttr;
+	MFnMatrixAttribute mAttr;
 
 	MFnStringData fnStringData;
 	MObject defaultString;
@@ -79,6 +143,15 @@ MStatus MeshLoader::initialize()
 	tAttr.setArray(true);
 	addAttribute(m_outMeshAttr);
 
+	// transformation of the reference mesh in rigid body mode
+	m_outMatrixAttr = mAttr.create("outMatrix", "oMat");
+	mAttr.setReadable(true);
+	mAttr.setWritable(false);
+	mAttr.setKeyable(false);
+	mAttr.setConnectable(true);
+	mAttr.setStorable(false);
+	addAttribute(m_outMatrixAttr);
+
 	// Create the default string.
 	defaultString = fnStringData.create("c:/example/mesh_data_###.ply");
 
@@ -107,9 +180,123 @@ MStatus MeshLoader::initialize()
 	nAttr.setStorable(true);
 	addAttribute(m_frameIndex);
 
+	// skip normals, colors and other attributes, e.g. for playblasts
+	m_positionsOnlyAttr = nAttr.create("positionsOnly", "po", MFnNumericData::kBoolean, 0.0);
+	nAttr.setReadable(true);
+	nAttr.setWritable(true);
+	nAttr.setKeyable(false);
+	nAttr.setConnectable(true);
+	nAttr.setStorable(true);
+	addAttribute(m_positionsOnlyAttr);
+
+	// number of following frames which are loaded in the background, 0 disables prefetching
+	m_prefetchDepthAttr = nAttr.create("prefetchDepth", "pfd", MFnNumericData::kInt, 2);
+	nAttr.setReadable(true);
+	nAttr.setWritable(true);
+	nAttr.setKeyable(false);
+	nAttr.setConnectable(true);
+	nAttr.setStorable(true);
+	nAttr.setMin(0);
+	nAttr.setMax(16);
+	addAttribute(m_prefetchDepthAttr);
+
+	// rigid body mode: the mesh of the reference frame is loaded once and moved by outMatrix
+	m_rigidBodyAttr = nAttr.create("rigidBody", "rb", MFnNumericData::kBoolean, 0.0);
+	nAttr.setReadable(true);
+	nAttr.setWritable(true);
+	nAttr.setKeyable(false);
+	nAttr.setConnectable(true);
+	nAttr.setStorable(true);
+	addAttribute(m_rigidBodyAttr);
+
+	m_referenceFrameAttr = nAttr.create("referenceFrame", "rf", MFnNumericData::kInt, 1);
+	nAttr.setReadable(true);
+	nAttr.setWritable(true);
+	nAttr.setKeyable(false);
+	nAttr.setConnectable(true);
+	nAttr.setStorable(true);
+	nAttr.setMin(0);
+	addAttribute(m_referenceFrameAttr);
+
+	// maximum RMS distance of a fitted frame relative to the bounding box diagonal of the reference mesh
+	m_rigidToleranceAttr = nAttr.create("rigidTolerance", "rTol", MFnNumericData::kDouble, 1.0e-4);
+	nAttr.setReadable(true);
+	nAttr.setWritable(true);
+	nAttr.setKeyable(false);
+	nAttr.setConnectable(true);
+	nAttr.setStorable(true);
+	nAttr.setMin(0.0);
+	addAttribute(m_rigidToleranceAttr);
+
+	// optional sidecar files with the transformation of each frame, replaces the fit
+	defaultString = fnStringData.create("");
+	m_transformFileAttr = tAttr.create("transformFile", "tFile", MFnStringData::kString, defaultString);
+	tAttr.setReadable(true);
+	tAttr.setWritable(true);
+	tAttr.setKeyable(false);
+	tAttr.setConnectable(true);
+	tAttr.setStorable(true);
+	addAttribute(m_transformFileAttr);
+
+	// optional Chrome trace log of the evaluations, all nodes with the same file share it
+	m_traceFileAttr = tAttr.create("traceFile", "trFile", MFnStringData::kString, defaultString);
+	tAttr.setReadable(true);
+	tAttr.setWritable(true);
+	tAttr.setKeyable(false);
+	tAttr.setConnectable(true);
+	tAttr.setStorable(true);
+	addAttribute(m_traceFileAttr);
+
+	// read the files before parsing them, so that readTime and parseTime are measured separately
+	m_measureReadAttr = nAttr.create("measureRead", "mRead", MFnNumericData::kBoolean, 0.0);
+	nAttr.setReadable(true);
+	nAttr.setWritable(true);
+	nAttr.setKeyable(false);
+	nAttr.setConnectable(true);
+	nAttr.setStorable(true);
+	addAttribute(m_measureReadAttr);
+
+	// statistics of the last evaluation, times in milliseconds
+	m_pathTimeAttr = createStatisticsAttribute("pathTime", "paTime", MFnNumericData::kDouble);
+	m_readTimeAttr = createStatisticsAttribute("readTime", "rdTime", MFnNumericData::kDouble);
+	m_parseTimeAttr = createStatisticsAttribute("parseTime", "psTime", MFnNumericData::kDouble);
+	m_convertTimeAttr = createStatisticsAttribute("convertTime", "cvTime", MFnNumericData::kDouble);
+	m_buildTimeAttr = createStatisticsAttribute("buildTime", "bdTime", MFnNumericData::kDouble);
+	m_bytesReadAttr = createStatisticsAttribute("bytesRead", "bRead", MFnNumericData::kDouble);
+	m_earlyOutAttr = createStatisticsAttribute("earlyOut", "eOut", MFnNumericData::kBoolean);
+	addAttribute(m_pathTimeAttr);
+	addAttribute(m_readTimeAttr);
+	addAttribute(m_parseTimeAttr);
+	addAttribute(m_convertTimeAttr);
+	addAttribute(m_buildTimeAttr);
+	addAttribute(m_bytesReadAttr);
+	addAttribute(m_earlyOutAttr);
+
 	attributeAffects(m_meshFileAttr, m_outMeshAttr);
 	attributeAffects(m_frameIndex, m_outMeshAttr);
 	attributeAffects(m_activeAttr, m_outMeshAttr);
+	attributeAffects(m_positionsOnlyAttr, m_outMeshAttr);
+	attributeAffects(m_rigidBodyAttr, m_outMeshAttr);
+	attributeAffects(m_referenceFrameAttr, m_outMeshAttr);
+	attributeAffects(m_rigidToleranceAttr, m_outMeshAttr);
+	attributeAffects(m_transformFileAttr, m_outMeshAttr);
+
+	attributeAffects(m_meshFileAttr, m_outMatrixAttr);
+	attributeAffects(m_frameIndex, m_outMatrixAttr);
+	attributeAffects(m_activeAttr, m_outMatrixAttr);
+	attributeAffects(m_positionsOnlyAttr, m_outMatrixAttr);
+	attributeAffects(m_rigidBodyAttr, m_outMatrixAttr);
+	attributeAffects(m_referenceFrameAttr, m_outMatrixAttr);
+	attributeAffects(m_rigidToleranceAttr, m_outMatrixAttr);
+	attributeAffects(m_transformFileAttr, m_outMatrixAttr);
+
+	const MObject inputs[] = { m_meshFileAttr, m_frameIndex, m_activeAttr, m_positionsOnlyAttr, m_rigidBodyAttr,
+		m_referenceFrameAttr, m_rigidToleranceAttr, m_transformFileAttr };
+	const MObject statistics[] = { m_pathTimeAttr, m_readTimeAttr, m_parseTimeAttr, m_convertTimeAttr, m_buildTimeAttr,
+		m_bytesReadAttr, m_earlyOutAttr };
+	for (const MObject &input : inputs)
+		for (const MObject &output : statistics)
+			attributeAffects(input, output);
 
 	return( MS::kSuccess );
 }
@@ -125,6 +312,7 @@ void MeshLoader::postConstructor()
 
 void  MeshLoader::setEmptyMesh(MArrayDataHandle &arrayData)
 {
+	m_hasOutputMesh = false;
 	const unsigned int count = arrayData.elementCount();
 	for (unsigned int i = 0; i < count; i++)
 	{
@@ -138,9 +326,33 @@ MStatus MeshLoader::compute(const MPlug& plug, MDataBlock& block)
 {
 	MStatus status;
 
-	if (plug != m_outMeshAttr)
+	if ((plug == m_pathTimeAttr) || (plug == m_readTimeAttr) || (plug == m_parseTimeAttr) || (plug == m_convertTimeAttr) ||
+		(plug == m_buildTimeAttr) || (plug == m_bytesReadAttr) || (plug == m_earlyOutAttr))
+	{
+		// the statistics are set when the outputs are evaluated
+		block.inputValue(m_outMatrixAttr);
+		setStatistics(block);
+		return MS::kSuccess;
+	}
+
+	if ((plug != m_outMeshAttr) && (plug != m_outMatrixAttr))
         return( MS::kUnknownParameter );
 
+	const long long computeStart = Utilities::TraceLog::now();
+	m_statistics = Statistics();
+
+	MString traceFile = block.inputValue(m_traceFileAttr).asString();
+	if (traceFile == "")
+		m_traceLog.reset();
+	else if (!m_traceLog || (m_traceLog->getFileName() != traceFile.asChar()))
+	{
+		m_traceLog = Utilities::TraceLog::open(traceFile.asChar());
+		if (!m_traceLog)
+			MGlobal::displayWarning(MString("Unable to create trace file: ") + traceFile);
+	}
+	// otherwise the files are parsed while the system reads ahead and parseTime includes the reading
+	m_measureRead = block.inputValue(m_measureReadAttr).asBool() || (m_traceLog != nullptr);
+
 	MArrayDataHandle arrayData = block.outputArrayValue(m_outMeshAttr);
 	const unsigned int count = arrayData.elementCount();
 
@@ -149,6 +361,7 @@ MStatus MeshLoader::compute(const MPlug& plug, MDataBlock& block)
 	if (meshFile == "")
 	{
 		setEmptyMesh(arrayData);
+		setStatistics(block);
 		return (MS::kFailure);
 	}
 
@@ -156,6 +369,7 @@ MStatus MeshLoader::compute(const MPlug& plug, MDataBlock& block)
 	if (!active)
 	{
 		block.setClean(plug);
+		setStatistics(block);
 		return MS::kSuccess;
 	}
 
@@ -166,52 +380,133 @@ MStatus MeshLoader::compute(const MPlug& plug, MDataBlock& block)
 	MMatrix trans = myTransform.transformation().asMatrixInverse();
 
 	int frameIndex = block.inputValue(m_frameIndex).asInt();
-
-	std::string currentFile = convertFileName(meshFile.asChar(), frameIndex);
+	bool positionsOnly = block.inputValue(m_positionsOnlyAttr).asBool();
+	int prefetchDepth = block.inputValue(m_prefetchDepthAttr).asInt();
+	bool rigidBody = block.inputValue(m_rigidBodyAttr).asBool();
+	int referenceFrame = block.inputValue(m_referenceFrameAttr).asInt();
+	double rigidTolerance = block.inputValue(m_rigidToleranceAttr).asDouble();
+	MString transformFile = block.inputValue(m_transformFileAttr).asString();
+
+	const long long pathStart = Utilities::TraceLog::now();
+	setPattern(m_transformPattern, transformFile.asChar());
+	std::string currentFile = convertFileName(m_meshPattern, frameIndex);
+	const long long pathEnd = Utilities::TraceLog::now();
+	m_statistics.pathTime = toMilliseconds(pathEnd - pathStart);
+	trace("resolvePath", pathStart, pathEnd);
 	if (currentFile == "")
 	{
 		setEmptyMesh(arrayData);
+		setStatistics(block);
 		return (MS::kFailure);
 	}
-	if (currentFile == m_lastFileName)
+	std::ostringstream traceArgs;
+	traceArgs << "\"file\": \"" << Utilities::TraceLog::escape(currentFile) << "\", \"frame\": " << frameIndex;
+	std::ostringstream rigidSettings;
+	if (rigidBody)
+		rigidSettings << referenceFrame << "|" << rigidTolerance << "|" << transformFile.asChar();
+	if ((currentFile == m_lastFileName) && (positionsOnly == m_lastPositionsOnly) && (rigidSettings.str() == m_lastRigidSettings))
+	{
+		m_statistics.earlyOut = true;
+		setStatistics(block);
+		trace("compute", computeStart, Utilities::TraceLog::now(), traceArgs.str() + ", \"earlyOut\": true");
 		return MS::kSuccess;
+	}
 	m_lastFileName = currentFile;
+	m_lastPositionsOnly = positionsOnly;
+	m_lastRigidSettings = rigidSettings.str();
 	std::cout << "Current file: " << currentFile << "\n";
 
-	MFnMeshData dataCreator;
-	MObject newOutputData = dataCreator.create();
-
 	std::string fileExt = Utilities::FileSystem::getFileExt(currentFile);
 	transform(fileExt.begin(), fileExt.end(), fileExt.begin(), ::toupper);
 	m_fileType = FileType::Unknown;
 	if (fileExt == "MZD")
-	{
 		m_fileType = FileType::MZD;
-		if (!readMZDFile(currentFile, newOutputData))
-		{
-			setEmptyMesh(arrayData);
-			return (MS::kFailure);
-		}
-	}
 	else if (fileExt == "PLY")
-	{
 		m_fileType = FileType::PLY;
-		if (!readPLYFile(currentFile, newOutputData))
+	else if (fileExt == "OBJ")
+		m_fileType = FileType::OBJ;
+	else if (fileExt == "MTC")
+		m_fileType = FileType::MTC;
+
+	// rigid body mode: output the reference mesh and its transformation if the
+	// frame is a rigid motion of it, otherwise load the frame
+	MMatrix outMatrix;
+	MObject newOutputData;
+	int rigid = 0;
+	if (rigidBody && (m_fileType != FileType::Unknown))
+	{
+		std::string error;
+		rigid = getRigidTransform(currentFile, frameIndex, referenceFrame, positionsOnly, rigidTolerance, prefetchDepth, outMatrix, error);
+		if (rigid < 0)
 		{
+			MGlobal::displayError(error.c_str());
 			setEmptyMesh(arrayData);
+			setStatistics(block);
 			return (MS::kFailure);
 		}
+		if (rigid == 0)
+		{
+			MGlobal::displayWarning(MString("Frame is not a rigid motion of the reference frame: ") + currentFile.c_str());
+			outMatrix = MMatrix();
+		}
+		else
+		{
+			if (!m_outputIsReference)
+			{
+				buildMesh(*m_rigidReference);
+				m_outputIsReference = true;
+			}
+			newOutputData = m_outputData;
+		}
 	}
-	else if (fileExt == "OBJ")
+	else
 	{
-		m_fileType = FileType::OBJ;
-		if (!readOBJFile(currentFile, newOutputData))
+		m_rigidReference.reset();
+		m_rigidReferenceFile = "";
+		m_rigidTransforms.clear();
+	}
+
+	if (rigid == 0)
+	{
+		// use the prefetched frame if it is available, then start loading the next
+		// frames in the background while this frame is converted. Other frames are
+		// loaded through the cache shared by all nodes.
+		const long long loadStart = Utilities::TraceLog::now();
+		std::shared_ptr<Utilities::MeshData> mesh;
+		std::string error;
+		bool prefetched = false;
+		bool fileRead = false;
+		if (m_prefetcher)
+			prefetched = m_prefetcher->take(currentFile, positionsOnly, mesh, error, &fileRead);
+		prefetch(currentFile, frameIndex, positionsOnly, prefetchDepth);
+
+		if ((!prefetched) && (m_fileType != FileType::Unknown))
+			mesh = Utilities::FrameCache::getInstance().load(currentFile, positionsOnly, error, &fileRead, m_measureRead);
+		trace("load", loadStart, Utilities::TraceLog::now(), prefetched ? "\"prefetched\": true" : "\"prefetched\": false");
+
+		if (m_fileType != FileType::Unknown)
 		{
-			setEmptyMesh(arrayData);
-			return (MS::kFailure);
+			if (!mesh)
+			{
+				MGlobal::displayError(error.c_str());
+				setEmptyMesh(arrayData);
+				setStatistics(block);
+				return (MS::kFailure);
+			}
+			recordLoad(*mesh, currentFile, fileRead);
+			newOutputData = buildMesh(*mesh);
+		}
+		else
+		{
+			MFnMeshData dataCreator;
+			newOutputData = dataCreator.create();
+			m_hasOutputMesh = false;
 		}
 	}
-		
+
+	block.outputValue(m_outMatrixAttr).set(outMatrix);
+	block.setClean(m_outMatrixAttr);
+
 	for (unsigned int i = 0; i < count; i++)
 	{
 		// compute the outgoing mesh
@@ -222,7 +517,9 @@ MStatus MeshLoader::compute(const MPlug& plug, MDataBlock& block)
 			break;
 	}
 
-	block.setClean( plug );
+	block.setClean(m_outMeshAttr);
+	setStatistics(block);
+	trace("compute", computeStart, Utilities::TraceLog::now(), traceArgs.str() + ", \"earlyOut\": false");
 
 	return( MS::kSuccess );
 }
@@ -232,363 +529,333 @@ bool MeshLoader::isBounded() const
 	return false;
 }
 
-bool MeshLoader::readMZDFile(const std::string &fileName, MObject &outputData)
+void MeshLoader::prefetch(const std::string &currentFile, const int frameIndex, const bool positionsOnly, const int prefetchDepth)
 {
-	// declare and init the pointers.
-	int              numVertices = 0;    // amount of vertices.
-	int              numPolygons = 0;    // amount of polygons.
-	int              numNodes = 0;		   // amount of polygon nodes.
-	float           *vertPositions = nullptr;			// array of vertex positions.               Array size is 3 * numVertices.
-	unsigned char   *polyVIndicesNum = nullptr;		// array of polygon vertex indices count.   Array size is numPolygons.
-	int             *polyVIndices = nullptr;			// array of polygon vertex indices.         Array size is numNodes.
-	float           *vertNormals = nullptr;			// array of vertex normal vectors.          Array size is 3 * numVertices.
-	float           *vertMotions = nullptr;			// array of vertex motion vectors.          Array size is 3 * numVertices.
-	float           *vertColors = nullptr;				// array of vertex colors.                  array size is 4 * numVertices.
-	float           *vertUVWs = nullptr;				// array of vertex UVW coordinates.         Array size is 3 * numVertices.
-	float           *nodeNormals = nullptr;			// array of polygon node normal vectors.    Array size is 3 * numNodes.
-	float           *nodeColors = nullptr;				// array of polygon node colors.            Array size is 4 * numNodes.
-	float           *nodeUVWs = nullptr;				// array of polygon node UVW coordinates.   Array size is 3 * numNodes.
-
-	// read the .mzd file.
-	int ret = readMZD(fileName.c_str(), numVertices, numPolygons, numNodes, &vertPositions, &polyVIndicesNum, &polyVIndices, &vertNormals,
-					&vertMotions, &vertColors, &vertUVWs, &nodeNormals, &nodeColors, &nodeUVWs);
-	switch (ret)
+	// infer the playback direction and step from the last frame changes: a step
+	// is only used if it occurred twice in a row, otherwise just the direction
+	const int delta = frameIndex - m_lastFrameIndex;
+	if ((m_lastFrameIndex != INT_MIN) && (delta != 0))
 	{
-		case 0:     break;  // success      
-		case -1:    MGlobal::displayError("Error: unable to open file."); return false;
-		case -2:    MGlobal::displayError("Error: read error."); return false;
-		case -3:    MGlobal::displayError("Error: failed to allocate memory."); return false;
-		case -4:    MGlobal::displayError("Error: wrong file format."); return false;
-		case -5:    MGlobal::displayError("Error: illegal parameter value."); return false;
-		default:    MGlobal::displayError("Error: unkown error."); return false;
+		if (delta == m_lastFrameDelta)
+			m_frameStep = delta;
+		else
+			m_frameStep = (delta > 0) ? 1 : -1;
+		m_lastFrameDelta = delta;
 	}
+	m_lastFrameIndex = frameIndex;
 
-	// Read points
-	MPointArray points;
-	MVectorArray vNormals;
-	MColorArray vColors;
-	MIntArray vertexList;
-
-	points.setLength(numVertices);
-	vertexList.setLength(numVertices);
-
-	if (vertNormals)
-		vNormals.setLength(numVertices);
-	if (vertColors)
-		vColors.setLength(numVertices);
-
-	for (int j = 0; j < numVertices; j++)
+	if ((prefetchDepth <= 0) || (m_fileType == FileType::Unknown))
 	{
-		vertexList[j] = j;
-		MPoint p(vertPositions[3 * j], vertPositions[3 * j + 1], vertPositions[3 * j + 2]);
-		p.cartesianize();
-		points[j] = p;
-
-		if (vertNormals)
-			vNormals[j] = MVector(vertNormals[3 * j], vertNormals[3 * j + 1], vertNormals[3 * j + 2]);
-		if (vertColors)
-			vColors[j] = MColor(vertColors[4 * j], vertColors[4 * j + 1], vertColors[4 * j + 2], vertColors[4 * j + 3]);
+		m_prefetcher.reset();
+		return;
 	}
+	if (!m_prefetcher)
+		m_prefetcher.reset(new Utilities::MeshPrefetcher());
 
-	// Read faces	
-	//MIntArray uvIndices;
-	MIntArray polyConnects;
-	MIntArray polyCounts;
-	//uvIndices.setLength((nFaces) * 3);
-	polyCounts.setLength(numPolygons);
-	polyConnects.setLength(numNodes);
-	unsigned int currentIndex = 0;
-	for (int j = 0; j < numPolygons; j++)
-		polyCounts[j] = polyVIndicesNum[j];
+	std::vector<std::string> files;
+	for (int i = 1; i <= prefetchDepth; i++)
+	{
+		const int frame = frameIndex + i * m_frameStep;
+		if (frame < 0)
+			break;
+		const std::string fileName = convertFileName(m_meshPattern, frame);
+		if ((fileName != currentFile) && (m_rigidTransforms.find(fileName) == m_rigidTransforms.end()) &&
+			!Utilities::FrameCache::getInstance().contains(fileName, positionsOnly) && Utilities::FileSystem::fileExists(fileName))
+			files.push_back(fileName);
+	}
+	m_prefetcher->prefetch(files, positionsOnly, m_measureRead);
+}
 
-	for (int j = 0; j < numNodes; j++)
-		polyConnects[j] = polyVIndices[j];
+MObject MeshLoader::buildMesh(const Utilities::MeshData &mesh)
+{
+	const int numVertices = mesh.numVertices();
+	const int numPolygons = mesh.numPolygons();
+	const bool hasNormals = mesh.hasNormals();
+	const bool hasFaceNormals = mesh.hasFaceVaryingNormals();
+	const bool hasColors = mesh.hasColors();
+	const bool hasUVs = mesh.hasUVs();
+	const int numUVs = mesh.numUVs();
+	m_outputIsReference = false;
+	const long long convertStart = Utilities::TraceLog::now();
+
+	// the float arrays are copied in bulk into the Maya arrays, which are kept between frames
+	m_arrays.set(mesh);
+
+	const long long buildStart = Utilities::TraceLog::now();
+	m_statistics.convertTime += toMilliseconds(buildStart - convertStart);
+	trace("convert", convertStart, buildStart);
+
+	// if the connectivity did not change, e.g. for rigid bodies, the mesh of
+	// the last frame is kept and only the vertex data is replaced
+	const bool sameTopology = m_hasOutputMesh &&
+		(numVertices == m_outputNumVertices) &&
+		(numPolygons == m_outputNumPolygons) &&
+		(mesh.connects.size() == m_outputNumConnects) &&
+		(mesh.topologyHash == m_outputTopologyHash) &&
+		(hasNormals == m_outputHasNormals) &&
+		(hasFaceNormals == m_outputHasFaceNormals) &&
+		(hasColors == m_outputHasColors) &&
+		(hasUVs == m_outputHasUVs);
 
 	MFnMesh outputMesh;
-	MObject outputMeshObj = outputMesh.create(numVertices, numPolygons, points, polyCounts, polyConnects, outputData);
+	if (sameTopology)
+	{
+		outputMesh.setObject(m_outputMesh);
+		outputMesh.setPoints(m_arrays.points);
+		// setUVs() needs at least as many UVs as the mesh has
+		if (hasUVs && (numUVs < m_outputNumUVs))
+			outputMesh.clearUVs();
+	}
+	else
+	{
+		MFnMeshData dataCreator;
+		m_outputData = dataCreator.create();
+		m_outputMesh = outputMesh.create(numVertices, numPolygons, m_arrays.points, m_arrays.polyCounts, m_arrays.polyConnects, m_outputData);
+
+		m_hasOutputMesh = true;
+		m_outputNumVertices = numVertices;
+		m_outputNumPolygons = numPolygons;
+		m_outputNumConnects = mesh.connects.size();
+		m_outputTopologyHash = mesh.topologyHash;
+		m_outputHasNormals = hasNormals;
+		m_outputHasFaceNormals = hasFaceNormals;
+		m_outputHasColors = hasColors;
+		m_outputHasUVs = hasUVs;
+	}
 
-	if (vertNormals)
-		outputMesh.setVertexNormals(vNormals, vertexList);
+	if (hasUVs)
+	{
+		outputMesh.setUVs(m_arrays.uArray, m_arrays.vArray);
+		outputMesh.assignUVs(m_arrays.polyCounts, m_arrays.uvIds);
+	}
+	m_outputNumUVs = hasUVs ? numUVs : 0;
 
-	if (vertColors)
-		outputMesh.setVertexColors(vColors, vertexList);
+	if (hasNormals)
+		outputMesh.setVertexNormals(m_arrays.normals, m_arrays.vertexList());
+	else if (hasFaceNormals)
+		outputMesh.setFaceVertexNormals(m_arrays.normals, m_arrays.normalFaces, m_arrays.polyConnects);
+
+	if (hasColors)
+		outputMesh.setVertexColors(m_arrays.colors, m_arrays.vertexList());
 
 	// set the updates
 	outputMesh.updateSurface();
-
-	delete[] vertPositions;
-	delete[] polyVIndicesNum;
-	delete[] polyVIndices;
-	delete[] vertNormals;
-	delete[] vertMotions;
-	delete[] vertColors;
-	delete[] vertUVWs;
-	delete[] nodeNormals;
-	delete[] nodeColors;
-	delete[] nodeUVWs;
+	const long long buildEnd = Utilities::TraceLog::now();
+	m_statistics.buildTime += toMilliseconds(buildEnd - buildStart);
+	trace("build", buildStart, buildEnd, sameTopology ? "\"sameTopology\": true" : "\"sameTopology\": false");
 
 	MGlobal::displayInfo(MString("# vertices: ") + numVertices);
 	MGlobal::displayInfo(MString("# faces: ") + numPolygons);
 
-	return true;
+	return m_outputData;
 }
 
-bool MeshLoader::readPLYFile(const std::string &fileName, MObject &outputData)
-{
-	try
-	{
-		// Construct a data object by reading from file
-		happly::PLYData plyIn(fileName);
-
-		MPointArray points;
-		MVectorArray vNormals;
-		MColorArray vColors;
-		MIntArray vertexList;
 
-		happly::Element &element = plyIn.getElement("vertex");
+int MeshLoader::getRigidTransform(const std::string &currentFile, const int frameIndex, const int referenceFrame, const bool positionsOnly,
+	 const double tolerance, const int prefetchDepth, MMatrix &matrix, std::string &error)
+{
+	Utilities::FrameCache &cache = Utilities::FrameCache::getInstance();
 
-		int numVertices = 0;
-		int numPolygons = 0;
+	// the reference mesh is only loaded once
+	const std::string referenceFile = convertFileName(m_meshPattern, referenceFrame);
+	if (!m_rigidReference || (referenceFile != m_rigidReferenceFile) || (positionsOnly != m_rigidReferencePositionsOnly))
+	{
+		m_rigidTransforms.clear();
+		m_outputIsReference = false;
+		m_rigidReferenceFile = "";
+		bool fileRead = false;
+		m_rigidReference = cache.load(referenceFile, positionsOnly, error, &fileRead, m_measureRead);
+		if (!m_rigidReference)
+			return -1;
+		recordLoad(*m_rigidReference, referenceFile, fileRead);
+		m_rigidReferenceFile = referenceFile;
+		m_rigidReferencePositionsOnly = positionsOnly;
+		m_rigidReferenceDiagonal = Utilities::RigidTransform::boundingBoxDiagonal(m_rigidReference->positions.data(), m_rigidReference->numVertices(), 4);
+	}
 
-		// vertices
-		if ((element.hasPropertyType<float>("x")) &&
-			(element.hasPropertyType<float>("y")) &&
-			(element.hasPropertyType<float>("z")))
+	Utilities::RigidTransform transform;
+	bool rigid = true;
+	if (m_transformPattern.pattern != "")
+	{
+		// the transformation is read from a sidecar file, no mesh data is needed
+		prefetch(currentFile, frameIndex, true, 0);
+		const std::string fileName = convertFileName(m_transformPattern, frameIndex);
+		if (!transform.readMayaMatrix(fileName))
 		{
-			std::vector<float> x = element.getProperty<float>("x");
-			std::vector<float> y = element.getProperty<float>("y");
-			std::vector<float> z = element.getProperty<float>("z");
-
-			numVertices = (int) x.size();
-			points.setLength(numVertices);
-			vertexList.setLength(numVertices);
-			for (int i = 0; i < numVertices; i++)
-			{
-				vertexList[i] = i;
-				MPoint p(x[i], y[i], z[i]);
-				p.cartesianize();
-				points[i] = p;
-			}
+			error = "Error: unable to read transformation file " + fileName;
+			return -1;
 		}
-		else if ((element.hasPropertyType<double>("x")) &&
-				(element.hasPropertyType<double>("y")) &&
-				(element.hasPropertyType<double>("z")))
+	}
+	else
+	{
+		// fit the transformation to the positions of the frame, the result is
+		// kept as long as the file does not change
+		long long mtime = 0;
+		long long fileSize = 0;
+		Utilities::FileSystem::getFileStatus(currentFile, mtime, fileSize);
+		std::map<std::string, RigidFrame>::iterator it = m_rigidTransforms.find(currentFile);
+		if ((it != m_rigidTransforms.end()) && (it->second.mtime == mtime) && (it->second.fileSize == fileSize))
 		{
-			std::vector<double> x = element.getProperty<double>("x");
-			std::vector<double> y = element.getProperty<double>("y");
-			std::vector<double> z = element.getProperty<double>("z");
-
-			numVertices = (int) x.size();
-			points.setLength(numVertices);
-			vertexList.setLength(numVertices);
-			for (int i = 0; i < numVertices; i++)
-			{
-				vertexList[i] = i;
-				MPoint p(x[i], y[i], z[i]);
-				p.cartesianize();
-				points[i] = p;
-			}
+			prefetch(currentFile, frameIndex, true, prefetchDepth);
+			transform = it->second.transform;
+			rigid = it->second.rigid;
 		}
 		else
-			return false;
-
-				
-		// normals
-		bool foundNormals = false;
-		if ((element.hasPropertyType<float>("nx")) &&
-			(element.hasPropertyType<float>("ny")) &&
-			(element.hasPropertyType<float>("nz")))
-		{
-			std::vector<float> nx = element.getProperty<float>("nx");
-			std::vector<float> ny = element.getProperty<float>("ny");
-			std::vector<float> nz = element.getProperty<float>("nz");
-
-			vNormals.setLength((int)nx.size());
-			for (int i = 0; i < (int)nx.size(); i++)
-				vNormals[i] = MVector(nx[i], ny[i], nz[i]);
-			foundNormals = true;
-		}
-		else if ((element.hasPropertyType<double>("nx")) &&
-				(element.hasPropertyType<double>("ny")) &&
-				(element.hasPropertyType<double>("nz")))
-		{
-			std::vector<double> nx = element.getProperty<double>("nx");
-			std::vector<double> ny = element.getProperty<double>("ny");
-			std::vector<double> nz = element.getProperty<double>("nz");
-
-			vNormals.setLength((int)nx.size());
-			for (int i = 0; i < (int)nx.size(); i++)
-				vNormals[i] = MVector(nx[i], ny[i], nz[i]);
-			foundNormals = true;
-		}
-
-		// vertex colors
-		bool foundVertColors = false;
-		if ((element.hasPropertyType<unsigned char>("red")) &&
-			(element.hasPropertyType<unsigned char>("green")) &&
-			(element.hasPropertyType<unsigned char>("blue")))
 		{
-			std::vector<unsigned char> r = element.getProperty<unsigned char>("red");
-			std::vector<unsigned char> g = element.getProperty<unsigned char>("green");
-			std::vector<unsigned char> b = element.getProperty<unsigned char>("blue");
-
-			vColors.setLength((int)r.size());
-			for (int i = 0; i < (int)r.size(); i++)
-				vColors[i] = MColor((float)r[i] / 255.0f, (float)g[i] / 255.0f, (float)b[i] / 255.0f, 1.0f);		
-			foundVertColors = true;
-		}
-		
-		// faces
-		MIntArray polyConnects;
-		MIntArray polyCounts;
-		std::vector<std::vector<size_t>> fInd = plyIn.getFaceIndices<size_t>();
-		numPolygons = (int)fInd.size();
-		int numNodes = 0;
-		for (int i = 0; i < numPolygons; i++)
-			numNodes += (int)fInd[i].size();
-
-		polyCounts.setLength(numPolygons);
-		polyConnects.setLength(numNodes);
-		
-		int index = 0;
-		for (int i = 0; i < numPolygons; i++)
-		{
-			for (int j = 0; j < (int)fInd[i].size(); j++)
+			std::shared_ptr<Utilities::MeshData> frame;
+			bool prefetched = false;
+			bool fileRead = false;
+			if (m_prefetcher)
+				prefetched = m_prefetcher->take(currentFile, true, frame, error, &fileRead);
+			prefetch(currentFile, frameIndex, true, prefetchDepth);
+			if (!prefetched)
+				frame = cache.load(currentFile, true, error, &fileRead, m_measureRead);
+			if (!frame)
+				return -1;
+			recordLoad(*frame, currentFile, fileRead);
+
+			const Utilities::MeshData &reference = *m_rigidReference;
+			rigid = (frame->numVertices() == reference.numVertices()) && (frame->topologyHash == reference.topologyHash);
+			if (rigid)
 			{
-				polyConnects[index++] = (int)fInd[i][j];
+				const double residual = transform.fit(reference.positions.data(), frame->positions.data(), reference.numVertices(), 4);
+				rigid = residual <= tolerance * m_rigidReferenceDiagonal;
 			}
-			polyCounts[i] = (int)fInd[i].size();
-		}
-		
-		MFnMesh outputMesh;
-		MObject outputMeshObj = outputMesh.create(numVertices, numPolygons, points, polyCounts, polyConnects, outputData);
-
-		if (foundNormals)
-			outputMesh.setVertexNormals(vNormals, vertexList);
-
-		if (foundVertColors)
-			outputMesh.setVertexColors(vColors, vertexList);
 
-		// set the updates
-		outputMesh.updateSurface();
-
-		MGlobal::displayInfo(MString("# vertices: ") + numVertices);
-		MGlobal::displayInfo(MString("# faces: ") + numPolygons);
-	}
-	catch (const std::exception & e)
-	{
-		MGlobal::displayError(MString("Exception: ") + e.what());
-		return false;
+			RigidFrame &rigidFrame = m_rigidTransforms[currentFile];
+			rigidFrame.mtime = mtime;
+			rigidFrame.fileSize = fileSize;
+			rigidFrame.rigid = rigid;
+			rigidFrame.transform = transform;
+		}
 	}
-	
-	return true;
+	transform.getMayaMatrix(matrix.matrix);
+	return rigid ? 1 : 0;
 }
 
 
-bool MeshLoader::readOBJFile(const std::string &fileName, MObject &outputData)
+std::string MeshLoader::convertFileName(FilePattern &filePattern, const unsigned int currentFrame)
 {
-	// Construct a data object by reading from file
-	std::vector<Utilities::OBJLoader::Vec3f> x;
-	std::vector<Utilities::OBJLoader::Vec3f> normals;
-	std::vector<Utilities::MeshFaceIndices> faces;
-	Utilities::OBJLoader::Vec3f s = { 1.0f, 1.0f, 1.0f };
-	Utilities::OBJLoader::loadObj(fileName, &x, &faces, &normals, nullptr, s);
-
-	MPointArray points;
-	MVectorArray vNormals;
-	MIntArray vertexList;
-
-	int numVertices = (int)x.size();
-	int numPolygons = (int)faces.size();
-
-	points.setLength(numVertices);
-	vertexList.setLength(numVertices);
-	for (int i = 0; i < numVertices; i++)
+	// a relative pattern is resolved again when the scene directory was invalidated
+	if (filePattern.relative && (filePattern.sceneVersion != m_sceneVersion))
 	{
-		vertexList[i] = i;
-		MPoint p(x[i][0], x[i][1], x[i][2]);
-		p.cartesianize();
-		points[i] = p;
+		unsigned int version = 0;
+		const std::string scenePath = getSceneDirectory(version);
+		filePattern.sequence.setPattern(Utilities::FileSystem::normalizePath(scenePath + "/" + filePattern.pattern));
+		filePattern.sceneVersion = version;
 	}
+	return filePattern.sequence.getFileName(currentFrame);
+}
 
-	// normals
-	bool foundNormals = normals.size() > 0;
-	if (foundNormals)
-	{
-		vNormals.setLength((int)normals.size());
-		for (int i = 0; i < (int)normals.size(); i++)
-			vNormals[i] = MVector(normals[i][0], normals[i][1], normals[i][2]);
-	}
+void MeshLoader::setPattern(FilePattern &filePattern, const std::string &value)
+{
+	if (value == filePattern.value)
+		return;
+	filePattern.value = value;
+	filePattern.pattern = value;
 
-	// faces
-	MIntArray polyConnects;
-	MIntArray polyCounts;
+	// remove "
+	filePattern.pattern.erase(std::remove(filePattern.pattern.begin(), filePattern.pattern.end(), '\"'), filePattern.pattern.end());
 
-	polyCounts.setLength(numPolygons);
-	polyConnects.setLength(3 * numPolygons);
+	filePattern.relative = (filePattern.pattern != "") && Utilities::FileSystem::isRelativePath(filePattern.pattern);
+	filePattern.sequence.setPattern(filePattern.pattern);
+	filePattern.sceneVersion = 0;
+}
 
-	int index = 0;
-	for (int i = 0; i < numPolygons; i++)
+std::string MeshLoader::getSceneDirectory(unsigned int &version)
+{
+	std::lock_guard<std::mutex> lock(m_sceneMutex);
+	if (!m_sceneDirectoryValid)
 	{
-		for (int j = 0; j < 3; j++)
-		{
-			polyConnects[index++] = faces[i].posIndices[j]-1;
-		}
-		polyCounts[i] = 3;
+		// Get path of the scene file
+		MCommandResult result;
+		MGlobal::executeCommand(MString("file -q -sn"), result);
+		MString sceneFile;
+		result.getResult(sceneFile);
+		m_sceneDirectory = Utilities::FileSystem::getFilePath(sceneFile.asChar());
+		m_sceneDirectoryValid = true;
 	}
-
-	MFnMesh outputMesh;
-	MObject outputMeshObj = outputMesh.create(numVertices, numPolygons, points, polyCounts, polyConnects, outputData);
-
-	if (foundNormals)
-		outputMesh.setVertexNormals(vNormals, vertexList);
-
-	// set the updates
-		outputMesh.updateSurface();
-
-	MGlobal::displayInfo(MString("# vertices: ") + numVertices);
-	MGlobal::displayInfo(MString("# faces: ") + numPolygons);
-
-	return true;
+	version = m_sceneVersion;
+	return m_sceneDirectory;
 }
 
-
-std::string MeshLoader::zeroPadding(const unsigned int number, const unsigned int length)
+void MeshLoader::sceneChanged(void *clientData)
 {
-	std::ostringstream out;
-	out << std::internal << std::setfill('0') << std::setw(length) << number;
-	return out.str();
+	std::lock_guard<std::mutex> lock(m_sceneMutex);
+	m_sceneDirectoryValid = false;
+	m_sceneVersion++;
 }
 
-std::string MeshLoader::convertFileName(const std::string &inputFileName, const unsigned int currentFrame)
+MStatus MeshLoader::addSceneCallbacks()
 {
-	std::string fileName = inputFileName;
-
-	// remove 
-	char ch = '\"';
-	fileName.erase(std::remove(fileName.begin(), fileName.end(), ch), fileName.end());
-
-	std::string::size_type pos1 = fileName.find_first_of("#", 0);
-	if (pos1 != std::string::npos)
+	// the scene name is also set while a scene is opened, so it is invalidated before and after
+	const MSceneMessage::Message messages[] = { MSceneMessage::kBeforeOpen, MSceneMessage::kAfterOpen, MSceneMessage::kAfterSave,
+		MSceneMessage::kBeforeNew, MSceneMessage::kAfterNew };
+	for (const MSceneMessage::Message message : messages)
 	{
-		std::string::size_type pos2 = fileName.find_first_not_of("#", pos1);
-		std::string::size_type length = pos2 - pos1;
-
-		std::string numberStr = zeroPadding(currentFrame, (unsigned int)length);
-		fileName.replace(pos1, length, numberStr);
+		MStatus status;
+		const MCallbackId id = MSceneMessage::addCallback(message, &MeshLoader::sceneChanged, nullptr, &status);
+		if (!status)
+			return status;
+		m_sceneCallbacks.append(id);
 	}
+	return MS::kSuccess;
+}
+
+void MeshLoader::removeSceneCallbacks()
+{
+	MMessage::removeCallbacks(m_sceneCallbacks);
+	m_sceneCallbacks.clear();
+	sceneChanged(nullptr);
+}
 
-	if (Utilities::FileSystem::isRelativePath(fileName))
+void MeshLoader::recordLoad(const Utilities::MeshData &mesh, const std::string &fileName, const bool fileRead)
+{
+	if (!fileRead)
+		return;
+	const Utilities::MeshData::LoadStatistics &stats = mesh.loadStatistics;
+	m_statistics.readTime += toMilliseconds(stats.readDuration);
+	m_statistics.parseTime += toMilliseconds(stats.parseDuration);
+	m_statistics.bytesRead += (double)stats.fileBytes;
+
+	// the file may have been read by a prefetch thread, so the events are added with its time stamps and thread
+	if (m_traceLog)
 	{
-		// Get path of the scene file
-		MCommandResult result;
-		MGlobal::executeCommand(MString("file -q -sn"), result);
-		MString sceneFile;
-		result.getResult(sceneFile);
-		std::string scenePath = Utilities::FileSystem::getFilePath(sceneFile.asChar());
-		fileName = Utilities::FileSystem::normalizePath(scenePath + "/" + fileName);
+		std::ostringstream args;
+		args << "\"file\": \"" << Utilities::TraceLog::escape(fileName) << "\", \"bytes\": " << stats.fileBytes;
+		m_traceLog->addEvent("read", stats.readStart, stats.readDuration, stats.threadId, args.str());
+		m_traceLog->addEvent("parse", stats.readStart + stats.readDuration, stats.parseDuration, stats.threadId, args.str());
 	}
-	return fileName;
+}
+
+void MeshLoader::trace(const char *name, const long long start, const long long end, const std::string &args)
+{
+	if (!m_traceLog)
+		return;
+	MFnDependencyNode node(thisMObject());
+	std::string nodeArgs = std::string("\"node\": \"") + Utilities::TraceLog::escape(node.name().asChar()) + "\"";
+	if (args != "")
+		nodeArgs += ", " + args;
+	m_traceLog->addEvent(name, start, end - start, Utilities::TraceLog::currentThreadId(), nodeArgs);
+}
+
+void MeshLoader::setStatistics(MDataBlock &block)
+{
+	block.outputValue(m_pathTimeAttr).set(m_statistics.pathTime);
+	block.outputValue(m_readTimeAttr).set(m_statistics.readTime);
+	block.outputValue(m_parseTimeAttr).set(m_statistics.parseTime);
+	block.outputValue(m_convertTimeAttr).set(m_statistics.convertTime);
+	block.outputValue(m_buildTimeAttr).set(m_statistics.buildTime);
+	block.outputValue(m_bytesReadAttr).set(m_statistics.bytesRead);
+	block.outputValue(m_earlyOutAttr).set(m_statistics.earlyOut);
+
+	block.setClean(m_pathTimeAttr);
+	block.setClean(m_readTimeAttr);
+	block.setClean(m_parseTimeAttr);
+	block.setClean(m_convertTimeAttr);
+	block.setClean(m_buildTimeAttr);
+	block.setClean(m_bytesReadAttr);
+	block.setClean(m_earlyOutAttr);
 }
 
 bool MeshLoader::setInternalValue(const MPlug &plug, const MDataHandle &handle)
@@ -601,6 +868,7 @@ bool MeshLoader::setInternalValue(const MPlug &plug, const MDataHandle &handle)
 		// remove "
 		char ch = '\"';
 		m_meshFile.erase(std::remove(m_meshFile.begin(), m_meshFile.end(), ch), m_meshFile.end());
+		setPattern(m_meshPattern, m_meshFile);
 
 		return true;
 	}
@@ -4,11 +4,24 @@
 #include <maya/MObject.h>
 #include <maya/MPlug.h>
 #include <maya/MDataBlock.h>
+#include <maya/MMatrix.h>
 #include <maya/MPxLocatorNode.h>
 #include <maya/MMessage.h>
 #include <maya/MNodeMessage.h>
+#include <maya/MSceneMessage.h>
+#include <maya/MCallbackIdArray.h>
 #include <vector>
-#include "extern/mzd/readMZD.h"
+#include <memory>
+#include "MeshData.h"
+#include "MeshPrefetcher.h"
+#include "FrameCache.h"
+#include "RigidTransform.h"
+#include "TraceLog.h"
+#include "FileSequence.h"
+#include "MayaMeshArrays.h"
+#include <map>
+#include <mutex>
+#include <atomic>
 
 
 #define CheckError(stat, msg)		\
@@ -21,7 +34,7 @@
 class MeshLoader: public MPxLocatorNode
 {
 public:
-	enum class FileType { MZD = 0, PLY, OBJ, Unknown, NumFileTypes };
+	enum class FileType { MZD = 0, PLY, OBJ, MTC, Unknown, NumFileTypes };
 
 	MeshLoader();
 	~MeshLoader() override;
@@ -39,7 +52,26 @@ public:
 	static MObject m_activeAttr;
 	static MObject m_meshFileAttr;
 	static MObject m_frameIndex;
+	static MObject m_positionsOnlyAttr;
+	static MObject m_prefetchDepthAttr;
+	static MObject m_rigidBodyAttr;
+	static MObject m_referenceFrameAttr;
+	static MObject m_rigidToleranceAttr;
+	static MObject m_transformFileAttr;
+	static MObject m_outMatrixAttr;
+	static MObject m_traceFileAttr;
+	static MObject m_measureReadAttr;
+	static MObject m_pathTimeAttr;
+	static MObject m_readTimeAttr;
+	static MObject m_parseTimeAttr;
+	static MObject m_convertTimeAttr;
+	static MObject m_buildTimeAttr;
+	static MObject m_bytesReadAttr;
+	static MObject m_earlyOutAttr;
 
+	/** Register the scene messages which invalidate the cached scene directory, see getSceneDirectory(). */
+	static MStatus addSceneCallbacks();
+	static void removeSceneCallbacks();
 
 protected:	
 	int m_currentFrame;
@@ -47,14 +79,117 @@ protected:
 	MObject m_emptyMeshObject;
 	FileType m_fileType;
 	std::string m_lastFileName;
+	bool m_lastPositionsOnly;
 	std::string m_meshFile;
 
-	bool readMZDFile(const std::string &fileName, MObject &outputData);
-	bool readPLYFile(const std::string &fileName, MObject &outputData);
-	bool readOBJFile(const std::string &fileName, MObject &outputData);
+	/** File name pattern of an attribute. The pattern is parsed when it is set
+	* and a relative pattern is made absolute once for each scene directory, so
+	* that the file name of a frame only needs the index to be formatted.
+	*/
+	struct FilePattern
+	{
+		/** Attribute value the pattern was set from */
+		std::string value;
+		/** Pattern without quotes */
+		std::string pattern;
+		bool relative = false;
+		/** Absolute pattern */
+		Utilities::FileSequence sequence;
+		/** Scene directory version the sequence was resolved for, 0 if it was not resolved yet */
+		unsigned int sceneVersion = 0;
+	};
+	FilePattern m_meshPattern;
+	FilePattern m_transformPattern;
 
-	std::string convertFileName(const std::string &inputFileName, const unsigned int currentFrame);
-	std::string zeroPadding(const unsigned int number, const unsigned int length);
+	/** Directory of the scene file, queried when it is needed after the scene was opened, saved or created */
+	static std::mutex m_sceneMutex;
+	static std::string m_sceneDirectory;
+	static bool m_sceneDirectoryValid;
+	/** Incremented whenever the scene directory is invalidated */
+	static std::atomic<unsigned int> m_sceneVersion;
+	static MCallbackIdArray m_sceneCallbacks;
+	/** Last frame index and frame change, used to infer the playback direction */
+	int m_lastFrameIndex;
+	int m_lastFrameDelta;
+	int m_frameStep;
+	/** Background loader of the next frames, only created if prefetching is enabled */
+	std::unique_ptr<Utilities::MeshPrefetcher> m_prefetcher;
+
+	/** Output of the last frame, which is updated in place if the next frame has the same topology */
+	MObject m_outputData;
+	MObject m_outputMesh;
+	bool m_hasOutputMesh;
+	int m_outputNumVertices;
+	int m_outputNumPolygons;
+	size_t m_outputNumConnects;
+	unsigned long long m_outputTopologyHash;
+	bool m_outputHasNormals;
+	bool m_outputHasFaceNormals;
+	bool m_outputHasColors;
+	bool m_outputHasUVs;
+	int m_outputNumUVs;
+	/** True if the output is the mesh of the rigid body reference frame */
+	bool m_outputIsReference;
+	/** Maya arrays of the last built mesh, reused so that their memory is not reallocated each frame */
+	MayaMeshArrays m_arrays;
+
+	/** Rigid body mode: mesh of the reference frame and the transformations of the frames */
+	struct RigidFrame
+	{
+		long long mtime;
+		long long fileSize;
+		bool rigid;
+		Utilities::RigidTransform transform;
+	};
+	std::shared_ptr<Utilities::MeshData> m_rigidReference;
+	std::string m_rigidReferenceFile;
+	bool m_rigidReferencePositionsOnly;
+	double m_rigidReferenceDiagonal;
+	std::map<std::string, RigidFrame> m_rigidTransforms;
+	std::string m_lastRigidSettings;
+
+	/** Statistics of the last evaluation, times in milliseconds. Read and parse
+	* times and bytes are only counted for files which were read for this node,
+	* not for frames which were taken from the shared cache.
+	*/
+	struct Statistics
+	{
+		double pathTime = 0.0;
+		double readTime = 0.0;
+		double parseTime = 0.0;
+		double convertTime = 0.0;
+		double buildTime = 0.0;
+		double bytesRead = 0.0;
+		bool earlyOut = false;
+	};
+	Statistics m_statistics;
+	/** Optional Chrome trace log, see the traceFile attribute */
+	std::shared_ptr<Utilities::TraceLog> m_traceLog;
+	/** Read the files before parsing them, so that readTime and parseTime are separate, see the measureRead attribute */
+	bool m_measureRead;
+
+	void prefetch(const std::string &currentFile, const int frameIndex, const bool positionsOnly, const int prefetchDepth);
+	MObject buildMesh(const Utilities::MeshData &mesh);
+	/** Get the transformation from the reference frame to the current frame. Returns 1 if the frame
+	* is a rigid motion of the reference frame, 0 if not and -1 if a file could not be read.
+	*/
+	int getRigidTransform(const std::string &currentFile, const int frameIndex, const int referenceFrame, const bool positionsOnly,
+		const double tolerance, const int prefetchDepth, MMatrix &matrix, std::string &error);
+
+	/** Set a file name pattern if the attribute value changed. */
+	static void setPattern(FilePattern &filePattern, const std::string &value);
+	/** File name of a frame, relative patterns are relative to the directory of the scene file. */
+	std::string convertFileName(FilePattern &filePattern, const unsigned int currentFrame);
+	/** Directory of the scene file and the version of the cache it was taken from. */
+	static std::string getSceneDirectory(unsigned int &version);
+	static void sceneChanged(void *clientData);
+
+	/** Add the read and parse times of a frame to the statistics and the trace log if the file was read for this node. */
+	void recordLoad(const Utilities::MeshData &mesh, const std::string &fileName, const bool fileRead);
+	/** Add an event of the calling thread to the trace log if it is enabled. */
+	void trace(const char *name, const long long start, const long long end, const std::string &args = "");
+	/** Write the statistics to the output attributes. */
+	void setStatistics(MDataBlock &block);
 
 	void setEmptyMesh(MArrayDataHandle &arrayData);
 };
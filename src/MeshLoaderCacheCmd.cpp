@@ -0,0 +1,107 @@
+#include "MeshLoaderCacheCmd.h"
+#include "FrameCache.h"
+#include "ThreadPool.h"
+
+#include <maya/MArgDatabase.h>
+#include <maya/MGlobal.h>
+
+#define MEMORY_FLAG			"-m"
+#define MEMORY_FLAG_LONG	"-memory"
+#define USAGE_FLAG			"-u"
+#define USAGE_FLAG_LONG		"-usage"
+#define FRAMES_FLAG			"-f"
+#define FRAMES_FLAG_LONG	"-frames"
+#define HITS_FLAG			"-hi"
+#define HITS_FLAG_LONG		"-hits"
+#define MISSES_FLAG			"-mi"
+#define MISSES_FLAG_LONG	"-misses"
+#define CLEAR_FLAG			"-cl"
+#define CLEAR_FLAG_LONG		"-clear"
+#define RESET_FLAG			"-rc"
+#define RESET_FLAG_LONG		"-resetCounters"
+#define THREADS_FLAG		"-th"
+#define THREADS_FLAG_LONG	"-threads"
+
+const char *MeshLoaderCacheCmd::m_name = "meshLoaderCache";
+
+void *MeshLoaderCacheCmd::creator()
+{
+	return new MeshLoaderCacheCmd;
+}
+
+MSyntax MeshLoaderCacheCmd::newSyntax()
+{
+	MSyntax syntax;
+	syntax.addFlag(MEMORY_FLAG, MEMORY_FLAG_LONG, MSyntax::kLong);
+	syntax.addFlag(USAGE_FLAG, USAGE_FLAG_LONG);
+	syntax.addFlag(FRAMES_FLAG, FRAMES_FLAG_LONG);
+	syntax.addFlag(HITS_FLAG, HITS_FLAG_LONG);
+	syntax.addFlag(MISSES_FLAG, MISSES_FLAG_LONG);
+	syntax.addFlag(CLEAR_FLAG, CLEAR_FLAG_LONG);
+	syntax.addFlag(RESET_FLAG, RESET_FLAG_LONG);
+	syntax.addFlag(THREADS_FLAG, THREADS_FLAG_LONG, MSyntax::kLong);
+	syntax.enableQuery(true);
+	syntax.enableEdit(false);
+	return syntax;
+}
+
+MStatus MeshLoaderCacheCmd::doIt(const MArgList &args)
+{
+	MStatus status;
+	MArgDatabase argData(syntax(), args, &status);
+	if (!status)
+		return status;
+
+	Utilities::FrameCache &cache = Utilities::FrameCache::getInstance();
+	const double MB = 1024.0 * 1024.0;
+
+	if (argData.isQuery())
+	{
+		if (argData.isFlagSet(MEMORY_FLAG))
+			setResult((int)(cache.getBudget() / (1024 * 1024)));
+		else if (argData.isFlagSet(USAGE_FLAG))
+			setResult((double)cache.getMemoryUsage() / MB);
+		else if (argData.isFlagSet(FRAMES_FLAG))
+			setResult((int)cache.getNumFrames());
+		else if (argData.isFlagSet(HITS_FLAG))
+			setResult((int)cache.getHits());
+		else if (argData.isFlagSet(MISSES_FLAG))
+			setResult((int)cache.getMisses());
+		else if (argData.isFlagSet(THREADS_FLAG))
+			setResult((int)Utilities::ThreadPool::getInstance().getNumThreads());
+		else
+		{
+			MGlobal::displayError("meshLoaderCache: no flag to query.");
+			return MS::kInvalidParameter;
+		}
+		return MS::kSuccess;
+	}
+
+	if (argData.isFlagSet(MEMORY_FLAG))
+	{
+		int memory = 0;
+		argData.getFlagArgument(MEMORY_FLAG, 0, memory);
+		if (memory < 0)
+		{
+			MGlobal::displayError("meshLoaderCache: the memory budget must not be negative.");
+			return MS::kInvalidParameter;
+		}
+		cache.setBudget((size_t)memory * 1024 * 1024);
+	}
+	if (argData.isFlagSet(THREADS_FLAG))
+	{
+		int numThreads = 0;
+		argData.getFlagArgument(THREADS_FLAG, 0, numThreads);
+		if (numThreads < 0)
+		{
+			MGlobal::displayError("meshLoaderCache: the number of threads must not be negative.");
+			return MS::kInvalidParameter;
+		}
+		Utilities::ThreadPool::getInstance().setNumThreads((unsigned int)numThreads);
+	}
+	if (argData.isFlagSet(CLEAR_FLAG))
+		cache.clear();
+	if (argData.isFlagSet(RESET_FLAG))
+		cache.resetCounters();
+	return MS::kSuccess;
+}
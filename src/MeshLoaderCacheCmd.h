@@ -0,0 +1,33 @@
+#ifndef __MeshLoaderCacheCmd_h__
+#define __MeshLoaderCacheCmd_h__
+
+#include <maya/MPxCommand.h>
+#include <maya/MSyntax.h>
+#include <maya/MArgList.h>
+
+/** \brief MEL/Python command to control the frame cache and the thread pool shared by all MeshLoader nodes.
+*
+* meshLoaderCache -memory 2048;		// set the memory budget in MB (0 disables the cache)
+* meshLoaderCache -q -memory;		// query the memory budget in MB
+* meshLoaderCache -q -usage;		// query the memory used by cached frames in MB
+* meshLoaderCache -q -frames;		// query the number of cached frames
+* meshLoaderCache -q -hits;			// query the number of requests which did not read the file
+* meshLoaderCache -q -misses;		// query the number of requests which read the file
+* meshLoaderCache -clear;			// remove all frames
+* meshLoaderCache -resetCounters;	// reset hits and misses
+* meshLoaderCache -threads 4;		// set the number of threads of the conversion loops (0 = all cores)
+* meshLoaderCache -q -threads;		// query the number of threads
+*/
+class MeshLoaderCacheCmd : public MPxCommand
+{
+public:
+	static const char *m_name;
+
+	MStatus doIt(const MArgList &args) override;
+	bool isUndoable() const override { return false; }
+
+	static void *creator();
+	static MSyntax newSyntax();
+};
+
+#endif
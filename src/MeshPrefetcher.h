@@ -0,0 +1,187 @@
+#ifndef __MeshPrefetcher_h__
+#define __MeshPrefetcher_h__
+
+#include "MeshData.h"
+#include "FrameCache.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+namespace Utilities
+{
+	/** \brief Loads mesh files on background threads before they are needed.
+	* prefetch() replaces the set of files which should be loaded, take() returns
+	* a file if it was prefetched. If the file is still being loaded, take() waits
+	* for it. Files which are only queued are removed from the queue, so that the
+	* caller can read them directly without waiting for other files.
+	* The files are loaded through the shared FrameCache. The prefetcher keeps a
+	* reference to each loaded frame until it is taken, even if the cache is
+	* disabled or has evicted it.
+	*/
+	class MeshPrefetcher
+	{
+	public:
+		/** Start numThreads worker threads (at least one). */
+		explicit MeshPrefetcher(const unsigned int numThreads = 2) : m_measureRead(false), m_stop(false)
+		{
+			for (unsigned int i = 0; i < std::max(numThreads, 1u); i++)
+				m_threads.push_back(std::thread(&MeshPrefetcher::worker, this));
+		}
+
+		/** Stop the workers. Files which are currently loaded are finished first. */
+		~MeshPrefetcher()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+				m_queue.clear();
+			}
+			m_jobCondition.notify_all();
+			for (std::thread &t : m_threads)
+				t.join();
+		}
+
+		MeshPrefetcher(const MeshPrefetcher&) = delete;
+		MeshPrefetcher& operator=(const MeshPrefetcher&) = delete;
+
+		/** Get a prefetched file. Returns false if the file was not prefetched.
+		* Otherwise mesh is set to the loaded data or to null if loading failed,
+		* in this case error contains the message of the reader. fileRead is set
+		* as by FrameCache::load() for the load of the worker thread.
+		*/
+		bool take(const std::string &fileName, const bool positionsOnly, std::shared_ptr<MeshData> &mesh, std::string &error, bool *fileRead = nullptr)
+		{
+			const Key key(fileName, positionsOnly);
+			std::unique_lock<std::mutex> lock(m_mutex);
+			std::map<Key, Entry>::iterator it = m_entries.find(key);
+			if (it == m_entries.end())
+				return false;
+			if (it->second.state == State::Queued)
+			{
+				m_queue.erase(std::remove(m_queue.begin(), m_queue.end(), key), m_queue.end());
+				m_entries.erase(it);
+				return false;
+			}
+
+			// the entry is kept while it has waiters, even if prefetch() discards the file
+			it->second.waiters++;
+			m_doneCondition.wait(lock, [&]() { return it->second.state != State::Loading; });
+			mesh = it->second.mesh;
+			error = it->second.error;
+			if (fileRead != nullptr)
+				*fileRead = it->second.fileRead;
+			if (--it->second.waiters == 0)
+				m_entries.erase(it);
+			return true;
+		}
+
+		/** Set the files to load in the given order. Loaded or queued files which
+		* are not in the list are discarded. measureRead is passed to
+		* FrameCache::load() for the files which are loaded next.
+		*/
+		void prefetch(const std::vector<std::string> &fileNames, const bool positionsOnly, const bool measureRead = false)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_measureRead = measureRead;
+				for (std::map<Key, Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+					it->second.wanted = false;
+
+				m_queue.clear();
+				for (const std::string &fileName : fileNames)
+				{
+					const Key key(fileName, positionsOnly);
+					Entry &entry = m_entries[key];
+					if (entry.state == State::Queued && !entry.wanted)
+						m_queue.push_back(key);
+					entry.wanted = true;
+				}
+
+				// files which are being loaded are removed by the worker when it is done
+				for (std::map<Key, Entry>::iterator it = m_entries.begin(); it != m_entries.end();)
+				{
+					if (!it->second.wanted && (it->second.state != State::Loading) && (it->second.waiters == 0))
+						it = m_entries.erase(it);
+					else
+						++it;
+				}
+			}
+			m_jobCondition.notify_all();
+		}
+
+		/** Discard all queued and loaded files. */
+		void clear()
+		{
+			prefetch(std::vector<std::string>(), false);
+		}
+
+	protected:
+		enum class State { Queued, Loading, Ready, Failed };
+		typedef std::pair<std::string, bool> Key;
+
+		struct Entry
+		{
+			Entry() : state(State::Queued), wanted(false), waiters(0), fileRead(false) {}
+			State state;
+			bool wanted;
+			int waiters;
+			bool fileRead;
+			std::shared_ptr<MeshData> mesh;
+			std::string error;
+		};
+
+		std::vector<std::thread> m_threads;
+		std::mutex m_mutex;
+		std::condition_variable m_jobCondition;
+		std::condition_variable m_doneCondition;
+		std::deque<Key> m_queue;
+		std::map<Key, Entry> m_entries;
+		bool m_measureRead;
+		bool m_stop;
+
+		void worker()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (true)
+			{
+				m_jobCondition.wait(lock, [&]() { return m_stop || !m_queue.empty(); });
+				if (m_stop)
+					return;
+
+				const Key key = m_queue.front();
+				m_queue.pop_front();
+				m_entries[key].state = State::Loading;
+				const bool measureRead = m_measureRead;
+				lock.unlock();
+
+				// loading through the shared cache avoids reading a file which another node already reads
+				std::string error;
+				bool fileRead = false;
+				std::shared_ptr<MeshData> mesh = FrameCache::getInstance().load(key.first, key.second, error, &fileRead, measureRead);
+				const bool ok = (mesh != nullptr);
+
+				lock.lock();
+				std::map<Key, Entry>::iterator it = m_entries.find(key);
+				if (!it->second.wanted && (it->second.waiters == 0))
+					m_entries.erase(it);
+				else
+				{
+					it->second.state = ok ? State::Ready : State::Failed;
+					if (ok)
+						it->second.mesh = mesh;
+					it->second.error = error;
+					it->second.fileRead = fileRead;
+				}
+				m_doneCondition.notify_all();
+			}
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,515 @@
+#include "MeshReader.h"
+#include "MeshCacheFile.h"
+#include "FileSystem.h"
+#include "MemoryMappedFile.h"
+#include "TraceLog.h"
+#include "ThreadPool.h"
+#include "OBJLoader.h"
+#include "extern/mzd/readMZD.h"
+#include "extern/happly/happly.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+using namespace Utilities;
+
+namespace
+{
+	/** Interleave the three scalar properties of type T into out with stride 3 or 4,
+	* the fourth component is set to 1. Returns false if one of them is missing.
+	*/
+	template<class T>
+	bool getVectors(happly::Element &element, const std::string &nameX, const std::string &nameY, const std::string &nameZ, std::vector<float> &out,
+		const size_t stride)
+	{
+		if (!element.hasPropertyType<T>(nameX) || !element.hasPropertyType<T>(nameY) || !element.hasPropertyType<T>(nameZ))
+			return false;
+
+		const std::vector<T> &x = element.getPropertyTypeRef<T>(nameX);
+		const std::vector<T> &y = element.getPropertyTypeRef<T>(nameY);
+		const std::vector<T> &z = element.getPropertyTypeRef<T>(nameZ);
+		out.resize(stride * x.size());
+		float *o = out.data();
+		ThreadPool::getInstance().parallelFor(0, x.size(), [&](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				o[stride * i] = (float)x[i];
+				o[stride * i + 1] = (float)y[i];
+				o[stride * i + 2] = (float)z[i];
+				if (stride == 4)
+					o[stride * i + 3] = 1.0f;
+			}
+		});
+		return true;
+	}
+
+	/** Interleave two scalar properties of type T into out. Returns false if one of them is missing. */
+	template<class T>
+	bool getPairs(happly::Element &element, const std::string &nameU, const std::string &nameV, std::vector<float> &out)
+	{
+		if (!element.hasPropertyType<T>(nameU) || !element.hasPropertyType<T>(nameV))
+			return false;
+
+		const std::vector<T> &u = element.getPropertyTypeRef<T>(nameU);
+		const std::vector<T> &v = element.getPropertyTypeRef<T>(nameV);
+		out.resize(2 * u.size());
+		for (size_t i = 0; i < u.size(); i++)
+		{
+			out[2 * i] = (float)u[i];
+			out[2 * i + 1] = (float)v[i];
+		}
+		return true;
+	}
+
+	/** Store an attribute with dim floats per value, which is indexed per polygon vertex by ids.
+	* If all polygon vertices of each vertex have equal values, one value per vertex is stored in
+	* out and ids is cleared. Otherwise out is a copy of the values and ids is kept as index array.
+	* Returns false if an index or a vertex index is out of range.
+	*/
+	bool storeAttribute(const std::vector<int> &connects, const int numVertices, const float *values, const int numValues, const int dim,
+		std::vector<float> &out, std::vector<int> &ids)
+	{
+		if (ids.size() != connects.size())
+			return false;
+		for (const int id : ids)
+			if ((id < 0) || (id >= numValues))
+				return false;
+
+		for (const int v : connects)
+			if ((v < 0) || (v >= numVertices))
+				return false;
+
+		std::vector<int> vertexIds(numVertices, -1);
+		bool perVertex = true;
+		for (size_t i = 0; perVertex && (i < connects.size()); i++)
+		{
+			int &current = vertexIds[connects[i]];
+			if (current < 0)
+				current = ids[i];
+			else if (current != ids[i])
+				perVertex = std::equal(values + dim * current, values + dim * (current + 1), values + dim * ids[i]);
+		}
+
+		if (perVertex)
+		{
+			// vertices without polygons get zeros
+			out.assign(dim * (size_t)numVertices, 0.0f);
+			for (int i = 0; i < numVertices; i++)
+				if (vertexIds[i] >= 0)
+					std::copy(values + dim * vertexIds[i], values + dim * (vertexIds[i] + 1), &out[dim * (size_t)i]);
+			std::vector<int>().swap(ids);
+		}
+		else
+			out.assign(values, values + dim * (size_t)numValues);
+		return true;
+	}
+
+	/** Store an attribute with dim floats per polygon vertex, values contains the value of
+	* each polygon vertex in the order of connects. If all polygon vertices of each vertex
+	* have equal values, one value per vertex is stored in out and ids is cleared. Otherwise
+	* the values are moved to out and ids is set to the index of each polygon vertex, so the
+	* attribute is face-varying without sharing equal values. Sharing them needs a hash of
+	* all values, which is left to the offline conversion, see MeshWriter::shareValues().
+	* Returns false if the number of values or a vertex index is wrong.
+	*/
+	bool storeNodeAttribute(const std::vector<int> &connects, const int numVertices, std::vector<float> &values, const int dim,
+		std::vector<float> &out, std::vector<int> &ids)
+	{
+		if (values.size() != (size_t)dim * connects.size())
+			return false;
+		for (const int v : connects)
+			if ((v < 0) || (v >= numVertices))
+				return false;
+
+		// index of the first polygon vertex of each vertex
+		std::vector<int> vertexNodes(numVertices, -1);
+		const float *p = values.data();
+		bool perVertex = true;
+		for (size_t i = 0; perVertex && (i < connects.size()); i++)
+		{
+			int &first = vertexNodes[connects[i]];
+			if (first < 0)
+				first = (int)i;
+			else
+				perVertex = std::equal(p + dim * (size_t)first, p + dim * ((size_t)first + 1), p + dim * i);
+		}
+
+		if (perVertex)
+		{
+			// vertices without polygons get zeros
+			out.assign(dim * (size_t)numVertices, 0.0f);
+			for (int i = 0; i < numVertices; i++)
+				if (vertexNodes[i] >= 0)
+					std::copy(p + dim * (size_t)vertexNodes[i], p + dim * ((size_t)vertexNodes[i] + 1), &out[dim * (size_t)i]);
+			std::vector<int>().swap(ids);
+		}
+		else
+		{
+			out.swap(values);
+			ids.resize(connects.size());
+			int *id = ids.data();
+			ThreadPool::getInstance().parallelFor(0, ids.size(), [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					id[i] = (int)i;
+			});
+		}
+		return true;
+	}
+
+	/** Convert interleaved (u, v) pairs to all u values followed by all v values. */
+	void splitUVs(std::vector<float> &uvs)
+	{
+		const size_t n = uvs.size() / 2;
+		std::vector<float> split(2 * n);
+		for (size_t i = 0; i < n; i++)
+		{
+			split[i] = uvs[2 * i];
+			split[n + i] = uvs[2 * i + 1];
+		}
+		uvs.swap(split);
+	}
+
+	/** Convert n packed positions (x, y, z) to (x, y, z, 1). */
+	void expandPositions(const float *packed, const size_t n, std::vector<float> &p)
+	{
+		p.resize(4 * n);
+		float *out = p.data();
+		ThreadPool::getInstance().parallelFor(0, n, [&](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				out[4 * i] = packed[3 * i];
+				out[4 * i + 1] = packed[3 * i + 1];
+				out[4 * i + 2] = packed[3 * i + 2];
+				out[4 * i + 3] = 1.0f;
+			}
+		});
+	}
+}
+
+bool MeshReader::read(const std::string &fileName, const bool positionsOnly, MeshData &mesh, std::string &error, const bool measureRead)
+{
+	mesh.clear();
+	const std::string fileExt = getFormat(fileName);
+	if (!isSupported(fileExt))
+	{
+		error = "Error: unknown file type " + fileExt;
+		return false;
+	}
+
+	const long long readStart = TraceLog::now();
+	MemoryMappedFile file;
+	if (!file.open(fileName))
+	{
+		error = "Error: unable to open file " + fileName;
+		return false;
+	}
+	// touching the pages separates the file access from the parsing, but the parser cannot overlap with the readahead
+	if (measureRead)
+		file.touch();
+	const long long parseStart = TraceLog::now();
+	if (!readFromMemory(fileExt, file.data(), file.size(), positionsOnly, mesh, error))
+		return false;
+
+	mesh.loadStatistics.fileBytes = file.size();
+	mesh.loadStatistics.readStart = readStart;
+	mesh.loadStatistics.readDuration = parseStart - readStart;
+	mesh.loadStatistics.parseDuration = TraceLog::now() - parseStart;
+	mesh.loadStatistics.threadId = TraceLog::currentThreadId();
+	return true;
+}
+
+bool MeshReader::readFromMemory(const std::string &fileExt, const char *data, const size_t size, const bool positionsOnly, MeshData &mesh, std::string &error,
+	const unsigned int numThreads)
+{
+	bool ok = false;
+	if (fileExt == "MZD")
+		ok = readMZD(data, size, positionsOnly, mesh, error);
+	else if (fileExt == "PLY")
+		ok = readPLY(data, size, positionsOnly, mesh, error);
+	else if (fileExt == "OBJ")
+		ok = readOBJ(data, size, positionsOnly, mesh, error, numThreads);
+	else if (fileExt == "MTC")
+		ok = MeshCacheFile::readFromMemory(data, size, positionsOnly, mesh, error);
+	else
+		error = "Error: unknown file type " + fileExt;
+
+	// hashed here, so that it is done on the loading thread. Cache files
+	// already store the hash.
+	if (ok && (mesh.topologyHash == 0))
+		mesh.topologyHash = mesh.computeTopologyHash();
+	return ok;
+}
+
+std::string MeshReader::getFormat(const std::string &fileName)
+{
+	std::string fileExt = FileSystem::getFileExt(fileName);
+	std::transform(fileExt.begin(), fileExt.end(), fileExt.begin(), ::toupper);
+	return fileExt;
+}
+
+bool MeshReader::isSupported(const std::string &fileExt)
+{
+	return (fileExt == "MZD") || (fileExt == "PLY") || (fileExt == "OBJ") || (fileExt == "MTC");
+}
+
+bool MeshReader::readMZD(const char *data, const size_t size, const bool positionsOnly, MeshData &mesh, std::string &error)
+{
+	mesh.clear();
+
+	// scan the chunk table first, so that only the arrays used by the mesh are
+	// allocated. They are decoded directly into these arrays, all other chunks
+	// (motion vectors, polygon node colors) are skipped. Polygon node normals
+	// and UVWs are preferred to the vertex ones. In positions only mode just the
+	// vertex chunk is read.
+	MZDInfo info;
+	int ret = readMZDInfoFromMemory(data, size, info);
+	if (ret == 0)
+	{
+		MZDBuffers buffers = {};
+		std::vector<float> positions;
+		std::vector<float> nodeNormals;
+		std::vector<float> uvws;
+		bool nodeUVWs = false;
+		try
+		{
+			// the packed positions are expanded afterwards, which unlike an in place expansion can run in parallel
+			positions.resize(3 * (size_t)info.numVertices);
+			mesh.counts.resize(info.numPolygons);
+			mesh.connects.resize(info.numNodes);
+			buffers.vertPositions = positions.data();
+			buffers.polyVIndicesNum = mesh.counts.data();
+			buffers.polyVIndices = mesh.connects.data();
+			bool hasNodeNormals = false;
+			for (int i = 0; (i < info.numChunks) && !positionsOnly; i++)
+			{
+				hasNodeNormals = hasNodeNormals || (info.chunks[i].id == 0xDA7A0011);
+				nodeUVWs = nodeUVWs || (info.chunks[i].id == 0xDA7A0014);
+			}
+			for (int i = 0; (i < info.numChunks) && !positionsOnly; i++)
+			{
+				if ((info.chunks[i].id == 0xDA7A0001) && !hasNodeNormals)
+				{
+					mesh.normals.resize(3 * (size_t)info.numVertices);
+					buffers.vertNormals = mesh.normals.data();
+				}
+				else if (info.chunks[i].id == 0xDA7A0011)
+				{
+					nodeNormals.resize(3 * (size_t)info.numNodes);
+					buffers.nodeNormals = nodeNormals.data();
+				}
+				else if (info.chunks[i].id == 0xDA7A0003)
+				{
+					mesh.colors.resize(4 * (size_t)info.numVertices);
+					buffers.vertColors = mesh.colors.data();
+				}
+				else if ((info.chunks[i].id == 0xDA7A0004) && !nodeUVWs)
+				{
+					uvws.resize(3 * (size_t)info.numVertices);
+					buffers.vertUVWs = uvws.data();
+				}
+				else if (info.chunks[i].id == 0xDA7A0014)
+				{
+					uvws.resize(3 * (size_t)info.numNodes);
+					buffers.nodeUVWs = uvws.data();
+				}
+			}
+			ret = readMZDDataFromMemory(data, size, info, buffers);
+			if (ret == 0)
+			{
+				expandPositions(positions.data(), info.numVertices, mesh.positions);
+
+				// node normals and UVs are stored per vertex if possible
+				if (!nodeNormals.empty())
+				{
+					if (!storeNodeAttribute(mesh.connects, info.numVertices, nodeNormals, 3, mesh.normals, mesh.normalIds))
+						ret = -4;
+				}
+				if (!uvws.empty())
+				{
+					for (size_t i = 0; i < uvws.size() / 3; i++)
+					{
+						uvws[2 * i] = uvws[3 * i];
+						uvws[2 * i + 1] = uvws[3 * i + 1];
+					}
+					uvws.resize(2 * (uvws.size() / 3));
+					if (nodeUVWs)
+					{
+						if (!storeNodeAttribute(mesh.connects, info.numVertices, uvws, 2, mesh.uvs, mesh.uvIds))
+							ret = -4;
+					}
+					else
+						mesh.uvs.swap(uvws);
+					splitUVs(mesh.uvs);
+				}
+			}
+		}
+		catch (const std::bad_alloc &)
+		{
+			ret = -3;
+		}
+	}
+	switch (ret)
+	{
+		case 0:     return true;  // success
+		case -1:    error = "Error: unable to open file."; break;
+		case -2:    error = "Error: read error."; break;
+		case -3:    error = "Error: failed to allocate memory."; break;
+		case -4:    error = "Error: wrong file format."; break;
+		case -5:    error = "Error: illegal parameter value."; break;
+		default:    error = "Error: unkown error."; break;
+	}
+	mesh.clear();
+	return false;
+}
+
+bool MeshReader::readPLY(const char *data, const size_t size, const bool positionsOnly, MeshData &mesh, std::string &error)
+{
+	mesh.clear();
+	// an empty file has no header, but is treated as an empty mesh like an empty OBJ file
+	if (size == 0)
+		return true;
+	try
+	{
+		happly::PLYData plyIn(data, size);
+		happly::Element &element = plyIn.getElement("vertex");
+
+		// vertices
+		if (!getVectors<float>(element, "x", "y", "z", mesh.positions, 4) &&
+			!getVectors<double>(element, "x", "y", "z", mesh.positions, 4))
+		{
+			error = "Error: no vertex positions in file.";
+			return false;
+		}
+
+		if (!positionsOnly)
+		{
+			// normals
+			if (!getVectors<float>(element, "nx", "ny", "nz", mesh.normals, 3))
+				getVectors<double>(element, "nx", "ny", "nz", mesh.normals, 3);
+
+			// vertex colors
+			if ((element.hasPropertyType<unsigned char>("red")) &&
+				(element.hasPropertyType<unsigned char>("green")) &&
+				(element.hasPropertyType<unsigned char>("blue")))
+			{
+				const std::vector<unsigned char> &r = element.getPropertyTypeRef<unsigned char>("red");
+				const std::vector<unsigned char> &g = element.getPropertyTypeRef<unsigned char>("green");
+				const std::vector<unsigned char> &b = element.getPropertyTypeRef<unsigned char>("blue");
+
+				mesh.colors.resize(4 * r.size());
+				float *c = mesh.colors.data();
+				ThreadPool::getInstance().parallelFor(0, r.size(), [&](const size_t begin, const size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						c[4 * i] = (float)r[i] / 255.0f;
+						c[4 * i + 1] = (float)g[i] / 255.0f;
+						c[4 * i + 2] = (float)b[i] / 255.0f;
+						c[4 * i + 3] = 1.0f;
+					}
+				});
+			}
+
+			// UVs per vertex with one of the common property names
+			const char *uvNames[][2] = { { "u", "v" }, { "s", "t" }, { "texture_u", "texture_v" }, { "texture_s", "texture_t" } };
+			for (const auto &names : uvNames)
+				if (getPairs<float>(element, names[0], names[1], mesh.uvs) || getPairs<double>(element, names[0], names[1], mesh.uvs))
+					break;
+		}
+
+		// faces
+		plyIn.getFaceIndicesFlat(mesh.counts, mesh.connects);
+
+		// UVs per polygon vertex as list of (u, v) pairs of each face
+		happly::Element &faces = plyIn.getElement("face");
+		if (!positionsOnly && mesh.uvs.empty() && faces.hasProperty("texcoord"))
+		{
+			std::vector<int> texCounts;
+			std::vector<float> uvs;
+			try
+			{
+				faces.getListPropertyTypeFlat<float>("texcoord", texCounts, uvs);
+			}
+			catch (const std::runtime_error &)
+			{
+				// not a list of floats, the UVs are ignored
+				texCounts.clear();
+			}
+			bool valid = !texCounts.empty() && (texCounts.size() == mesh.counts.size());
+			for (size_t i = 0; valid && (i < texCounts.size()); i++)
+				valid = texCounts[i] == 2 * mesh.counts[i];
+			if (valid)
+			{
+				if (!storeNodeAttribute(mesh.connects, mesh.numVertices(), uvs, 2, mesh.uvs, mesh.uvIds))
+					mesh.uvIds.clear();
+			}
+		}
+		splitUVs(mesh.uvs);
+	}
+	catch (const std::exception & e)
+	{
+		error = std::string("Exception: ") + e.what();
+		mesh.clear();
+		return false;
+	}
+	return true;
+}
+
+bool MeshReader::readOBJ(const char *data, const size_t size, const bool positionsOnly, MeshData &mesh, std::string &error, unsigned int numThreads)
+{
+	mesh.clear();
+	if (numThreads == 0)
+		numThreads = ThreadPool::getInstance().getNumThreads();
+
+	std::vector<OBJLoader::Vec3f> x;
+	std::vector<OBJLoader::Vec3f> normals;
+	std::vector<OBJLoader::Vec2f> texcoords;
+	ObjFaces faces;
+	OBJLoader::Vec3f s = { 1.0f, 1.0f, 1.0f };
+	OBJLoader::loadObjFromMemory(data, data + size, &x, &faces, positionsOnly ? nullptr : &normals, positionsOnly ? nullptr : &texcoords, s, numThreads);
+	static_assert((sizeof(OBJLoader::Vec3f) == 3 * sizeof(float)) && (sizeof(OBJLoader::Vec2f) == 2 * sizeof(float)), "the vectors are accessed as float arrays");
+
+	const int numVertices = (int)x.size();
+	for (const int index : faces.posIndices)
+	{
+		if ((index < 0) || (index >= numVertices))
+		{
+			error = "Error: invalid vertex index in OBJ file";
+			return false;
+		}
+	}
+
+	expandPositions(x.empty() ? nullptr : x[0].data(), x.size(), mesh.positions);
+
+	// faces: the flat arrays already have the layout of the Maya mesh
+	mesh.counts.swap(faces.counts);
+	mesh.connects.swap(faces.posIndices);
+
+	// normals and UVs are indexed per polygon vertex, they are stored per vertex if possible.
+	// If a polygon vertex has no index, the attribute is not used.
+	if (!normals.empty())
+	{
+		mesh.normalIds.swap(faces.normalIndices);
+		if (!storeAttribute(mesh.connects, numVertices, normals[0].data(), (int)normals.size(), 3, mesh.normals, mesh.normalIds))
+		{
+			mesh.normals.clear();
+			mesh.normalIds.clear();
+		}
+	}
+	if (!texcoords.empty())
+	{
+		mesh.uvIds.swap(faces.texIndices);
+		if (storeAttribute(mesh.connects, numVertices, texcoords[0].data(), (int)texcoords.size(), 2, mesh.uvs, mesh.uvIds))
+			splitUVs(mesh.uvs);
+		else
+		{
+			mesh.uvs.clear();
+			mesh.uvIds.clear();
+		}
+	}
+	return true;
+}
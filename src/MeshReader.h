@@ -0,0 +1,46 @@
+#ifndef __MeshReader_h__
+#define __MeshReader_h__
+
+#include "MeshData.h"
+#include <string>
+#include <cstddef>
+
+namespace Utilities
+{
+	/** \brief Reads MZD, PLY, OBJ and MTC files into a MeshData object.
+	* The readers do not use the Maya API, so they can run on any thread. Errors
+	* are returned as message instead of being displayed. The conversion loops
+	* run on the shared ThreadPool.
+	*/
+	class MeshReader
+	{
+	public:
+		/** Read a mesh file, the format is determined by the file extension.
+		* If positionsOnly is set, normals and colors are not read. The topology
+		* hash of the mesh is computed as well. If measureRead is set, all pages of
+		* the file are read before parsing, so that the read and parse times of the
+		* load statistics are measured separately. Otherwise the file is read by the
+		* parser behind the readahead of the system and the parse time includes the
+		* reading.
+		*/
+		static bool read(const std::string &fileName, const bool positionsOnly, MeshData &mesh, std::string &error, const bool measureRead = false);
+
+		/** Read a mesh from the contents of a file in memory. fileExt is the upper
+		* case file extension, see getFormat(). Large OBJ files are parsed by
+		* numThreads threads (0 = number of threads of the shared ThreadPool).
+		*/
+		static bool readFromMemory(const std::string &fileExt, const char *data, const size_t size, const bool positionsOnly, MeshData &mesh, std::string &error,
+			const unsigned int numThreads = 0);
+
+		/** Upper case file extension of a file name. */
+		static std::string getFormat(const std::string &fileName);
+
+		static bool isSupported(const std::string &fileExt);
+
+		static bool readMZD(const char *data, const size_t size, const bool positionsOnly, MeshData &mesh, std::string &error);
+		static bool readPLY(const char *data, const size_t size, const bool positionsOnly, MeshData &mesh, std::string &error);
+		static bool readOBJ(const char *data, const size_t size, const bool positionsOnly, MeshData &mesh, std::string &error, const unsigned int numThreads = 0);
+	};
+}
+
+#endif
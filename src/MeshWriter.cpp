@@ -0,0 +1,347 @@
+#include "MeshWriter.h"
+#include "MeshCacheFile.h"
+#include "FileSystem.h"
+#include "extern/mzd/writeMZD.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace Utilities;
+
+namespace
+{
+	template<class T>
+	void put(char *&p, const T value)
+	{
+		memcpy(p, &value, sizeof(T));
+		p += sizeof(T);
+	}
+
+	void putText(std::vector<char> &data, const char *text)
+	{
+		data.insert(data.end(), text, text + strlen(text));
+	}
+
+	/** Hash and equality of the values with dim floats at an index of an array, used to find
+	* equal values. Component k of value i is stored at values[i * valueStride + k * componentStride].
+	*/
+	struct ValueHash
+	{
+		const float *values;
+		int dim;
+		size_t valueStride;
+		size_t componentStride;
+
+		size_t operator()(const int i) const
+		{
+			size_t h = 14695981039346656037ULL;
+			for (int k = 0; k < dim; k++)
+			{
+				uint32_t bits;
+				memcpy(&bits, &values[i * valueStride + k * componentStride], sizeof(bits));
+				h = (h ^ bits) * 1099511628211ULL;
+			}
+			return h;
+		}
+		bool operator()(const int a, const int b) const
+		{
+			for (int k = 0; k < dim; k++)
+				if (memcmp(&values[a * valueStride + k * componentStride], &values[b * valueStride + k * componentStride], sizeof(float)) != 0)
+					return false;
+			return true;
+		}
+	};
+
+	/** Remove duplicates of the values with dim floats and map ids to the shared values.
+	* The values are interleaved or, if split is set, all first components are followed by
+	* all second components and so on.
+	*/
+	void shareValues(std::vector<float> &values, const int dim, const bool split, std::vector<int> &ids)
+	{
+		const size_t n = values.size() / dim;
+		const ValueHash hash = { values.data(), dim, split ? 1 : (size_t)dim, split ? n : 1 };
+		std::unordered_map<int, int, ValueHash, ValueHash> index(n, hash, hash);
+		std::vector<int> sharedIds(n);
+		size_t numShared = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			// the keys are indices of the first occurrences in the unchanged values
+			const std::pair<std::unordered_map<int, int, ValueHash, ValueHash>::iterator, bool> it = index.insert(std::make_pair((int)i, (int)numShared));
+			if (it.second)
+				numShared++;
+			sharedIds[i] = it.first->second;
+		}
+
+		// compacted afterwards, since the keys refer to the original positions
+		const size_t valueStride = split ? 1 : (size_t)dim;
+		const size_t componentStride = split ? numShared : 1;
+		std::vector<float> shared(dim * numShared);
+		for (size_t i = 0; i < n; i++)
+			for (int k = 0; k < dim; k++)
+				shared[sharedIds[i] * valueStride + k * componentStride] = values[i * hash.valueStride + k * hash.componentStride];
+		values.swap(shared);
+		for (int &id : ids)
+			id = sharedIds[id];
+	}
+
+	/** UV index of polygon vertex i, the vertex index for per-vertex UVs */
+	inline int uvId(const MeshData &mesh, const size_t i)
+	{
+		return mesh.uvIds.empty() ? mesh.connects[i] : mesh.uvIds[i];
+	}
+
+	void encodePLY(const MeshData &mesh, std::vector<char> &data)
+	{
+		// face-varying normals are not stored, since PLY has no standard for them.
+		// Face-varying UVs are stored as texcoord list of the faces as by MeshLab.
+		const int n = mesh.numVertices();
+		const bool normals = mesh.hasNormals();
+		const bool colors = mesh.hasColors();
+		const bool vertexUVs = mesh.hasUVs() && mesh.uvIds.empty();
+		const bool faceUVs = mesh.hasUVs() && !mesh.uvIds.empty();
+		const int numUVs = mesh.numUVs();
+		const int maxCount = mesh.counts.empty() ? 0 : *std::max_element(mesh.counts.begin(), mesh.counts.end());
+		const bool byteCounts = maxCount <= 255;
+		const bool byteUVCounts = 2 * maxCount <= 255;
+
+		std::string header = "ply\nformat binary_little_endian 1.0\nelement vertex " + std::to_string(n) +
+			"\nproperty float x\nproperty float y\nproperty float z\n";
+		if (normals)
+			header += "property float nx\nproperty float ny\nproperty float nz\n";
+		if (colors)
+			header += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+		if (vertexUVs)
+			header += "property float s\nproperty float t\n";
+		header += "element face " + std::to_string(mesh.numPolygons()) +
+			(byteCounts ? "\nproperty list uchar int vertex_indices\n" : "\nproperty list int int vertex_indices\n");
+		if (faceUVs)
+			header += byteUVCounts ? "property list uchar float texcoord\n" : "property list int float texcoord\n";
+		header += "end_header\n";
+
+		// the size is known in advance, so the values are copied into the final buffer
+		const size_t vertexSize = 3 * sizeof(float) + (normals ? 3 * sizeof(float) : 0) + (colors ? 3 : 0) + (vertexUVs ? 2 * sizeof(float) : 0);
+		const size_t countSize = byteCounts ? 1 : sizeof(int32_t);
+		const size_t uvSize = faceUVs ? mesh.counts.size() * (byteUVCounts ? 1 : sizeof(int32_t)) + mesh.connects.size() * 2 * sizeof(float) : 0;
+		data.resize(header.size() + n * vertexSize + mesh.counts.size() * countSize + mesh.connects.size() * sizeof(int32_t) + uvSize);
+		char *p = data.data();
+		memcpy(p, header.data(), header.size());
+		p += header.size();
+		for (int i = 0; i < n; i++)
+		{
+			for (int k = 0; k < 3; k++)
+				put(p, mesh.positions[4 * i + k]);
+			if (normals)
+				for (int k = 0; k < 3; k++)
+					put(p, mesh.normals[3 * i + k]);
+			if (colors)
+				for (int k = 0; k < 3; k++)
+					put(p, (unsigned char)lroundf(255.0f * std::min(std::max(mesh.colors[4 * i + k], 0.0f), 1.0f)));
+			if (vertexUVs)
+			{
+				put(p, mesh.uvs[i]);
+				put(p, mesh.uvs[numUVs + i]);
+			}
+		}
+		size_t index = 0;
+		for (int count : mesh.counts)
+		{
+			if (byteCounts)
+				put(p, (unsigned char)count);
+			else
+				put(p, (int32_t)count);
+			for (int k = 0; k < count; k++)
+				put(p, (int32_t)mesh.connects[index + k]);
+			if (faceUVs)
+			{
+				if (byteUVCounts)
+					put(p, (unsigned char)(2 * count));
+				else
+					put(p, (int32_t)(2 * count));
+				for (int k = 0; k < count; k++)
+				{
+					const int uv = mesh.uvIds[index + k];
+					put(p, mesh.uvs[uv]);
+					put(p, mesh.uvs[numUVs + uv]);
+				}
+			}
+			index += count;
+		}
+	}
+
+	void encodeOBJ(const MeshData &mesh, std::vector<char> &data)
+	{
+		// colors are not stored, since OBJ has no standard for vertex colors
+		const int n = mesh.numVertices();
+		const bool normals = mesh.hasNormals() || mesh.hasFaceVaryingNormals();
+		const bool uvs = mesh.hasUVs();
+		const int numUVs = mesh.numUVs();
+		char line[128];
+		for (int i = 0; i < n; i++)
+		{
+			snprintf(line, sizeof(line), "v %.9g %.9g %.9g\n", mesh.positions[4 * i], mesh.positions[4 * i + 1], mesh.positions[4 * i + 2]);
+			putText(data, line);
+		}
+		if (uvs)
+		{
+			for (int i = 0; i < numUVs; i++)
+			{
+				snprintf(line, sizeof(line), "vt %.9g %.9g\n", mesh.uvs[i], mesh.uvs[numUVs + i]);
+				putText(data, line);
+			}
+		}
+		if (normals)
+		{
+			for (size_t i = 0; i < mesh.normals.size() / 3; i++)
+			{
+				snprintf(line, sizeof(line), "vn %.9g %.9g %.9g\n", mesh.normals[3 * i], mesh.normals[3 * i + 1], mesh.normals[3 * i + 2]);
+				putText(data, line);
+			}
+		}
+		size_t index = 0;
+		for (int count : mesh.counts)
+		{
+			putText(data, "f");
+			for (int k = 0; k < count; k++, index++)
+			{
+				const int v = mesh.connects[index] + 1;
+				const int vn = (mesh.normalIds.empty() ? mesh.connects[index] : mesh.normalIds[index]) + 1;
+				if (uvs && normals)
+					snprintf(line, sizeof(line), " %d/%d/%d", v, uvId(mesh, index) + 1, vn);
+				else if (uvs)
+					snprintf(line, sizeof(line), " %d/%d", v, uvId(mesh, index) + 1);
+				else if (normals)
+					snprintf(line, sizeof(line), " %d//%d", v, vn);
+				else
+					snprintf(line, sizeof(line), " %d", v);
+				putText(data, line);
+			}
+			putText(data, "\n");
+		}
+	}
+}
+
+bool MeshWriter::write(const std::string &fileName, const MeshData &mesh, std::string &error)
+{
+	const std::string fileExt = getFormat(fileName);
+	if (fileExt == "MZD")
+		return writeMZDFile(fileName, mesh, error);
+
+	std::vector<char> data;
+	if (!encode(fileExt, mesh, data, error))
+		return false;
+	return writeFile(fileName, data, error);
+}
+
+void MeshWriter::shareValues(MeshData &mesh)
+{
+	if (mesh.hasFaceVaryingNormals())
+		::shareValues(mesh.normals, 3, false, mesh.normalIds);
+	if (mesh.hasUVs() && !mesh.uvIds.empty())
+		::shareValues(mesh.uvs, 2, true, mesh.uvIds);
+}
+
+std::string MeshWriter::getFormat(const std::string &fileName)
+{
+	std::string fileExt = FileSystem::getFileExt(fileName);
+	std::transform(fileExt.begin(), fileExt.end(), fileExt.begin(), ::toupper);
+	return fileExt;
+}
+
+bool MeshWriter::isSupported(const std::string &fileExt)
+{
+	return canEncode(fileExt) || (fileExt == "MZD");
+}
+
+bool MeshWriter::canEncode(const std::string &fileExt)
+{
+	return (fileExt == "MTC") || (fileExt == "PLY") || (fileExt == "OBJ");
+}
+
+bool MeshWriter::encode(const std::string &fileExt, const MeshData &mesh, std::vector<char> &data, std::string &error)
+{
+	data.clear();
+	if (fileExt == "MTC")
+		MeshCacheFile::encode(mesh, data);
+	else if (fileExt == "PLY")
+		encodePLY(mesh, data);
+	else if (fileExt == "OBJ")
+		encodeOBJ(mesh, data);
+	else
+	{
+		error = "Error: unsupported output format " + fileExt;
+		return false;
+	}
+	return true;
+}
+
+bool MeshWriter::writeFile(const std::string &fileName, const std::vector<char> &data, std::string &error)
+{
+	FILE *file = fopen(fileName.c_str(), "wb");
+	if (!file)
+	{
+		error = "Error: unable to open file " + fileName;
+		return false;
+	}
+	bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+	ok = (fclose(file) == 0) && ok;
+	if (!ok)
+		error = "Error: unable to write file " + fileName;
+	return ok;
+}
+
+bool MeshWriter::writeMZDFile(const std::string &fileName, const MeshData &mesh, std::string &error)
+{
+	const int n = mesh.numVertices();
+	std::vector<float> x(3 * (size_t)n);
+	for (int i = 0; i < n; i++)
+		for (int k = 0; k < 3; k++)
+			x[3 * i + k] = mesh.positions[4 * i + k];
+
+	// MZD stores the vertex count of a polygon in one byte
+	std::vector<unsigned char> counts(mesh.counts.size());
+	for (size_t i = 0; i < mesh.counts.size(); i++)
+	{
+		if ((mesh.counts[i] < 0) || (mesh.counts[i] > 255))
+		{
+			error = "Error: MZD files support at most 255 vertices per polygon.";
+			return false;
+		}
+		counts[i] = (unsigned char)mesh.counts[i];
+	}
+
+	// UVs are stored as UVWs with w = 0, face-varying attributes per polygon node
+	std::vector<float> uvws;
+	std::vector<float> nodeNormals;
+	const int numUVs = mesh.numUVs();
+	if (mesh.hasUVs())
+	{
+		const size_t num = mesh.uvIds.empty() ? (size_t)n : mesh.uvIds.size();
+		uvws.resize(3 * num);
+		for (size_t i = 0; i < num; i++)
+		{
+			const int uv = mesh.uvIds.empty() ? (int)i : mesh.uvIds[i];
+			uvws[3 * i] = mesh.uvs[uv];
+			uvws[3 * i + 1] = mesh.uvs[numUVs + uv];
+			uvws[3 * i + 2] = 0.0f;
+		}
+	}
+	if (mesh.hasFaceVaryingNormals())
+	{
+		nodeNormals.resize(3 * mesh.normalIds.size());
+		for (size_t i = 0; i < mesh.normalIds.size(); i++)
+			for (int k = 0; k < 3; k++)
+				nodeNormals[3 * i + k] = mesh.normals[3 * mesh.normalIds[i] + k];
+	}
+	const bool vertexUVs = !uvws.empty() && mesh.uvIds.empty();
+	const bool nodeUVs = !uvws.empty() && !mesh.uvIds.empty();
+
+	const int ret = writeMZD(fileName.c_str(), n, mesh.numPolygons(), x.data(), counts.data(), mesh.connects.data(),
+		mesh.hasNormals() ? mesh.normals.data() : NULL, NULL, mesh.hasColors() ? mesh.colors.data() : NULL,
+		vertexUVs ? uvws.data() : NULL, nodeNormals.empty() ? NULL : nodeNormals.data(), NULL, nodeUVs ? uvws.data() : NULL);
+	if (ret != 0)
+		error = "Error: unable to write file " + fileName;
+	return ret == 0;
+}
@@ -0,0 +1,47 @@
+#ifndef __MeshWriter_h__
+#define __MeshWriter_h__
+
+#include "MeshData.h"
+#include <string>
+#include <vector>
+
+namespace Utilities
+{
+	/** \brief Writes a MeshData object as MTC, PLY, OBJ or MZD file, counterpart of MeshReader.
+	* MTC, PLY (binary little endian) and OBJ files are encoded in memory by
+	* encode(), so that encoding and writing can be done on different threads.
+	* MZD files are written directly by writeMZD(). Errors are returned as message.
+	* OBJ files do not store colors and PLY files no face-varying normals.
+	*/
+	class MeshWriter
+	{
+	public:
+		/** Write a mesh file, the format is determined by the file extension. */
+		static bool write(const std::string &fileName, const MeshData &mesh, std::string &error);
+
+		/** Upper case file extension of a file name. */
+		static std::string getFormat(const std::string &fileName);
+
+		static bool isSupported(const std::string &fileExt);
+
+		/** True if encode() supports the format. */
+		static bool canEncode(const std::string &fileExt);
+
+		/** Store a mesh in the file format given by the upper case extension in data. */
+		static bool encode(const std::string &fileExt, const MeshData &mesh, std::vector<char> &data, std::string &error);
+
+		/** Write the encoded data of a file. */
+		static bool writeFile(const std::string &fileName, const std::vector<char> &data, std::string &error);
+
+		static bool writeMZDFile(const std::string &fileName, const MeshData &mesh, std::string &error);
+
+		/** Remove duplicates of face-varying normals and UVs, so that the index
+		* arrays refer to one copy of each value. The readers keep one value per
+		* polygon vertex, since hashing all values takes longer than reading the
+		* frame. Meant for offline conversions, e.g. before writing MTC or OBJ files.
+		*/
+		static void shareValues(MeshData &mesh);
+	};
+}
+
+#endif
@@ -2,21 +2,42 @@
 #define __OBJLoader_h__
 
 #include <string>
-#include "StringTools.h"
+#include <vector>
 #include <array>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include "MemoryMappedFile.h"
 
 namespace Utilities
 {
-	/** \brief Struct to store the position and normal indices
+	/** \brief Faces of an OBJ file with any number of vertices as flat arrays in the
+	* layout of MFnMesh::create(): the number of vertices of each face and the zero
+	* based indices of all face vertices, relative indices are resolved. The texture
+	* coordinate and normal indices contain one entry per face vertex, -1 if the
+	* face vertex has none. They are empty if the texture coordinates or normals
+	* are not read.
 	*/
-	struct MeshFaceIndices
+	struct ObjFaces
 	{
-		int posIndices[3];
-		int texIndices[3];
-		int normalIndices[3];
+		std::vector<int> counts;
+		std::vector<int> posIndices;
+		std::vector<int> texIndices;
+		std::vector<int> normalIndices;
+
+		void clear()
+		{
+			counts.clear();
+			posIndices.clear();
+			texIndices.clear();
+			normalIndices.clear();
+		}
 	};
 
-	/** \brief Read for OBJ files. 
+	/** \brief Read for OBJ files.
 	*/
 	class OBJLoader
 	{
@@ -24,144 +45,450 @@ namespace Utilities
 		using Vec3f = std::array<float, 3>;
 		using Vec2f = std::array<float, 2>;
 
-		/** This function loads an OBJ file.
-		  * Only triangulated meshes are supported.
-		  */
+		/** Files smaller than this are always parsed on the calling thread. */
+		static const size_t PARALLEL_MIN_FILE_SIZE = 4 * 1024 * 1024;
 
-		static void loadObj(const std::string &filename, std::vector<Vec3f> *x, std::vector<MeshFaceIndices> *faces, std::vector<Vec3f> *normals, std::vector<Vec2f> *texcoords, const Vec3f &scale)
+		/** This function loads an OBJ file with polygons of any size. The arrays are overwritten.
+		  * Large files are parsed by numThreads worker threads (0 = number of hardware threads).
+		  * Returns false if the file cannot be opened.
+		  */
+		static bool loadObj(const std::string &filename, std::vector<Vec3f> *x, ObjFaces *faces, std::vector<Vec3f> *normals, std::vector<Vec2f> *texcoords, const Vec3f &scale,
+			unsigned int numThreads = 0)
 		{
-			//std::cout << "Loading " << filename << "\n";
-			
-			std::ifstream filestream;
-			filestream.open(filename.c_str());
-			if (filestream.fail())
+			MemoryMappedFile file;
+			if (!file.open(filename))
 			{
 				std::cerr << "Failed to open file: " << filename << "\n";
-				return;
+				return false;
 			}
 
-			std::string line_stream;
-			bool vt = false;
-			bool vn = false;
+			loadObjFromMemory(file.data(), file.end(), x, faces, normals, texcoords, scale, numThreads);
+			return true;
+		}
+
+		/** This function loads the contents of an OBJ file with polygons of any size in the buffer [begin, end).
+		  * The arrays are overwritten. Large buffers are parsed by numThreads worker threads (0 = number of hardware threads).
+		  */
+		static void loadObjFromMemory(const char *begin, const char *end, std::vector<Vec3f> *x, ObjFaces *faces, std::vector<Vec3f> *normals, std::vector<Vec2f> *texcoords, const Vec3f &scale,
+			unsigned int numThreads = 0)
+		{
+			if (numThreads == 0)
+				numThreads = std::thread::hardware_concurrency();
+			if ((numThreads > 1) && ((size_t)(end - begin) >= PARALLEL_MIN_FILE_SIZE))
+				parseObjPolygonsParallel(begin, end, x, faces, normals, texcoords, scale, numThreads);
+			else
+				parseObjPolygons(begin, end, x, faces, normals, texcoords, scale);
+		}
+
+		/** Parse OBJ data with polygons of any size in the buffer [begin, end), the arrays are overwritten.
+		  * Every face vertex can have any of the forms v, v/vt, v//vn and v/vt/vn, independent of
+		  * the other vertices. Faces with less than three vertices are skipped.
+		  */
+		static void parseObjPolygons(const char *begin, const char *end, std::vector<Vec3f> *x, ObjFaces *faces, std::vector<Vec3f> *normals, std::vector<Vec2f> *texcoords, const Vec3f &scale)
+		{
+			x->clear();
+			faces->clear();
+			if (normals != nullptr)
+				normals->clear();
+			if (texcoords != nullptr)
+				texcoords->clear();
+			// relative indices are already final, since the chunk starts at the beginning of the file
+			PolygonChunkInfo info;
+			parsePolygonChunk(begin, end, x, faces, normals, texcoords, scale, info);
+		}
 
-			std::vector<std::string> pos_buffer;
-			std::vector<std::string> f_buffer;
+		/** Parse OBJ data with polygons of any size in the buffer [begin, end) with multiple threads.
+		  * The buffer is split into chunks at line boundaries, each chunk is parsed by a worker thread
+		  * and the per-chunk arrays are concatenated afterwards. The result is identical to parseObjPolygons().
+		  */
+		static void parseObjPolygonsParallel(const char *begin, const char *end, std::vector<Vec3f> *x, ObjFaces *faces, std::vector<Vec3f> *normals, std::vector<Vec2f> *texcoords, const Vec3f &scale,
+			const unsigned int numThreads)
+		{
+			const size_t size = (size_t)(end - begin);
+			const unsigned int numChunks = (unsigned int) std::max<size_t>(1, std::min<size_t>(numThreads, size / 4096));
 
-			while (getline(filestream, line_stream))
+			std::vector<const char *> bounds(numChunks + 1);
+			bounds[0] = begin;
+			bounds[numChunks] = end;
+			for (unsigned int i = 1; i < numChunks; i++)
 			{
-				std::stringstream str_stream(line_stream);
-				std::string type_str;
-				str_stream >> type_str;
+				const char *p = std::max(bounds[i - 1], begin + (size * i) / numChunks);
+				bounds[i] = ((p > begin) && (p[-1] == '\n')) ? p : skipLine(p, end);
+			}
 
-				if (type_str == "v")
+			std::vector<PolygonChunk> chunks(numChunks);
+			std::vector<std::thread> threads;
+			threads.reserve(numChunks);
+			for (unsigned int i = 0; i < numChunks; i++)
+			{
+				PolygonChunk &c = chunks[i];
+				threads.push_back(std::thread([&c, &bounds, i, normals, texcoords, &scale]()
 				{
-					Vec3f pos;
-					pos_buffer.clear();
-					std::string parse_str = line_stream.substr(line_stream.find("v") + 1);
-					StringTools::tokenize(parse_str, pos_buffer);
-					for (unsigned int i = 0; i < 3; i++)
-						pos[i] = stof(pos_buffer[i]) * scale[i];
-
-					x->push_back(pos);
-				}
-				else if (type_str == "vt")
+					parsePolygonChunk(bounds[i], bounds[i + 1], &c.x, &c.faces,
+						(normals != nullptr) ? &c.normals : nullptr, (texcoords != nullptr) ? &c.texcoords : nullptr, scale, c.info);
+				}));
+			}
+			for (auto &t : threads)
+				t.join();
+			threads.clear();
+
+			// prefix sums of the chunk sizes give the position of each chunk in the output arrays, the
+			// numbers of v, vt and vn lines (also of the ones which are not stored) resolve the relative indices
+			std::vector<size_t> xOffset(numChunks + 1), nOffset(numChunks + 1), tOffset(numChunks + 1), fOffset(numChunks + 1), iOffset(numChunks + 1);
+			std::vector<int> xLines(numChunks + 1), nLines(numChunks + 1), tLines(numChunks + 1);
+			for (unsigned int i = 0; i < numChunks; i++)
+			{
+				const PolygonChunk &c = chunks[i];
+				xOffset[i + 1] = xOffset[i] + c.x.size();
+				nOffset[i + 1] = nOffset[i] + c.normals.size();
+				tOffset[i + 1] = tOffset[i] + c.texcoords.size();
+				fOffset[i + 1] = fOffset[i] + c.faces.counts.size();
+				iOffset[i + 1] = iOffset[i] + c.faces.posIndices.size();
+				xLines[i + 1] = xLines[i] + c.info.numPositions;
+				nLines[i + 1] = nLines[i] + c.info.numNormals;
+				tLines[i + 1] = tLines[i] + c.info.numTexcoords;
+			}
+			x->resize(xOffset[numChunks]);
+			if (normals != nullptr)
+				normals->resize(nOffset[numChunks]);
+			if (texcoords != nullptr)
+				texcoords->resize(tOffset[numChunks]);
+			faces->counts.resize(fOffset[numChunks]);
+			faces->posIndices.resize(iOffset[numChunks]);
+			faces->normalIndices.resize((normals != nullptr) ? iOffset[numChunks] : 0);
+			faces->texIndices.resize((texcoords != nullptr) ? iOffset[numChunks] : 0);
+
+			for (unsigned int i = 0; i < numChunks; i++)
+			{
+				threads.push_back(std::thread([&, i]()
 				{
+					PolygonChunk &c = chunks[i];
+					std::copy(c.x.begin(), c.x.end(), x->begin() + xOffset[i]);
+					if (normals != nullptr)
+						std::copy(c.normals.begin(), c.normals.end(), normals->begin() + nOffset[i]);
 					if (texcoords != nullptr)
-					{
-						Vec2f tex;
-						pos_buffer.clear();
-						std::string parse_str = line_stream.substr(line_stream.find("vt") + 2);
-						StringTools::tokenize(parse_str, pos_buffer);
-						for (unsigned int i = 0; i < 2; i++)
-							tex[i] = stof(pos_buffer[i]);
-
-						texcoords->push_back(tex);
-						vt = true;
-					}
-				}
-				else if (type_str == "vn")
-				{
+						std::copy(c.texcoords.begin(), c.texcoords.end(), texcoords->begin() + tOffset[i]);
+					std::copy(c.faces.counts.begin(), c.faces.counts.end(), faces->counts.begin() + fOffset[i]);
+					copyIndices(c.faces.posIndices, c.info.relativePositions, xLines[i], faces->posIndices, iOffset[i]);
 					if (normals != nullptr)
-					{
-						Vec3f nor;
-						pos_buffer.clear();
-						std::string parse_str = line_stream.substr(line_stream.find("vn") + 2);
-						StringTools::tokenize(parse_str, pos_buffer);
-						for (unsigned int i = 0; i < 3; i++)
-							nor[i] = stof(pos_buffer[i]);
+						copyIndices(c.faces.normalIndices, c.info.relativeNormals, nLines[i], faces->normalIndices, iOffset[i]);
+					if (texcoords != nullptr)
+						copyIndices(c.faces.texIndices, c.info.relativeTexcoords, tLines[i], faces->texIndices, iOffset[i]);
+					c = PolygonChunk();
+				}));
+			}
+			for (auto &t : threads)
+				t.join();
+		}
 
-						normals->push_back(nor);
-						vn = true;
-					}
-				}
-				else if (type_str == "f")
+	protected:
+		/** Line counts and relative indices of a part of an OBJ file. Relative indices
+		* are resolved with the number of lines in the part, the positions of these
+		* indices are stored, so that the lines before the part can be added.
+		*/
+		struct PolygonChunkInfo
+		{
+			int numPositions = 0;
+			int numNormals = 0;
+			int numTexcoords = 0;
+			std::vector<size_t> relativePositions;
+			std::vector<size_t> relativeNormals;
+			std::vector<size_t> relativeTexcoords;
+		};
+
+		/** Per-chunk results of parseObjPolygonsParallel(). */
+		struct PolygonChunk
+		{
+			std::vector<Vec3f> x;
+			std::vector<Vec3f> normals;
+			std::vector<Vec2f> texcoords;
+			ObjFaces faces;
+			PolygonChunkInfo info;
+		};
+
+		/** Copy the indices of a chunk to dst at offset and add the number of previous lines to its relative indices. */
+		static void copyIndices(const std::vector<int> &src, const std::vector<size_t> &relative, const int previousLines, std::vector<int> &dst, const size_t offset)
+		{
+			std::copy(src.begin(), src.end(), dst.begin() + offset);
+			for (const size_t i : relative)
+				dst[offset + i] += previousLines;
+		}
+
+		/** Convert an OBJ index to a zero based index, numLines is the number of lines of the
+		* type before the current one. 0 (no index) is converted to -1. The positions of
+		* relative indices are added to relative.
+		*/
+		static inline int resolveIndex(const int index, const int numLines, std::vector<int> &indices, std::vector<size_t> &relative)
+		{
+			if (index > 0)
+				return index - 1;
+			if (index == 0)
+				return -1;
+			relative.push_back(indices.size());
+			return numLines + index;
+		}
+
+		/** Parse the lines in [begin, end) with polygons of any size and append the results to the arrays.
+		  * The index arrays of normals and texture coordinates are only filled if the normals or texture
+		  * coordinates are read.
+		  */
+		static void parsePolygonChunk(const char *begin, const char *end, std::vector<Vec3f> *x, ObjFaces *faces, std::vector<Vec3f> *normals, std::vector<Vec2f> *texcoords, const Vec3f &scale,
+			PolygonChunkInfo &info)
+		{
+			const char *p = begin;
+			while (p < end)
+			{
+				p = skipSpaces(p, end);
+				if ((p < end) && (*p == 'v'))
 				{
-					MeshFaceIndices faceIndex;
-					if (vn && vt)
+					const char *type = p + 1;
+					if ((type < end) && isSpace(*type))
 					{
-						f_buffer.clear();
-						std::string parse_str = line_stream.substr(line_stream.find("f") + 1);
-						StringTools::tokenize(parse_str, f_buffer);
-						for (int i = 0; i < 3; ++i)
+						Vec3f pos;
+						p = type;
+						for (unsigned int i = 0; i < 3; i++)
 						{
-							pos_buffer.clear();
-							StringTools::tokenize(f_buffer[i], pos_buffer, "/");
-							faceIndex.posIndices[i] = stoi(pos_buffer[0]);
-							faceIndex.texIndices[i] = stoi(pos_buffer[1]);
-							faceIndex.normalIndices[i] = stoi(pos_buffer[2]);
+							float value = 0.0f;
+							parseFloat(p, end, value);
+							pos[i] = value * scale[i];
 						}
+						x->push_back(pos);
+						info.numPositions++;
 					}
-					else if (vn)
+					else if ((type + 1 < end) && (*type == 't') && isSpace(type[1]))
 					{
-						f_buffer.clear();
-						std::string parse_str = line_stream.substr(line_stream.find("f") + 1);
-						StringTools::tokenize(parse_str, f_buffer);
-						for (int i = 0; i < 3; ++i)
+						if (texcoords != nullptr)
 						{
-							pos_buffer.clear();
-							StringTools::tokenize(f_buffer[i], pos_buffer, "/");
-							faceIndex.posIndices[i] = stoi(pos_buffer[0]);
-
-							// Check if the vertex normal indices were found in the file
-							if (pos_buffer.size() > 1)
-								faceIndex.normalIndices[i] = stoi(pos_buffer[1]);
-							else
+							Vec2f tex;
+							p = type + 1;
+							for (unsigned int i = 0; i < 2; i++)
 							{
-								vn = false;
-								normals->clear();
+								tex[i] = 0.0f;
+								parseFloat(p, end, tex[i]);
 							}
+							texcoords->push_back(tex);
 						}
+						info.numTexcoords++;
 					}
-					else if (vt)
+					else if ((type + 1 < end) && (*type == 'n') && isSpace(type[1]))
 					{
-						f_buffer.clear();
-						std::string parse_str = line_stream.substr(line_stream.find("f") + 1);
-						StringTools::tokenize(parse_str, f_buffer);
-						for (int i = 0; i < 3; ++i)
+						if (normals != nullptr)
 						{
-							pos_buffer.clear();
-							StringTools::tokenize(f_buffer[i], pos_buffer, "/");
-							faceIndex.posIndices[i] = stoi(pos_buffer[0]);
-							faceIndex.texIndices[i] = stoi(pos_buffer[1]);
+							Vec3f nor;
+							p = type + 1;
+							for (unsigned int i = 0; i < 3; i++)
+							{
+								nor[i] = 0.0f;
+								parseFloat(p, end, nor[i]);
+							}
+							normals->push_back(nor);
 						}
+						info.numNormals++;
+					}
+				}
+				else if ((p + 1 < end) && (*p == 'f') && isSpace(p[1]))
+				{
+					p++;
+					const size_t first = faces->posIndices.size();
+					const size_t firstRelative[3] = { info.relativePositions.size(), info.relativeNormals.size(), info.relativeTexcoords.size() };
+					int posIndex, texIndex, normalIndex;
+					while (parsePolygonVertex(p, end, posIndex, texIndex, normalIndex))
+					{
+						if (texcoords != nullptr)
+							faces->texIndices.push_back(resolveIndex(texIndex, info.numTexcoords, faces->texIndices, info.relativeTexcoords));
+						if (normals != nullptr)
+							faces->normalIndices.push_back(resolveIndex(normalIndex, info.numNormals, faces->normalIndices, info.relativeNormals));
+						faces->posIndices.push_back(resolveIndex(posIndex, info.numPositions, faces->posIndices, info.relativePositions));
 					}
+					const size_t count = faces->posIndices.size() - first;
+					if (count >= 3)
+						faces->counts.push_back((int)count);
 					else
 					{
-						f_buffer.clear();
-						std::string parse_str = line_stream.substr(line_stream.find("f") + 1);
-						StringTools::tokenize(parse_str, f_buffer);
-						for (int i = 0; i < 3; ++i)
-						{
-							faceIndex.posIndices[i] = stoi(f_buffer[i]);
-						}
+						// not a polygon, remove its vertices
+						faces->posIndices.resize(first);
+						if (texcoords != nullptr)
+							faces->texIndices.resize(first);
+						if (normals != nullptr)
+							faces->normalIndices.resize(first);
+						info.relativePositions.resize(firstRelative[0]);
+						info.relativeNormals.resize(firstRelative[1]);
+						info.relativeTexcoords.resize(firstRelative[2]);
+					}
+				}
+				p = skipLine(p, end);
+			}
+		}
+
+		/** Parse the next face vertex of a line in one of the forms v, v/vt, v//vn or v/vt/vn.
+		  * Missing texture coordinate and normal indices are set to 0. Returns false at the end
+		  * of the line, at a comment or if the vertex is not valid.
+		  */
+		static bool parsePolygonVertex(const char *&p, const char *end, int &posIndex, int &texIndex, int &normalIndex)
+		{
+			p = skipSpaces(p, end);
+			texIndex = 0;
+			normalIndex = 0;
+			if (!parseInt(p, end, posIndex))
+				return false;
+			if ((p < end) && (*p == '/'))
+			{
+				p++;
+				parseInt(p, end, texIndex);
+				if ((p < end) && (*p == '/'))
+				{
+					p++;
+					parseInt(p, end, normalIndex);
+				}
+			}
+			return (p >= end) || isSpace(*p) || (*p == '\n');
+		}
+
+		static inline bool isSpace(const char c)
+		{
+			return (c == ' ') || (c == '\t') || (c == '\r');
+		}
+
+		static inline const char *skipSpaces(const char *p, const char *end)
+		{
+			while ((p < end) && isSpace(*p))
+				p++;
+			return p;
+		}
+
+		/** Return a pointer to the first character of the next line. */
+		static inline const char *skipLine(const char *p, const char *end)
+		{
+			const char *eol = (const char *) memchr(p, '\n', end - p);
+			return (eol != nullptr) ? eol + 1 : end;
+		}
+
+		/** Parse a signed integer starting at p. On success p points to the first character after the number. */
+		static inline bool parseInt(const char *&p, const char *end, int &value)
+		{
+			const char *s = p;
+			bool negative = false;
+			if ((s < end) && ((*s == '-') || (*s == '+')))
+			{
+				negative = (*s == '-');
+				s++;
+			}
+			if ((s >= end) || (*s < '0') || (*s > '9'))
+				return false;
+			int result = 0;
+			while ((s < end) && (*s >= '0') && (*s <= '9'))
+				result = 10 * result + (*s++ - '0');
+			value = negative ? -result : result;
+			p = s;
+			return true;
+		}
+
+		/** Parse a floating point number after skipping leading white spaces.
+		  * The fast path converts numbers with a mantissa of at most 2^53 and an exponent
+		  * of at most 22 to the correctly rounded double, which is then rounded to float.
+		  * The second rounding is only wrong if the double lies exactly halfway between
+		  * two floats, these numbers and all others (and inf/nan) are passed to strtof.
+		  */
+		static bool parseFloat(const char *&p, const char *end, float &value)
+		{
+			static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+			const char *s = skipSpaces(p, end);
+			bool negative = false;
+			if ((s < end) && ((*s == '-') || (*s == '+')))
+			{
+				negative = (*s == '-');
+				s++;
+			}
+
+			uint64_t mantissa = 0;
+			int numDigits = 0;
+			int exponent = 0;
+			bool validDigits = false;
+			while ((s < end) && (*s >= '0') && (*s <= '9'))
+			{
+				if (numDigits < 19)
+				{
+					mantissa = 10 * mantissa + (*s - '0');
+					if (mantissa != 0)
+						numDigits++;
+				}
+				else
+					exponent++;
+				validDigits = true;
+				s++;
+			}
+			if ((s < end) && (*s == '.'))
+			{
+				s++;
+				while ((s < end) && (*s >= '0') && (*s <= '9'))
+				{
+					if (numDigits < 19)
+					{
+						mantissa = 10 * mantissa + (*s - '0');
+						if (mantissa != 0)
+							numDigits++;
+						exponent--;
 					}
-					faces->push_back(faceIndex);
+					validDigits = true;
+					s++;
 				}
 			}
-			filestream.close();
+			if (!validDigits)
+				return parseFloatFallback(p, end, value);
+
+			if ((s < end) && ((*s == 'e') || (*s == 'E')))
+			{
+				const char *e = s + 1;
+				int exp = 0;
+				if (parseInt(e, end, exp))
+				{
+					exponent += exp;
+					s = e;
+				}
+			}
+
+			if ((mantissa > (1ull << 53)) || (exponent < -22) || (exponent > 22))
+				return parseFloatFallback(p, end, value);
+
+			double result = (double)mantissa;
+			if (exponent < 0)
+				result /= pow10[-exponent];
+			else
+				result *= pow10[exponent];
+
+			// the results are in the range of normal floats, which have 29 mantissa bits less than doubles
+			uint64_t bits;
+			memcpy(&bits, &result, sizeof(bits));
+			if ((bits & ((1ull << 29) - 1)) == (1ull << 28))
+				return parseFloatFallback(p, end, value);
+			value = (float)(negative ? -result : result);
+			p = s;
+			return true;
 		}
 
+		/** Convert a number with strtof. The token is copied to a stack buffer since the input is not null-terminated. */
+		static bool parseFloatFallback(const char *&p, const char *end, float &value)
+		{
+			const char *s = skipSpaces(p, end);
+			char buffer[64];
+			size_t length = 0;
+			while ((s + length < end) && (length < sizeof(buffer) - 1) && !isSpace(s[length]) && (s[length] != '\n'))
+			{
+				buffer[length] = s[length];
+				length++;
+			}
+			buffer[length] = '\0';
+			char *numberEnd = nullptr;
+			const float result = strtof(buffer, &numberEnd);
+			if (numberEnd == buffer)
+				return false;
+			value = result;
+			p = s + (numberEnd - buffer);
+			return true;
+		}
 	};
 }
- 
-#endif
\ No newline at end of file
+
+#endif
@@ -5,10 +5,16 @@
 #include <maya/MViewport2Renderer.h>
 #include <maya/MDrawRegistry.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "ThreadPool.h"
 
 // nodes
 #include "MeshLoader.h"
 
+// commands
+#include "MeshLoaderCacheCmd.h"
+
 bool RegisterPluginUI()
 {
 	// Create menu
@@ -47,6 +53,11 @@ MStatus initializePlugin(MObject obj)
 	// execute the specified mel script
 	status = MGlobal::sourceFile("MayaMeshTools.mel");
 
+	// start the workers of the conversion loops, MAYA_MESH_TOOLS_THREADS limits
+	// their number, e.g. on a render farm (0 or unset = all cores)
+	const char *numThreads = getenv("MAYA_MESH_TOOLS_THREADS");
+	Utilities::ThreadPool::getInstance().setNumThreads(numThreads != nullptr ? (unsigned int)std::max(0, atoi(numThreads)) : 0);
+
 	status = plugin.registerNode("MeshLoader", MeshLoader::m_id,
 		&MeshLoader::creator, &MeshLoader::initialize,
 		MPxNode::kEmitterNode);
@@ -56,6 +67,20 @@ MStatus initializePlugin(MObject obj)
 		return status;
 	}
 
+	status = MeshLoader::addSceneCallbacks();
+	if (!status)
+	{
+		status.perror("register scene callbacks");
+		return status;
+	}
+
+	status = plugin.registerCommand(MeshLoaderCacheCmd::m_name, MeshLoaderCacheCmd::creator, MeshLoaderCacheCmd::newSyntax);
+	if (!status)
+	{
+		status.perror("register meshLoaderCache");
+		return status;
+	}
+
 	if (!RegisterPluginUI())
 	{
 		status.perror("Failed to create UI");
@@ -71,6 +96,8 @@ MStatus uninitializePlugin(MObject obj)
 	MStatus status;
 	MFnPlugin plugin(obj);
 
+	MeshLoader::removeSceneCallbacks();
+
 	status = plugin.deregisterNode(MeshLoader::m_id);
 	if (!status)
 	{
@@ -78,12 +105,22 @@ MStatus uninitializePlugin(MObject obj)
 		return status;
 	}
 
+	status = plugin.deregisterCommand(MeshLoaderCacheCmd::m_name);
+	if (!status)
+	{
+		status.perror("deregister meshLoaderCache");
+		return status;
+	}
+
 	if (!DeregisterPluginUI())
 	{
 		status.perror("Failed to deregister UI");
 		return status;
 	}
 
+	// the workers are stopped before the library is unloaded
+	Utilities::ThreadPool::getInstance().setNumThreads(1);
+
 	return status;
 }
 
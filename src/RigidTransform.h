@@ -0,0 +1,237 @@
+#ifndef __RigidTransform_h__
+#define __RigidTransform_h__
+
+#include <string>
+#include <fstream>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+namespace Utilities
+{
+	/** \brief Rigid transformation x' = R x + t between two point sets.
+	* fit() computes the rotation and translation which minimize the squared
+	* distances between corresponding points (Kabsch problem). The rotation is
+	* obtained as the eigenvector of the largest eigenvalue of Horn's symmetric
+	* 4x4 matrix, which always yields a proper rotation without a reflection.
+	*/
+	class RigidTransform
+	{
+	public:
+		/** Rotation matrix, R[i][j] is row i and column j */
+		double R[3][3];
+		double t[3];
+
+		RigidTransform()
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+					R[i][j] = (i == j) ? 1.0 : 0.0;
+				t[i] = 0.0;
+			}
+		}
+
+		/** Fit the transformation which maps the points x0 to x1 (n points, the
+		* coordinates of point i start at stride * i). Returns the root mean square
+		* distance between the transformed points x0 and the points x1.
+		*/
+		double fit(const float *x0, const float *x1, const size_t n, const size_t stride = 3)
+		{
+			*this = RigidTransform();
+			if (n == 0)
+				return 0.0;
+
+			double c0[3] = { 0.0, 0.0, 0.0 };
+			double c1[3] = { 0.0, 0.0, 0.0 };
+			for (size_t i = 0; i < n; i++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					c0[k] += x0[stride * i + k];
+					c1[k] += x1[stride * i + k];
+				}
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				c0[k] /= (double)n;
+				c1[k] /= (double)n;
+			}
+
+			// cross covariance S[a][b] = sum (x0_a - c0_a) (x1_b - c1_b)
+			double S[3][3] = { { 0.0 } };
+			for (size_t i = 0; i < n; i++)
+			{
+				double p[3], q[3];
+				for (int k = 0; k < 3; k++)
+				{
+					p[k] = x0[stride * i + k] - c0[k];
+					q[k] = x1[stride * i + k] - c1[k];
+				}
+				for (int a = 0; a < 3; a++)
+					for (int b = 0; b < 3; b++)
+						S[a][b] += p[a] * q[b];
+			}
+
+			// Horn's matrix, its dominant eigenvector is the quaternion (w, x, y, z) of the rotation
+			double N[4][4] = {
+				{ S[0][0] + S[1][1] + S[2][2], S[1][2] - S[2][1], S[2][0] - S[0][2], S[0][1] - S[1][0] },
+				{ S[1][2] - S[2][1], S[0][0] - S[1][1] - S[2][2], S[0][1] + S[1][0], S[2][0] + S[0][2] },
+				{ S[2][0] - S[0][2], S[0][1] + S[1][0], -S[0][0] + S[1][1] - S[2][2], S[1][2] + S[2][1] },
+				{ S[0][1] - S[1][0], S[2][0] + S[0][2], S[1][2] + S[2][1], -S[0][0] - S[1][1] + S[2][2] } };
+			double eigenvalues[4];
+			double V[4][4];
+			jacobiEigen(N, eigenvalues, V);
+			int largest = 0;
+			for (int k = 1; k < 4; k++)
+				if (eigenvalues[k] > eigenvalues[largest])
+					largest = k;
+			const double w = V[0][largest], x = V[1][largest], y = V[2][largest], z = V[3][largest];
+			const double norm = sqrt(w * w + x * x + y * y + z * z);
+			setRotation(w / norm, x / norm, y / norm, z / norm);
+
+			for (int k = 0; k < 3; k++)
+				t[k] = c1[k] - (R[k][0] * c0[0] + R[k][1] * c0[1] + R[k][2] * c0[2]);
+
+			double error = 0.0;
+			for (size_t i = 0; i < n; i++)
+			{
+				const float *p = x0 + stride * i;
+				const float *q = x1 + stride * i;
+				for (int k = 0; k < 3; k++)
+				{
+					const double v = R[k][0] * p[0] + R[k][1] * p[1] + R[k][2] * p[2] + t[k] - q[k];
+					error += v * v;
+				}
+			}
+			return sqrt(error / (double)n);
+		}
+
+		/** Read a transformation from a text file with 16 numbers. The numbers are
+		* a 4x4 matrix in Maya's order (as returned by "xform -q -m"), i.e. the
+		* rotation is transposed and the translation is stored in the last row.
+		*/
+		bool readMayaMatrix(const std::string &fileName)
+		{
+			std::ifstream file(fileName.c_str());
+			if (!file)
+				return false;
+			double m[16];
+			for (int i = 0; i < 16; i++)
+				if (!(file >> m[i]))
+					return false;
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+					R[i][j] = m[4 * j + i];
+				t[i] = m[12 + i];
+			}
+			return true;
+		}
+
+		/** Get the transformation as 4x4 matrix in Maya's order, see readMayaMatrix(). */
+		void getMayaMatrix(double m[4][4]) const
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+					m[j][i] = R[i][j];
+				m[i][3] = 0.0;
+				m[3][i] = t[i];
+			}
+			m[3][3] = 1.0;
+		}
+
+		/** Length of the diagonal of the bounding box of n points, see fit() for the stride. */
+		static double boundingBoxDiagonal(const float *x, const size_t n, const size_t stride = 3)
+		{
+			if (n == 0)
+				return 0.0;
+			double minX[3] = { x[0], x[1], x[2] };
+			double maxX[3] = { x[0], x[1], x[2] };
+			for (size_t i = 1; i < n; i++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					minX[k] = std::min(minX[k], (double)x[stride * i + k]);
+					maxX[k] = std::max(maxX[k], (double)x[stride * i + k]);
+				}
+			}
+			return sqrt((maxX[0] - minX[0]) * (maxX[0] - minX[0]) + (maxX[1] - minX[1]) * (maxX[1] - minX[1]) + (maxX[2] - minX[2]) * (maxX[2] - minX[2]));
+		}
+
+	protected:
+		void setRotation(const double w, const double x, const double y, const double z)
+		{
+			R[0][0] = 1.0 - 2.0 * (y * y + z * z);
+			R[0][1] = 2.0 * (x * y - w * z);
+			R[0][2] = 2.0 * (x * z + w * y);
+			R[1][0] = 2.0 * (x * y + w * z);
+			R[1][1] = 1.0 - 2.0 * (x * x + z * z);
+			R[1][2] = 2.0 * (y * z - w * x);
+			R[2][0] = 2.0 * (x * z - w * y);
+			R[2][1] = 2.0 * (y * z + w * x);
+			R[2][2] = 1.0 - 2.0 * (x * x + y * y);
+		}
+
+		/** Eigen decomposition of a symmetric 4x4 matrix with the cyclic Jacobi method.
+		* The eigenvectors are the columns of V.
+		*/
+		static void jacobiEigen(double A[4][4], double eigenvalues[4], double V[4][4])
+		{
+			for (int i = 0; i < 4; i++)
+				for (int j = 0; j < 4; j++)
+					V[i][j] = (i == j) ? 1.0 : 0.0;
+
+			for (int sweep = 0; sweep < 50; sweep++)
+			{
+				double offDiagonal = 0.0;
+				for (int p = 0; p < 4; p++)
+					for (int q = p + 1; q < 4; q++)
+						offDiagonal += A[p][q] * A[p][q];
+				if (offDiagonal < 1.0e-30)
+					break;
+
+				for (int p = 0; p < 4; p++)
+				{
+					for (int q = p + 1; q < 4; q++)
+					{
+						if (A[p][q] == 0.0)
+							continue;
+						const double theta = (A[q][q] - A[p][p]) / (2.0 * A[p][q]);
+						const double tangent = ((theta >= 0.0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+						const double c = 1.0 / sqrt(tangent * tangent + 1.0);
+						const double s = tangent * c;
+
+						// A = J^T A J with the rotation J in the plane (p, q)
+						for (int k = 0; k < 4; k++)
+						{
+							const double akp = A[k][p];
+							const double akq = A[k][q];
+							A[k][p] = c * akp - s * akq;
+							A[k][q] = s * akp + c * akq;
+						}
+						for (int k = 0; k < 4; k++)
+						{
+							const double apk = A[p][k];
+							const double aqk = A[q][k];
+							A[p][k] = c * apk - s * aqk;
+							A[q][k] = s * apk + c * aqk;
+						}
+						for (int k = 0; k < 4; k++)
+						{
+							const double vkp = V[k][p];
+							const double vkq = V[k][q];
+							V[k][p] = c * vkp - s * vkq;
+							V[k][q] = s * vkp + c * vkq;
+						}
+					}
+				}
+			}
+			for (int i = 0; i < 4; i++)
+				eigenvalues[i] = A[i][i];
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef __ThreadPool_h__
+#define __ThreadPool_h__
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+
+namespace Utilities
+{
+	/** \brief Worker threads for the data parallel loops of the readers and the mesh conversion.
+	* parallelFor() splits a range into blocks of grainSize elements. The blocks
+	* are claimed one after another by the calling thread and by all idle
+	* workers, so that threads which finish early take over the remaining
+	* blocks. The calling thread always takes part, so loops can be started from
+	* any thread at the same time, including the prefetch threads and the
+	* workers themselves, and the loop finishes even if all workers are busy.
+	*
+	* The loops of the plugin and the readers use the shared pool, see
+	* getInstance(). Its number of threads is set by the plugin, see
+	* setNumThreads(), e.g. to limit the threads on a render farm.
+	*/
+	class ThreadPool
+	{
+	public:
+		/** Default number of elements of a block of parallelFor() */
+		static const size_t DEFAULT_GRAIN_SIZE = 16384;
+
+		/** Start a pool with numThreads threads including the calling thread (0 = number of hardware threads). */
+		explicit ThreadPool(const unsigned int numThreads = 0) : m_numThreads(1), m_stop(false)
+		{
+			setNumThreads(numThreads);
+		}
+
+		~ThreadPool()
+		{
+			setNumThreads(1);
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/** The pool shared by all nodes of the plugin and the readers. */
+		static ThreadPool &getInstance()
+		{
+			static ThreadPool pool;
+			return pool;
+		}
+
+		/** Set the number of threads which run a loop, including the calling
+		* thread (0 = number of hardware threads). 1 stops all workers, so that
+		* the loops run on the calling thread. Loops which are running are
+		* finished by their calling threads.
+		*/
+		void setNumThreads(unsigned int numThreads)
+		{
+			if (numThreads == 0)
+				numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+			std::lock_guard<std::mutex> configLock(m_configMutex);
+			if (numThreads == m_numThreads)
+				return;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_jobCondition.notify_all();
+			for (std::thread &t : m_threads)
+				t.join();
+			m_threads.clear();
+			m_stop = false;
+			for (unsigned int i = 1; i < numThreads; i++)
+				m_threads.push_back(std::thread(&ThreadPool::worker, this));
+			m_numThreads = numThreads;
+		}
+
+		unsigned int getNumThreads() const { return m_numThreads; }
+
+		/** Call func(blockBegin, blockEnd) for blocks of at most grainSize
+		* elements which cover [begin, end) and return when all blocks are done.
+		* func is called concurrently for different blocks and must not throw.
+		*/
+		void parallelFor(const size_t begin, const size_t end, const std::function<void(size_t, size_t)> &func, const size_t grainSize = DEFAULT_GRAIN_SIZE)
+		{
+			if (end <= begin)
+				return;
+			const size_t grain = std::max(grainSize, (size_t)1);
+			if ((m_numThreads <= 1) || (end - begin <= grain))
+			{
+				func(begin, end);
+				return;
+			}
+
+			Job job(begin, end, grain, func);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_jobs.push_back(&job);
+			}
+			m_jobCondition.notify_all();
+			job.run();
+
+			// all blocks are claimed, wait for the workers which are still running one
+			std::unique_lock<std::mutex> lock(m_mutex);
+			removeJob(&job);
+			m_doneCondition.wait(lock, [&]() { return job.numWorkers == 0; });
+		}
+
+	protected:
+		struct Job
+		{
+			Job(const size_t begin, const size_t end, const size_t grain, const std::function<void(size_t, size_t)> &func) :
+				next(begin), end(end), grain(grain), func(func), numWorkers(0) {}
+
+			void run()
+			{
+				size_t blockBegin;
+				while ((blockBegin = next.fetch_add(grain)) < end)
+					func(blockBegin, std::min(blockBegin + grain, end));
+			}
+
+			std::atomic<size_t> next;
+			const size_t end;
+			const size_t grain;
+			const std::function<void(size_t, size_t)> &func;
+			/** Workers which run blocks of the job, guarded by m_mutex */
+			unsigned int numWorkers;
+		};
+
+		std::vector<std::thread> m_threads;
+		std::atomic<unsigned int> m_numThreads;
+		std::mutex m_configMutex;
+		std::mutex m_mutex;
+		std::condition_variable m_jobCondition;
+		std::condition_variable m_doneCondition;
+		/** Loops which may have unclaimed blocks */
+		std::deque<Job*> m_jobs;
+		bool m_stop;
+
+		void removeJob(Job *job)
+		{
+			std::deque<Job*>::iterator it = std::find(m_jobs.begin(), m_jobs.end(), job);
+			if (it != m_jobs.end())
+				m_jobs.erase(it);
+		}
+
+		void worker()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (true)
+			{
+				m_jobCondition.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+				if (m_stop)
+					return;
+
+				Job *job = m_jobs.front();
+				job->numWorkers++;
+				lock.unlock();
+				job->run();
+				lock.lock();
+
+				// the job has no unclaimed blocks anymore
+				removeJob(job);
+				if (--job->numWorkers == 0)
+					m_doneCondition.notify_all();
+			}
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef __TraceLog_h__
+#define __TraceLog_h__
+
+#include <string>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <functional>
+
+namespace Utilities
+{
+	/** \brief Log of timed events in the Chrome trace event format.
+	* The file is a JSON array of complete events ("ph": "X") which can be
+	* opened in chrome://tracing or https://ui.perfetto.dev. Time stamps are
+	* microseconds of a steady clock, see now(). All users of the same file share
+	* one log, see open(), and events can be added from any thread. The array is
+	* closed when the last user releases the log.
+	*/
+	class TraceLog
+	{
+	public:
+		~TraceLog()
+		{
+			if (m_file != nullptr)
+			{
+				fprintf(m_file, "\n]\n");
+				fclose(m_file);
+			}
+		}
+
+		TraceLog(const TraceLog&) = delete;
+		TraceLog& operator=(const TraceLog&) = delete;
+
+		/** Get the log of a file. The file is created (or overwritten) by the
+		* first call for it and kept open while a returned pointer exists.
+		* Returns null if the file cannot be created.
+		*/
+		static std::shared_ptr<TraceLog> open(const std::string &fileName)
+		{
+			static std::mutex registryMutex;
+			static std::map<std::string, std::weak_ptr<TraceLog> > registry;
+
+			std::lock_guard<std::mutex> lock(registryMutex);
+			std::shared_ptr<TraceLog> log = registry[fileName].lock();
+			if (log)
+				return log;
+			FILE *file = fopen(fileName.c_str(), "w");
+			if (file == nullptr)
+				return nullptr;
+			log.reset(new TraceLog(fileName, file));
+			registry[fileName] = log;
+			return log;
+		}
+
+		const std::string &getFileName() const { return m_fileName; }
+
+		/** Add an event which started at start and took duration microseconds.
+		* args is a list of JSON members without braces, e.g. "\"frame\": 1".
+		*/
+		void addEvent(const std::string &name, const long long start, const long long duration, const unsigned long long threadId,
+			const std::string &args = "")
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			fprintf(m_file, "%s{\"name\": \"%s\", \"cat\": \"MeshLoader\", \"ph\": \"X\", \"ts\": %lld, \"dur\": %lld, \"pid\": 1, \"tid\": %llu, \"args\": {%s}}",
+				m_numEvents == 0 ? "\n" : ",\n", escape(name).c_str(), start, duration, threadId, args.c_str());
+			m_numEvents++;
+			// flush, so that the log can be inspected while Maya is running
+			fflush(m_file);
+		}
+
+		/** Current time in microseconds. */
+		static long long now()
+		{
+			return (long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		/** Id of the calling thread as used in the events. */
+		static unsigned long long currentThreadId()
+		{
+			return (unsigned long long)(std::hash<std::thread::id>()(std::this_thread::get_id()) & 0x7fffffff);
+		}
+
+		/** Escape a string for a JSON string value. */
+		static std::string escape(const std::string &s)
+		{
+			std::string result;
+			result.reserve(s.size());
+			for (const char c : s)
+			{
+				if ((c == '"') || (c == '\\'))
+				{
+					result += '\\';
+					result += c;
+				}
+				else if ((unsigned char)c < 0x20)
+				{
+					char buffer[8];
+					snprintf(buffer, sizeof(buffer), "\\u%04x", (unsigned int)(unsigned char)c);
+					result += buffer;
+				}
+				else
+					result += c;
+			}
+			return result;
+		}
+
+	protected:
+		std::string m_fileName;
+		FILE *m_file;
+		std::mutex m_mutex;
+		unsigned int m_numEvents;
+
+		TraceLog(const std::string &fileName, FILE *file) : m_fileName(fileName), m_file(file), m_numEvents(0)
+		{
+			fprintf(m_file, "[");
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,752 @@
+// Tests of the Maya independent core library. Each test is registered with
+// ctest under its name and can be run alone:
+//   readers      write meshes with MeshWriter as OBJ, PLY, MZD and MTC, read
+//                them back with MeshReader and compare all attributes; parse
+//                OBJ and ASCII PLY data with known contents; read empty OBJ
+//                and PLY files as empty meshes
+//   objParallel  parse a large OBJ buffer serially and with several threads,
+//                the results have to be identical
+//   objFloats    parse OBJ coordinates with 6 to 17 significant digits, many of
+//                them close to the midpoint of two floats, the results have to
+//                be bitwise equal to strtof
+//   mzdRoundTrip write meshes with all chunk types and with 2 and 4 byte
+//                indices with writeMZD() and with the streaming interface and
+//                read them back with readMZD(), the round trip has to be
+//                lossless
+//   halfFloat    convert all 65536 halfs to floats with the portable and the
+//                dispatched (F16C if available) conversion and compare them bit
+//                by bit with the lookup table of readMZD_half2float.h; convert
+//                them back to halfs and compare both float to half conversions
+//                for every 97th float bit pattern
+//   meshCache    read MTC files which are truncated or have polygon sizes or
+//                vertex indices that do not match the header, they have to be
+//                rejected
+//   frameCache   load files through a FrameCache, a cached file which is
+//                rewritten right after it was read has to be read again
+//
+// Usage: MeshToolsCoreTest [test ...]    (all tests if none is given)
+// Returns 0 if all tests pass.
+
+#include "src/MeshData.h"
+#include "src/MeshReader.h"
+#include "src/MeshWriter.h"
+#include "src/MeshCacheFile.h"
+#include "src/FrameCache.h"
+#include "src/MemoryMappedFile.h"
+#include "extern/mzd/readMZD.h"
+#include "extern/mzd/writeMZD.h"
+#include "extern/mzd/halfToFloat.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+namespace
+{
+	int g_failures = 0;
+
+	union HalfToFloatEntry { unsigned int ui; float f; };
+	const HalfToFloatEntry lookupH2F[65536] =
+	{
+		#include "extern/mzd/readMZD_half2float.h"
+	};
+
+	void check(const bool condition, const std::string &message)
+	{
+		if (!condition)
+		{
+			printf("  FAILED: %s\n", message.c_str());
+			g_failures++;
+		}
+	}
+
+	/** res x res grid with triangles, quads and pentagons (every 5th cell has an
+	* extra vertex at the midpoint of an edge). Normals and UVs are per vertex or
+	* face-varying, colors are multiples of 1/255, so that they survive the 8 bit
+	* colors of PLY files.
+	*/
+	Utilities::MeshData makeMesh(const int res, const bool faceVarying)
+	{
+		Utilities::MeshData mesh;
+		const int n = res + 1;
+		for (int j = 0; j < n; j++)
+			for (int i = 0; i < n; i++)
+				mesh.positions.insert(mesh.positions.end(), { (float)i, (float)j, 0.25f * (float)((i * j) % 7), 1.0f });
+		for (int j = 0; j < res; j++)
+		{
+			for (int i = 0; i < res; i++)
+			{
+				const int a = j * n + i;
+				const int cell = j * res + i;
+				if (cell % 5 == 0)
+				{
+					// pentagon with an extra vertex at the midpoint of the bottom edge
+					const int m = mesh.numVertices();
+					mesh.positions.insert(mesh.positions.end(), { (float)i + 0.5f, (float)j, 0.0f, 1.0f });
+					mesh.counts.push_back(5);
+					mesh.connects.insert(mesh.connects.end(), { a, m, a + 1, a + n + 1, a + n });
+				}
+				else if (cell % 3 == 0)
+				{
+					mesh.counts.push_back(3);
+					mesh.connects.insert(mesh.connects.end(), { a, a + 1, a + n + 1 });
+					mesh.counts.push_back(3);
+					mesh.connects.insert(mesh.connects.end(), { a, a + n + 1, a + n });
+				}
+				else
+				{
+					mesh.counts.push_back(4);
+					mesh.connects.insert(mesh.connects.end(), { a, a + 1, a + n + 1, a + n });
+				}
+			}
+		}
+
+		const int numVertices = mesh.numVertices();
+		for (int v = 0; v < numVertices; v++)
+			mesh.colors.insert(mesh.colors.end(), { (float)(v % 256) / 255.0f, (float)((3 * v) % 256) / 255.0f, (float)((7 * v) % 256) / 255.0f, 1.0f });
+
+		if (!faceVarying)
+		{
+			for (int v = 0; v < numVertices; v++)
+			{
+				const float l = sqrtf(1.0f + (float)(v % 5) * (float)(v % 5));
+				mesh.normals.insert(mesh.normals.end(), { (float)(v % 5) / l, 0.0f, 1.0f / l });
+			}
+			std::vector<float> v;
+			for (int i = 0; i < numVertices; i++)
+			{
+				mesh.uvs.push_back(mesh.positions[4 * i] / (float)res);
+				v.push_back(mesh.positions[4 * i + 1] / (float)res);
+			}
+			mesh.uvs.insert(mesh.uvs.end(), v.begin(), v.end());
+		}
+		else
+		{
+			// one normal per polygon (hard edges), UVs with a seam: the polygons of the right half
+			// of the grid are shifted, so the vertices in the middle have two UVs
+			size_t index = 0;
+			std::vector<float> u, v;
+			for (int f = 0; f < mesh.numPolygons(); f++)
+			{
+				mesh.normals.insert(mesh.normals.end(), { 0.0f, (float)(f % 3) * 0.5f, 1.0f });
+				const bool shifted = mesh.positions[4 * mesh.connects[index]] >= 0.5f * (float)res;
+				for (int k = 0; k < mesh.counts[f]; k++, index++)
+				{
+					const int vertex = mesh.connects[index];
+					mesh.normalIds.push_back(f);
+					const float x = mesh.positions[4 * vertex] / (float)res;
+					mesh.uvIds.push_back((int)u.size());
+					u.push_back(shifted ? x + 0.25f : x);
+					v.push_back(mesh.positions[4 * vertex + 1] / (float)res);
+				}
+			}
+			mesh.uvs = u;
+			mesh.uvs.insert(mesh.uvs.end(), v.begin(), v.end());
+		}
+		mesh.topologyHash = mesh.computeTopologyHash();
+		return mesh;
+	}
+
+	/** Compare normals and UVs per polygon vertex, so that per-vertex and face-varying storage and shared values are equivalent. */
+	bool sameCorners(const Utilities::MeshData &a, const Utilities::MeshData &b, const bool compareNormals, const float normalTolerance, const bool compareUVs)
+	{
+		for (size_t c = 0; c < a.connects.size(); c++)
+		{
+			if (compareNormals)
+			{
+				const int na = a.normalIds.empty() ? a.connects[c] : a.normalIds[c];
+				const int nb = b.normalIds.empty() ? b.connects[c] : b.normalIds[c];
+				for (int k = 0; k < 3; k++)
+					if (fabsf(a.normals[3 * na + k] - b.normals[3 * nb + k]) > normalTolerance)
+						return false;
+			}
+			if (compareUVs)
+			{
+				const int ua = a.uvIds.empty() ? a.connects[c] : a.uvIds[c];
+				const int ub = b.uvIds.empty() ? b.connects[c] : b.uvIds[c];
+				if ((a.uvs[ua] != b.uvs[ub]) || (a.uvs[a.numUVs() + ua] != b.uvs[b.numUVs() + ub]))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	void readerRoundTrip(const Utilities::MeshData &mesh, const std::string &format, const bool faceVarying)
+	{
+		const std::string name = format + (faceVarying ? " face-varying" : " per vertex");
+		const std::string fileName = "MeshToolsCoreTest." + format;
+		std::string error;
+		Utilities::MeshData read;
+		const bool written = Utilities::MeshWriter::write(fileName, mesh, error);
+		check(written, name + ": write failed: " + error);
+		const bool ok = written && Utilities::MeshReader::read(fileName, false, read, error);
+		check(ok, name + ": read failed: " + error);
+		Utilities::MeshData positionsOnly;
+		const bool okPositionsOnly = written && Utilities::MeshReader::read(fileName, true, positionsOnly, error);
+		remove(fileName.c_str());
+		if (!ok || !okPositionsOnly)
+			return;
+
+		check(read.positions == mesh.positions, name + ": positions differ");
+		check((read.counts == mesh.counts) && (read.connects == mesh.connects), name + ": polygons differ");
+		check(read.topologyHash == mesh.topologyHash, name + ": topology hash differs");
+
+		// MZD stores normals and colors as halfs, PLY no face-varying normals and OBJ no colors
+		const float tolerance = (format == "mzd") ? 1.0e-3f : 0.0f;
+		const bool hasNormals = !((format == "ply") && faceVarying);
+		check(hasNormals ? (read.hasNormals() == mesh.hasNormals()) && (read.hasFaceVaryingNormals() == mesh.hasFaceVaryingNormals()) : read.normals.empty(),
+			name + ": wrong kind of normals");
+		check(read.hasUVs(), name + ": no UVs");
+		if ((read.hasNormals() || read.hasFaceVaryingNormals() || !hasNormals) && read.hasUVs())
+			check(sameCorners(mesh, read, hasNormals, tolerance, true), name + ": normals or UVs differ");
+
+		if (format == "obj")
+			check(read.colors.empty(), name + ": unexpected colors");
+		else
+		{
+			bool sameColors = read.colors.size() == mesh.colors.size();
+			for (size_t i = 0; sameColors && (i < read.colors.size()); i++)
+				sameColors = fabsf(read.colors[i] - mesh.colors[i]) <= tolerance;
+			check(sameColors, name + ": colors differ");
+		}
+
+		// the offline sharing of face-varying values must not change any polygon vertex
+		if (faceVarying)
+		{
+			Utilities::MeshData shared = read;
+			Utilities::MeshWriter::shareValues(shared);
+			check(sameCorners(read, shared, read.hasFaceVaryingNormals(), 0.0f, true), name + ": shared values differ");
+			check(!read.hasFaceVaryingNormals() || (shared.normals.size() == 3 * 3), name + ": normals are not shared");
+			check(shared.hasUVs() && (shared.numUVs() < read.numUVs()), name + ": UVs are not shared");
+		}
+
+		check((positionsOnly.positions == mesh.positions) && (positionsOnly.connects == mesh.connects), name + ": positions only: mesh differs");
+		check(positionsOnly.normals.empty() && positionsOnly.colors.empty() && positionsOnly.uvs.empty(), name + ": positions only: attributes were read");
+	}
+
+	bool writeText(const std::string &fileName, const std::string &text)
+	{
+		FILE *file = fopen(fileName.c_str(), "wb");
+		if (file == NULL)
+			return false;
+		const bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+		return (fclose(file) == 0) && ok;
+	}
+
+	void testReaders()
+	{
+		for (int faceVarying = 0; faceVarying < 2; faceVarying++)
+		{
+			const Utilities::MeshData mesh = makeMesh(20, faceVarying != 0);
+			for (const char *format : { "obj", "ply", "mzd", "mtc" })
+				readerRoundTrip(mesh, format, faceVarying != 0);
+		}
+
+		// OBJ with polygons of different sizes, relative indices and all index forms
+		const std::string obj =
+			"# test\n"
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 0 0\n"
+			"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvt 0.5 0.5\n"
+			"vn 0 0 1\n"
+			"f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+			"f -4/-4/-1 -1/-1/-1 -3/-3/-1\n"
+			"f 2//1 5//1 3//1\n";
+		Utilities::MeshData mesh;
+		std::string error;
+		const bool ok = Utilities::MeshReader::readFromMemory("OBJ", obj.data(), obj.size(), false, mesh, error);
+		check(ok, "OBJ text: read failed: " + error);
+		check((mesh.numVertices() == 5) && (mesh.counts == std::vector<int>({ 4, 3, 3 })) &&
+			(mesh.connects == std::vector<int>({ 0, 1, 2, 3, 1, 4, 2, 1, 4, 2 })), "OBJ text: polygons differ");
+		check(mesh.hasNormals() && (mesh.normals[2] == 1.0f), "OBJ text: normals differ");
+		// the last face has no UVs, so the UVs are not used
+		check(mesh.uvs.empty(), "OBJ text: UVs should be ignored");
+
+		const std::string invalidObj = "v 0 0 0\nv 1 0 0\nf 1 2 3\n";
+		check(!Utilities::MeshReader::readFromMemory("OBJ", invalidObj.data(), invalidObj.size(), false, mesh, error), "OBJ text: invalid index accepted");
+
+		// ASCII PLY with double positions, 8 bit colors and per-vertex s, t
+		const std::string ply =
+			"ply\nformat ascii 1.0\n"
+			"element vertex 4\nproperty double x\nproperty double y\nproperty double z\n"
+			"property uchar red\nproperty uchar green\nproperty uchar blue\nproperty float s\nproperty float t\n"
+			"element face 2\nproperty list uchar int vertex_indices\nend_header\n"
+			"0 0 0 255 0 0 0 0\n1 0 0 0 255 0 1 0\n1 1 0 0 0 255 1 1\n0 1 0 255 255 255 0 1\n"
+			"3 0 1 2\n3 0 2 3\n";
+		const bool okPly = Utilities::MeshReader::readFromMemory("PLY", ply.data(), ply.size(), false, mesh, error);
+		check(okPly, "PLY text: read failed: " + error);
+		check((mesh.numVertices() == 4) && (mesh.positions[4] == 1.0f) && (mesh.positions[7] == 1.0f) &&
+			(mesh.connects == std::vector<int>({ 0, 1, 2, 0, 2, 3 })), "PLY text: mesh differs");
+		check(mesh.hasColors() && (mesh.colors[0] == 1.0f) && (mesh.colors[5] == 1.0f) && (mesh.colors[15] == 1.0f), "PLY text: colors differ");
+		check(mesh.hasUVs() && mesh.uvIds.empty() && (mesh.uvs[1] == 1.0f) && (mesh.uvs[4 + 2] == 1.0f), "PLY text: UVs differ");
+
+		// empty files cannot be mapped, but are valid empty meshes
+		for (const char *format : { "obj", "ply" })
+		{
+			const std::string fileName = std::string("MeshToolsCoreTest.empty.") + format;
+			check(writeText(fileName, ""), "unable to write " + fileName);
+			Utilities::MemoryMappedFile file;
+			check(file.open(fileName) && file.isOpen() && (file.size() == 0), fileName + ": empty file not opened");
+			file.close();
+			mesh.positions.assign(4, 1.0f);
+			const bool okEmpty = Utilities::MeshReader::read(fileName, false, mesh, error);
+			check(okEmpty && (mesh.numVertices() == 0) && (mesh.numPolygons() == 0), fileName + ": empty file not read as empty mesh: " + error);
+			remove(fileName.c_str());
+		}
+	}
+
+	void testObjParallel()
+	{
+		// about 12 MB, well above the size from which OBJ files are parsed in parallel
+		const int res = 300;
+		std::ostringstream out;
+		for (int j = 0; j <= res; j++)
+			for (int i = 0; i <= res; i++)
+				out << "v " << i << " " << j << " " << 0.001 * ((i * 31 + j * 17) % 1000) << "\nvt " << (double)i / res << " " << (double)j / res << "\nvn 0 0 1\n";
+		const int n = res + 1;
+		std::vector<int> connects;
+		for (int j = 0; j < res; j++)
+		{
+			for (int i = 0; i < res; i++)
+			{
+				const int a = j * n + i + 1;
+				if ((i + j) % 4 == 0)
+				{
+					connects.insert(connects.end(), { a - 1, a, a + n - 1 });
+					// relative indices
+					const int numVertices = n * n;
+					out << "f " << a - numVertices - 1 << "/" << a - numVertices - 1 << "/" << a - numVertices - 1 << " "
+						<< a + 1 - numVertices - 1 << "/" << a + 1 - numVertices - 1 << "/" << a + 1 - numVertices - 1 << " "
+						<< a + n - numVertices - 1 << "/" << a + n - numVertices - 1 << "/" << a + n - numVertices - 1 << "\n";
+				}
+				else
+				{
+					connects.insert(connects.end(), { a - 1, a, a + n, a + n - 1 });
+					out << "f " << a << "/" << a << "/" << a << " " << a + 1 << "/" << a + 1 << "/" << a + 1 << " "
+						<< a + n + 1 << "/" << a + n + 1 << "/" << a + n + 1 << " " << a + n << "/" << a + n << "/" << a + n << "\n";
+				}
+			}
+		}
+		const std::string data = out.str();
+
+		Utilities::MeshData serial, parallel;
+		std::string error;
+		const bool okSerial = Utilities::MeshReader::readOBJ(data.data(), data.size(), false, serial, error, 1);
+		check(okSerial, "serial parse failed: " + error);
+		const bool okParallel = Utilities::MeshReader::readOBJ(data.data(), data.size(), false, parallel, error, 4);
+		check(okParallel, "parallel parse failed: " + error);
+		if (!okSerial || !okParallel)
+			return;
+		check((serial.numVertices() == n * n) && (serial.connects == connects), "polygons differ from the file");
+		check((serial.positions == parallel.positions) && (serial.counts == parallel.counts) && (serial.connects == parallel.connects),
+			"positions or polygons differ");
+		check((serial.normals == parallel.normals) && (serial.normalIds == parallel.normalIds) && (serial.uvs == parallel.uvs) &&
+			(serial.uvIds == parallel.uvIds), "normals or UVs differ");
+		check(serial.hasNormals() && serial.hasUVs(), "normals or UVs missing");
+	}
+
+	void testObjFloats()
+	{
+		// %.15g to %.17g are the usual export precisions of doubles. Doubles close to the
+		// midpoint of two floats are the cases in which rounding via double can go wrong.
+		std::vector<std::string> numbers = { "1.000000536441803", "1.00000661611557", "0.1", "-2.5e-3", "1e10", "3.4028234e38", "1.17549435e-38" };
+		uint32_t state = 12345;
+		char text[64];
+		for (int i = 0; i < 100000; i++)
+		{
+			state = state * 1664525u + 1013904223u;
+			const int exponent = (int)(state >> 24) % 24 - 12;
+			state = state * 1664525u + 1013904223u;
+			const float f = ldexpf(1.0f + (float)(state >> 9) / 8388608.0f, exponent) * (((i / 3) % 2 == 0) ? 1.0f : -1.0f);
+			const double midpoint = 0.5 * ((double)f + (double)nextafterf(f, 2.0f * f));
+			const double value = (i % 4 == 0) ? (double)f : midpoint;
+			const char *formats[] = { "%.6g", "%.15g", "%.16g", "%.17g" };
+			snprintf(text, sizeof(text), formats[i % 4 == 0 ? 0 : 1 + i % 3], value);
+			numbers.push_back(text);
+		}
+
+		std::string obj;
+		for (size_t i = 0; i < numbers.size(); i++)
+			obj += ((i % 3 == 0) ? "v " : " ") + numbers[i] + ((i % 3 == 2) ? "\n" : "");
+		while (numbers.size() % 3 != 0)
+		{
+			obj += " 0";
+			numbers.push_back("0");
+		}
+		obj += "\n";
+
+		Utilities::MeshData mesh;
+		std::string error;
+		const bool ok = Utilities::MeshReader::readOBJ(obj.data(), obj.size(), true, mesh, error, 1);
+		check(ok && (mesh.numVertices() == (int)(numbers.size() / 3)), "parse failed: " + error);
+		if (!ok)
+			return;
+		int numWrong = 0;
+		for (size_t i = 0; i < numbers.size(); i++)
+		{
+			const float expected = strtof(numbers[i].c_str(), nullptr);
+			const float parsed = mesh.positions[4 * (i / 3) + i % 3];
+			if (memcmp(&expected, &parsed, sizeof(float)) != 0)
+			{
+				if (numWrong++ < 5)
+					printf("  %s: parsed %.9g, strtof %.9g\n", numbers[i].c_str(), parsed, expected);
+			}
+		}
+		check(numWrong == 0, std::to_string(numWrong) + " numbers differ from strtof");
+	}
+
+	/** Random values in [-1, 1]. If halfExact is set, the values are representable as half floats. */
+	std::vector<float> randomValues(const size_t n, unsigned int &seed, const bool halfExact)
+	{
+		std::vector<float> values(n);
+		for (size_t i = 0; i < n; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			values[i] = 2.0f * (float)(seed >> 8) / (float)(1u << 24) - 1.0f;
+		}
+		if (halfExact)
+		{
+			std::vector<unsigned short> h(n);
+			mzd_floatToHalf(values.data(), h.data(), n);
+			mzd_halfToFloat(h.data(), values.data(), n);
+		}
+		return values;
+	}
+
+	bool equal(const std::vector<float> &a, const float *b)
+	{
+		return (b != nullptr) && (memcmp(a.data(), b, a.size() * sizeof(float)) == 0);
+	}
+
+	/** Write a mesh with all chunk types and mixed polygon sizes with writeMZD(), read it back and compare. */
+	void mzdRoundTrip(const int numVertices)
+	{
+		std::ostringstream name;
+		name << numVertices << " vertices";
+		const std::string fileName = "MeshToolsCoreTest.mzd";
+
+		unsigned int seed = (unsigned int)numVertices;
+		std::vector<unsigned char> counts;
+		std::vector<int> indices;
+		for (int i = 0; i + 5 <= numVertices; i += 5)
+		{
+			const unsigned char n = (unsigned char)(3 + (i / 5) % 3);
+			counts.push_back(n);
+			for (int j = 0; j < n; j++)
+				indices.push_back((i + j * 7919) % numVertices);
+		}
+		const int numPolygons = (int)counts.size();
+		const size_t numNodes = indices.size();
+
+		// positions and UVWs are stored as floats, all other attributes as halfs
+		const std::vector<float> positions = randomValues(3 * numVertices, seed, false);
+		const std::vector<float> vertNormals = randomValues(3 * numVertices, seed, true);
+		const std::vector<float> vertMotions = randomValues(3 * numVertices, seed, true);
+		const std::vector<float> vertColors = randomValues(4 * numVertices, seed, true);
+		const std::vector<float> vertUVWs = randomValues(3 * numVertices, seed, false);
+		const std::vector<float> nodeNormals = randomValues(3 * numNodes, seed, true);
+		const std::vector<float> nodeColors = randomValues(4 * numNodes, seed, true);
+		const std::vector<float> nodeUVWs = randomValues(3 * numNodes, seed, false);
+		const int written = writeMZD(fileName.c_str(), numVertices, numPolygons, positions.data(), counts.data(), indices.data(), vertNormals.data(),
+			vertMotions.data(), vertColors.data(), vertUVWs.data(), nodeNormals.data(), nodeColors.data(), nodeUVWs.data());
+		check(written == 0, name.str() + ": writeMZD failed");
+
+		int nv = 0, np = 0, nn = 0;
+		float *p = nullptr, *vn = nullptr, *vm = nullptr, *vc = nullptr, *vu = nullptr, *nnr = nullptr, *nc = nullptr, *nu = nullptr;
+		unsigned char *c = nullptr;
+		int *ind = nullptr;
+		const int ret = (written == 0) ? readMZD(fileName.c_str(), nv, np, nn, &p, &c, &ind, &vn, &vm, &vc, &vu, &nnr, &nc, &nu) : -1;
+		remove(fileName.c_str());
+
+		check(ret == 0, name.str() + ": readMZD failed");
+		if (ret == 0)
+		{
+			check((nv == numVertices) && (np == numPolygons) && (nn == (int)numNodes), name.str() + ": wrong sizes");
+			check(equal(positions, p) && (memcmp(counts.data(), c, counts.size()) == 0) && (memcmp(indices.data(), ind, numNodes * sizeof(int)) == 0),
+				name.str() + ": vertex chunk differs");
+			check(equal(vertNormals, vn) && equal(vertMotions, vm) && equal(vertColors, vc) && equal(vertUVWs, vu), name.str() + ": vertex attributes differ");
+			check(equal(nodeNormals, nnr) && equal(nodeColors, nc) && equal(nodeUVWs, nu), name.str() + ": polygon node attributes differ");
+		}
+		float *arrays[] = { p, vn, vm, vc, vu, nnr, nc, nu };
+		for (float *a : arrays)
+			free(a);
+		free(c);
+		free(ind);
+	}
+
+	/** Write a res x res quad grid with normals row by row with the streaming interface and read it back. */
+	void mzdStreamingRoundTrip(const int res)
+	{
+		const std::string fileName = "MeshToolsCoreTest.mzd";
+		const int numVertices = res * res;
+		const int numPolygons = (res - 1) * (res - 1);
+		std::vector<float> positions, normals;
+		std::vector<int> indices;
+
+		MZDWriter writer;
+		bool ok = writeMZDOpen(writer, fileName.c_str()) == 0;
+		ok = ok && (writeMZDBeginVertices(writer, numVertices) == 0);
+		std::vector<float> row(3 * res);
+		for (int j = 0; ok && (j < res); j++)
+		{
+			for (int i = 0; i < res; i++)
+			{
+				row[3 * i] = (float)i / (float)res;
+				row[3 * i + 1] = 0.1f * sinf(10.0f * row[3 * i]);
+				row[3 * i + 2] = (float)j / (float)res;
+			}
+			positions.insert(positions.end(), row.begin(), row.end());
+			ok = writeMZDPositions(writer, row.data(), res) == 0;
+		}
+		ok = ok && (writeMZDBeginPolygons(writer, numPolygons) == 0);
+		std::vector<unsigned char> counts(res - 1, 4);
+		for (int j = 0; ok && (j < res - 1); j++)
+			ok = writeMZDPolygonCounts(writer, counts.data(), counts.size()) == 0;
+		std::vector<int> quads(4 * (res - 1));
+		for (int j = 0; ok && (j < res - 1); j++)
+		{
+			for (int i = 0; i < res - 1; i++)
+			{
+				quads[4 * i] = j * res + i;
+				quads[4 * i + 1] = j * res + i + 1;
+				quads[4 * i + 2] = (j + 1) * res + i + 1;
+				quads[4 * i + 3] = (j + 1) * res + i;
+			}
+			indices.insert(indices.end(), quads.begin(), quads.end());
+			ok = writeMZDPolygonIndices(writer, quads.data(), quads.size()) == 0;
+		}
+		ok = ok && (writeMZDEndChunk(writer) == 0);
+
+		// normals which are representable as halfs
+		unsigned int seed = (unsigned int)res;
+		ok = ok && (writeMZDBeginAttribute(writer, 0xDA7A0001) == 0);
+		for (int j = 0; ok && (j < res); j++)
+		{
+			const std::vector<float> values = randomValues(3 * res, seed, true);
+			normals.insert(normals.end(), values.begin(), values.end());
+			ok = writeMZDAttribute(writer, values.data(), res) == 0;
+		}
+		ok = ok && (writeMZDEndChunk(writer) == 0);
+		ok = (writeMZDClose(writer) == 0) && ok;
+		check(ok, "streaming: writing failed");
+
+		int nv = 0, np = 0, nn = 0;
+		float *p = nullptr, *vn = nullptr;
+		unsigned char *c = nullptr;
+		int *ind = nullptr;
+		const int ret = ok ? readMZD(fileName.c_str(), nv, np, nn, &p, &c, &ind, &vn) : -1;
+		remove(fileName.c_str());
+		check(ret == 0, "streaming: readMZD failed");
+		if (ret == 0)
+		{
+			check((nv == numVertices) && (np == numPolygons) && (nn == 4 * numPolygons), "streaming: wrong sizes");
+			check(equal(positions, p) && (memcmp(indices.data(), ind, indices.size() * sizeof(int)) == 0) &&
+				std::all_of(c, c + np, [](const unsigned char n) { return n == 4; }), "streaming: vertex chunk differs");
+			check(equal(normals, vn), "streaming: normals differ");
+		}
+		free(p);
+		free(vn);
+		free(c);
+		free(ind);
+	}
+
+	void testMZDRoundTrip()
+	{
+		// 2 byte indices up to 65536 vertices, 4 byte indices above
+		mzdRoundTrip(20000);
+		mzdRoundTrip(65536);
+		mzdRoundTrip(100000);
+		mzdStreamingRoundTrip(300);
+	}
+
+	/** Returns the number of halfs for which the conversion does not match the lookup table. */
+	unsigned int verifyHalfToFloat(void (*convert)(const unsigned short *, float *, size_t))
+	{
+		std::vector<unsigned short> in(65536);
+		std::vector<float> out(65536);
+		for (unsigned int i = 0; i < 65536; i++)
+			in[i] = (unsigned short)i;
+		convert(in.data(), out.data(), in.size());
+
+		unsigned int mismatches = 0;
+		for (unsigned int i = 0; i < 65536; i++)
+		{
+			unsigned int bits;
+			memcpy(&bits, &out[i], sizeof(bits));
+			if (bits != lookupH2F[i].ui)
+				mismatches++;
+		}
+		return mismatches;
+	}
+
+	/** Returns the number of halfs which do not survive the conversion to float and back.
+	* NaNs have to come back as quiet NaNs with the same payload.
+	*/
+	unsigned int verifyHalfRoundTrip(void (*convert)(const float *, unsigned short *, size_t))
+	{
+		std::vector<float> in(65536);
+		std::vector<unsigned short> out(65536);
+		for (unsigned int i = 0; i < 65536; i++)
+			in[i] = lookupH2F[i].f;
+		convert(in.data(), out.data(), in.size());
+
+		unsigned int mismatches = 0;
+		for (unsigned int i = 0; i < 65536; i++)
+		{
+			const bool isNaN = ((i & 0x7c00) == 0x7c00) && ((i & 0x03ff) != 0);
+			if (out[i] != (isNaN ? (i | 0x0200) : i))
+				mismatches++;
+		}
+		return mismatches;
+	}
+
+	/** Returns the number of float bit patterns (every stride-th) for which the portable and the dispatched conversion differ. */
+	unsigned int verifyFloatToHalf(const unsigned int stride)
+	{
+		const size_t blockSize = 1 << 16;
+		std::vector<float> in(blockSize);
+		std::vector<unsigned short> a(blockSize), b(blockSize);
+		unsigned int mismatches = 0;
+		unsigned long long bits = 0;
+		while (bits < (1ull << 32))
+		{
+			size_t n = 0;
+			for (; (n < blockSize) && (bits < (1ull << 32)); n++, bits += stride)
+			{
+				const unsigned int u = (unsigned int)bits;
+				memcpy(&in[n], &u, sizeof(u));
+			}
+			mzd_floatToHalfPortable(in.data(), a.data(), n);
+			mzd_floatToHalf(in.data(), b.data(), n);
+			for (size_t i = 0; i < n; i++)
+				if (a[i] != b[i])
+					mismatches++;
+		}
+		return mismatches;
+	}
+
+	void testHalfFloat()
+	{
+		printf("  F16C available: %s\n", mzd_halfToFloatHasF16C() ? "yes" : "no");
+		check(verifyHalfToFloat(mzd_halfToFloatPortable) == 0, "portable half to float differs from the lookup table");
+		check(verifyHalfToFloat(mzd_halfToFloat) == 0, "dispatched half to float differs from the lookup table");
+		check(verifyHalfRoundTrip(mzd_floatToHalfPortable) == 0, "portable float to half does not restore all halfs");
+		check(verifyHalfRoundTrip(mzd_floatToHalf) == 0, "dispatched float to half does not restore all halfs");
+		check(verifyFloatToHalf(97) == 0, "portable and dispatched float to half differ");
+	}
+
+	/** Read an MTC file from data, which has to fail without any arrays being returned. */
+	void checkRejected(const std::vector<char> &data, const size_t size, const std::string &name)
+	{
+		Utilities::MeshData mesh;
+		std::string error;
+		const bool ok = Utilities::MeshCacheFile::readFromMemory(data.data(), size, false, mesh, error);
+		check(!ok && !error.empty() && mesh.positions.empty() && mesh.connects.empty(), name + " accepted");
+	}
+
+	void testMeshCache()
+	{
+		const Utilities::MeshData mesh = makeMesh(20, true);
+		std::vector<char> data;
+		Utilities::MeshCacheFile::encode(mesh, data);
+		Utilities::MeshCacheFile::Header header;
+		check(Utilities::MeshCacheFile::readHeader(data.data(), data.size(), header), "header of a valid file rejected");
+		Utilities::MeshData read;
+		std::string error;
+		check(Utilities::MeshCacheFile::readFromMemory(data.data(), data.size(), false, read, error) && (read.connects == mesh.connects),
+			"valid file not read: " + error);
+
+		checkRejected(data, sizeof(Utilities::MeshCacheFile::Header) + 100, "truncated file");
+
+		std::vector<char> corrupt = data;
+		int32_t *counts = (int32_t *)(corrupt.data() + header.countsOffset);
+		counts[0]++;
+		checkRejected(corrupt, corrupt.size(), "polygon sizes larger than the number of polygon vertices");
+		counts[0] -= 2;
+		checkRejected(corrupt, corrupt.size(), "polygon sizes smaller than the number of polygon vertices");
+		// the sum is still right
+		corrupt = data;
+		counts = (int32_t *)(corrupt.data() + header.countsOffset);
+		counts[1] += 2 * counts[0];
+		counts[0] = -counts[0];
+		checkRejected(corrupt, corrupt.size(), "negative polygon size");
+
+		corrupt = data;
+		int32_t *connects = (int32_t *)(corrupt.data() + header.connectsOffset);
+		connects[header.numConnects - 1] = (int32_t)header.numVertices;
+		checkRejected(corrupt, corrupt.size(), "vertex index past the last vertex");
+		connects[header.numConnects - 1] = -1;
+		checkRejected(corrupt, corrupt.size(), "negative vertex index");
+	}
+
+	void testFrameCache()
+	{
+		const std::string fileName = "MeshToolsCoreTest.cache.obj";
+		const std::string triangle = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+		const std::string quad = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n";
+		Utilities::FrameCache cache(Utilities::FrameCache::DEFAULT_BUDGET);
+		std::string error;
+		bool fileRead = false;
+
+		check(writeText(fileName, triangle), "unable to write " + fileName);
+		std::shared_ptr<Utilities::MeshData> first = cache.load(fileName, false, error, &fileRead);
+		check(first && fileRead && (first->numVertices() == 3), "first load failed: " + error);
+		std::shared_ptr<Utilities::MeshData> cached = cache.load(fileName, false, error, &fileRead);
+		check((cached == first) && !fileRead && cache.contains(fileName, false), "unchanged file was not cached");
+
+		// rewritten within the resolution of a time stamp in seconds
+		check(writeText(fileName, quad), "unable to write " + fileName);
+		check(!cache.contains(fileName, false), "changed file is still cached");
+		std::shared_ptr<Utilities::MeshData> changed = cache.load(fileName, false, error, &fileRead);
+		check(changed && fileRead && (changed->numVertices() == 4), "changed file was not read again: " + error);
+		check(cache.getNumFrames() == 1, "stale frame was not removed");
+
+		remove(fileName.c_str());
+		check(!cache.load(fileName, false, error, &fileRead) && !error.empty(), "deleted file was loaded");
+	}
+
+	struct Test
+	{
+		const char *name;
+		void (*run)();
+	};
+
+	const Test tests[] =
+	{
+		{ "readers", testReaders },
+		{ "objParallel", testObjParallel },
+		{ "objFloats", testObjFloats },
+		{ "mzdRoundTrip", testMZDRoundTrip },
+		{ "halfFloat", testHalfFloat },
+		{ "meshCache", testMeshCache },
+		{ "frameCache", testFrameCache },
+	};
+}
+
+int main(int argc, char *argv[])
+{
+	int numRun = 0;
+	for (const Test &test : tests)
+	{
+		bool selected = argc == 1;
+		for (int i = 1; i < argc; i++)
+			selected = selected || (strcmp(argv[i], test.name) == 0);
+		if (!selected)
+			continue;
+		const int failures = g_failures;
+		printf("%s\n", test.name);
+		test.run();
+		printf("%s: %s\n", test.name, (g_failures == failures) ? "passed" : "FAILED");
+		numRun++;
+	}
+	if (numRun == 0)
+	{
+		printf("Usage: MeshToolsCoreTest [test ...]\n");
+		return 1;
+	}
+	return (g_failures == 0) ? 0 : 1;
+}
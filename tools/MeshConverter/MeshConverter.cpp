@@ -0,0 +1,275 @@
+// Converts single mesh files or sequences of OBJ, PLY, MZD or MTC files to
+// MTC, PLY, OBJ or MZD files. Sequences are given by patterns with # as
+// placeholder for the frame index, e.g. mesh_###.ply. If no frame range is
+// given, it is determined from the existing input files.
+//
+// The frames are converted by a pipeline of three stages which run at the
+// same time: one thread reads the input files into memory, a pool of worker
+// threads decodes the meshes and encodes the output files in memory, and one
+// thread writes the output files. The queues between the stages are bounded,
+// so at most a few frames per worker are in memory. MZD files are encoded by
+// the writing thread, since writeMZD() writes directly to the file.
+// Equal face-varying normals and UVs are shared before the frames are written,
+// see MeshWriter::shareValues(), so that MTC and OBJ files store each value once.
+//
+// Usage: MeshConverter <input pattern> <output pattern> [-first N] [-last N] [-threads N] [-positionsOnly]
+
+#include "src/MeshReader.h"
+#include "src/MeshWriter.h"
+#include "src/FileSequence.h"
+#include "src/MemoryMappedFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+namespace
+{
+	/** Queue with a maximum size between two pipeline stages. pop() returns
+	* false when the queue is closed and empty.
+	*/
+	template<class T>
+	class BoundedQueue
+	{
+	public:
+		explicit BoundedQueue(const size_t capacity) : m_capacity(std::max<size_t>(capacity, 1)), m_closed(false) {}
+
+		void push(T item)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_notFull.wait(lock, [this]() { return m_items.size() < m_capacity; });
+			m_items.push_back(std::move(item));
+			m_notEmpty.notify_one();
+		}
+
+		bool pop(T &item)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_notEmpty.wait(lock, [this]() { return !m_items.empty() || m_closed; });
+			if (m_items.empty())
+				return false;
+			item = std::move(m_items.front());
+			m_items.pop_front();
+			m_notFull.notify_one();
+			return true;
+		}
+
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_closed = true;
+			m_notEmpty.notify_all();
+		}
+
+	protected:
+		const size_t m_capacity;
+		bool m_closed;
+		std::deque<T> m_items;
+		std::mutex m_mutex;
+		std::condition_variable m_notEmpty;
+		std::condition_variable m_notFull;
+	};
+
+	struct Frame
+	{
+		std::string inputFile;
+		std::string outputFile;
+		std::vector<char> input;
+		Utilities::MeshData mesh;
+		std::vector<char> output;
+		bool ok;
+		std::string error;
+	};
+
+	/** Read a file into data. Empty files are read as empty data, the size is not limited to 2 GB. */
+	bool readFile(const std::string &fileName, std::vector<char> &data)
+	{
+		Utilities::MemoryMappedFile file;
+		if (!file.open(fileName))
+			return false;
+		data.assign(file.data(), file.end());
+		return true;
+	}
+
+	void printUsage()
+	{
+		printf("Usage: MeshConverter <input pattern> <output pattern> [-first N] [-last N] [-threads N] [-positionsOnly]\n");
+		printf("  Use # as placeholder for the frame index, e.g. mesh_###.ply.\n");
+		printf("  Input formats: obj, ply, mzd, mtc. Output formats: mtc, ply, obj, mzd.\n");
+		printf("  -threads: number of worker threads, 0 = number of hardware threads (default)\n");
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 3)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const Utilities::FileSequence input(argv[1]);
+	const Utilities::FileSequence output(argv[2]);
+	int firstFrame = 0;
+	int lastFrame = 0;
+	bool hasFirst = false;
+	bool hasLast = false;
+	bool positionsOnly = false;
+	unsigned int numThreads = 0;
+	for (int i = 3; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "-first") == 0) && (i + 1 < argc))
+		{
+			firstFrame = atoi(argv[++i]);
+			hasFirst = true;
+		}
+		else if ((strcmp(argv[i], "-last") == 0) && (i + 1 < argc))
+		{
+			lastFrame = atoi(argv[++i]);
+			hasLast = true;
+		}
+		else if ((strcmp(argv[i], "-threads") == 0) && (i + 1 < argc))
+			numThreads = (unsigned int)std::max(0, atoi(argv[++i]));
+		else if (strcmp(argv[i], "-positionsOnly") == 0)
+			positionsOnly = true;
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	if (numThreads == 0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	const std::string inputExt = Utilities::MeshReader::getFormat(input.getPattern());
+	const std::string outputExt = Utilities::MeshWriter::getFormat(output.getPattern());
+	if (!Utilities::MeshReader::isSupported(inputExt))
+	{
+		fprintf(stderr, "Error: unsupported input format %s\n", inputExt.c_str());
+		return 1;
+	}
+	if (!Utilities::MeshWriter::isSupported(outputExt))
+	{
+		fprintf(stderr, "Error: unsupported output format %s\n", outputExt.c_str());
+		return 1;
+	}
+
+	if (input.isSequence())
+	{
+		if (!hasFirst || !hasLast)
+		{
+			int first, last;
+			if (!input.findFrameRange(first, last))
+			{
+				fprintf(stderr, "Error: no files found for %s\n", input.getPattern().c_str());
+				return 1;
+			}
+			if (!hasFirst)
+				firstFrame = first;
+			if (!hasLast)
+				lastFrame = last;
+		}
+		if (!output.isSequence() && (firstFrame != lastFrame))
+		{
+			fprintf(stderr, "Error: the output pattern needs a # placeholder for a sequence.\n");
+			return 1;
+		}
+	}
+	else
+		firstFrame = lastFrame = 0;
+
+	if ((firstFrame < 0) || (lastFrame < firstFrame))
+	{
+		fprintf(stderr, "Error: illegal frame range %d - %d\n", firstFrame, lastFrame);
+		return 1;
+	}
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	BoundedQueue<std::unique_ptr<Frame>> decodeQueue(2 * numThreads);
+	BoundedQueue<std::unique_ptr<Frame>> writeQueue(2 * numThreads);
+
+	// stage 1: read the input files
+	std::thread reader([&]()
+	{
+		for (int frame = firstFrame; frame <= lastFrame; frame++)
+		{
+			std::unique_ptr<Frame> f(new Frame());
+			f->inputFile = input.getFileName((unsigned int)frame);
+			f->outputFile = output.getFileName((unsigned int)frame);
+			f->ok = readFile(f->inputFile, f->input);
+			if (!f->ok)
+				f->error = "Error: unable to read file " + f->inputFile;
+			decodeQueue.push(std::move(f));
+		}
+		decodeQueue.close();
+	});
+
+	// stage 2: decode and encode, the last worker closes the write queue
+	std::atomic<unsigned int> activeWorkers(numThreads);
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < numThreads; t++)
+	{
+		workers.push_back(std::thread([&]()
+		{
+			std::unique_ptr<Frame> f;
+			while (decodeQueue.pop(f))
+			{
+				if (f->ok)
+					f->ok = Utilities::MeshReader::readFromMemory(inputExt, f->input.data(), f->input.size(), positionsOnly, f->mesh, f->error, 1);
+				std::vector<char>().swap(f->input);
+				if (f->ok)
+					Utilities::MeshWriter::shareValues(f->mesh);
+				if (f->ok && Utilities::MeshWriter::canEncode(outputExt))
+				{
+					f->ok = Utilities::MeshWriter::encode(outputExt, f->mesh, f->output, f->error);
+					f->mesh.clear();
+				}
+				writeQueue.push(std::move(f));
+			}
+			if (--activeWorkers == 0)
+				writeQueue.close();
+		}));
+	}
+
+	// stage 3: write the output files on this thread
+	int numFrames = 0;
+	int numFailed = 0;
+	std::unique_ptr<Frame> f;
+	while (writeQueue.pop(f))
+	{
+		numFrames++;
+		if (f->ok)
+		{
+			if (Utilities::MeshWriter::canEncode(outputExt))
+				f->ok = Utilities::MeshWriter::writeFile(f->outputFile, f->output, f->error);
+			else
+				f->ok = Utilities::MeshWriter::write(f->outputFile, f->mesh, f->error);
+		}
+		if (f->ok)
+			printf("%s -> %s\n", f->inputFile.c_str(), f->outputFile.c_str());
+		else
+		{
+			fprintf(stderr, "%s: %s\n", f->inputFile.c_str(), f->error.c_str());
+			numFailed++;
+		}
+		f.reset();
+	}
+
+	reader.join();
+	for (std::thread &worker : workers)
+		worker.join();
+
+	const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("Converted %d of %d files in %.2f s with %u worker threads.\n", numFrames - numFailed, numFrames, seconds, numThreads);
+	return (numFailed == 0) ? 0 : 1;
+}